@@ -1,7 +1,7 @@
 #version 450
 
 layout(push_constant) uniform PushConstants {
-    layout(offset = 96) vec3 baseColor;
+    layout(offset = 128) vec3 baseColor;
     vec3 tipColor;
     float colorRamp;
     vec3 cameraPos;
@@ -1,4 +1,7 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "grass_common.glsl"
 
 layout(push_constant) uniform PushConstants {
     mat4 VPMatrix;
@@ -8,6 +11,8 @@ layout(push_constant) uniform PushConstants {
     vec2 windDir;
     float windStrength;
     float grassRoundness;
+    vec4 instanceScale;  // xyz scale the position attribute, w the rotation
+    vec4 instanceOrigin; // World xz of uv 0 and world size of uv 1
 } pc;
 
 layout(binding = 0) uniform sampler2D windNoise;
@@ -26,35 +31,11 @@ layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec3 fragPosition;
 layout(location = 2) out float fragWeight;
 
-mat3 getPositionRotationMatrix(vec3 axis, float angle)
-{
-    float s = sin(angle);
-    float c = cos(angle);
-    float oc = 1.0 - c;
-
-    return mat3(
-        vec3(axis.x * axis.x * oc + c,          axis.y * axis.x * oc - axis.z * s, axis.z * axis.x * oc + axis.y * s),
-        vec3(axis.x * axis.y * oc + axis.z * s, axis.y * axis.y * oc + c,          axis.z * axis.y * oc - axis.x * s),
-        vec3(axis.x * axis.z * oc - axis.y * s, axis.y * axis.z * oc + axis.x * s, axis.z * axis.z * oc + c)
-    );
-}
-
-vec3 bezierQuadratic(vec3 p0, vec3 pm, vec3 p1, float t) {
-    float u = 1.0 - t;
-    return u * u * p0 + 2.0 * u * t * pm + t * t * p1;
-}
-
-vec3 bezierCubic(vec3 p0, vec3 p1, vec3 p2, vec3 p3, float t) {
-    float u = 1.0 - t;
-    float uu = u * u;
-    float uuu = uu * u;
-    float tt = t * t;
-    float ttt = tt * t;
-
-    return uuu * p0 + 3.0 * uu * t * p1 + 3.0 * u * tt * p2 + ttt * p3;
-}
-
 void main() {
+    // Identity for full instances, compact ones only keep the y of the position attribute and rebuild xz from the uv
+    vec3 instPosition = inInstPosition * pc.instanceScale.xyz + vec3(pc.instanceOrigin.x + uv.x * pc.instanceOrigin.z, 0.0, pc.instanceOrigin.y + uv.y * pc.instanceOrigin.z);
+    float instRotation = inInstRotation * pc.instanceScale.w;
+
     vec2 finalVertPos = vertexPosition;
     float xSign = -sign(finalVertPos.x);
     finalVertPos.x *= pc.widthMult;
@@ -71,7 +52,7 @@ void main() {
     vec3 windAxis = normalize(cross(vec3(0.0, 1.0, 0.0), vec3(-pc.windDir.x, 0.0, -pc.windDir.y)));
     
     mat3 rotation = getPositionRotationMatrix(windAxis, windBendIntensity) 
-                  * getPositionRotationMatrix(vec3(0.0, 1.0, 0.0), inInstRotation) 
+                  * getPositionRotationMatrix(vec3(0.0, 1.0, 0.0), instRotation) 
                   * getPositionRotationMatrix(vec3(-1.0, 0.0, 0.0), localTilt);
 
     vec3 windBendPos = rotation * vec3(finalVertPos, 0.0);
@@ -79,10 +60,10 @@ void main() {
     vec3 normal = vec3(pc.grassRoundness * xSign, 0.0, 1.0);
 
     mat3 normalRotation = getPositionRotationMatrix(windAxis, 2 * windBendIntensity) 
-                  * getPositionRotationMatrix(vec3(0.0, 1.0, 0.0), inInstRotation) 
+                  * getPositionRotationMatrix(vec3(0.0, 1.0, 0.0), instRotation) 
                   * getPositionRotationMatrix(vec3(-1.0, 0.0, 0.0), 2 * localTilt);
     
-    fragPosition = inInstPosition + windBendPos;
+    fragPosition = instPosition + windBendPos;
     fragNormal = normalize(normalRotation * normalize(normal));
     fragWeight = weight;
 
@@ -0,0 +1,66 @@
+// Blade placement and shape shared by grass.comp and every grass draw, so blades come out at the same spot and bend
+// the same way whichever mode builds them. Heights are stored in the terrain encoding
+#include "terrain_encoding.glsl"
+
+struct Blade {
+    vec3 position;
+    float rotation;
+    vec2 uv;
+    float height;
+};
+
+float random(float seed)
+{
+    seed = fract(seed * 0.1031);
+    seed *= seed + 33.33;
+    seed *= seed + seed;
+    return fract(seed);
+}
+
+// Blade of the grass cell whose corner is at cellPos (world xz), jittered inside the cell and put on the heightmap.
+// The uv is the blade's position on the noise grid, before the toroidal origins are added
+Blade placeBlade(vec2 cellPos, float cellSize, vec2 worldOffset, float gridExtent,
+                 sampler2D heightmap, vec2 heightmapOrigin, float heightmapScale,
+                 sampler2D grassHeightNoise, vec2 grassHeightOrigin, float grassBaseHeight, float grassHeightVariation)
+{
+    vec3 pos = vec3(cellPos.x, 0.0, cellPos.y);
+    pos.x += random(pos.z * 2.3411) * cellSize;
+    pos.z += random(pos.x * 5.2334) * cellSize;
+    vec2 heightmapUV = (pos.xz - worldOffset) / gridExtent;
+    pos.y = -decodeHeight(texture(heightmap, heightmapUV + heightmapOrigin).r) * heightmapScale;
+
+    Blade blade;
+    blade.position = pos;
+    blade.rotation = random(pos.x + pos.z) * 2.0 * 3.14159265359;
+    blade.uv = heightmapUV;
+    blade.height = texture(grassHeightNoise, heightmapUV + grassHeightOrigin).r * grassHeightVariation + grassBaseHeight;
+    return blade;
+}
+
+mat3 getPositionRotationMatrix(vec3 axis, float angle)
+{
+    float s = sin(angle);
+    float c = cos(angle);
+    float oc = 1.0 - c;
+
+    return mat3(
+        vec3(axis.x * axis.x * oc + c,          axis.y * axis.x * oc - axis.z * s, axis.z * axis.x * oc + axis.y * s),
+        vec3(axis.x * axis.y * oc + axis.z * s, axis.y * axis.y * oc + c,          axis.z * axis.y * oc - axis.x * s),
+        vec3(axis.x * axis.z * oc - axis.y * s, axis.y * axis.z * oc + axis.x * s, axis.z * axis.z * oc + c)
+    );
+}
+
+vec3 bezierQuadratic(vec3 p0, vec3 pm, vec3 p1, float t) {
+    float u = 1.0 - t;
+    return u * u * p0 + 2.0 * u * t * pm + t * t * p1;
+}
+
+vec3 bezierCubic(vec3 p0, vec3 p1, vec3 p2, vec3 p3, float t) {
+    float u = 1.0 - t;
+    float uu = u * u;
+    float uuu = uu * u;
+    float tt = t * t;
+    float ttt = tt * t;
+
+    return uuu * p0 + 3.0 * uu * t * p1 + 3.0 * u * tt * p2 + ttt * p3;
+}
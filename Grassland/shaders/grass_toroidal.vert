@@ -0,0 +1,149 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "grass_common.glsl"
+
+// Same blade as grass.vert, read from the toroidal store slot of the tile gl_InstanceIndex falls in instead of from an instance attribute
+
+layout(push_constant) uniform PushConstants {
+    mat4 VPMatrix;
+    float widthMult;
+    float tilt;
+    float bend;
+    vec2 windDir;
+    float windStrength;
+    float grassRoundness;
+    vec4 instanceScale;  // Unused, there are no instance attributes to decode
+    vec4 instanceOrigin;
+} pc;
+
+layout(binding = 0) uniform sampler2D windNoise;
+
+struct TileInstance
+{
+    uint globalTileIndex;
+    uint tileIndex;
+};
+
+layout(binding = 1) readonly buffer TileBuffer {
+    uvec4 instanceOffsets;
+    uvec4 tileOffsets;
+    uvec4 instanceCounts;
+    TileInstance tileIndexes[];
+};
+
+// The push constants grass.comp would have been dispatched with
+layout(binding = 2) readonly buffer PlacementParams {
+    vec2 centerPos;
+    vec2 worldOffset;
+    uvec4 tileGridSizes;
+    uvec4 tileDensities;
+    float tileSize;
+    float gridExtent;
+    float heightmapScale;
+    float grassBaseHeight;
+    float grassHeightVariation;
+    uint bladeCulling;
+    uint compactInstances;
+    uint toroidalInstances;
+    vec2 heightmapOrigin;   // Added to the uv of every sample of a toroidal noise
+    vec2 grassHeightOrigin;
+} placement;
+
+struct GrassInstance {
+    vec3 position;
+    float rotation;
+    vec2 uv;
+    float height;
+};
+
+layout(binding = 5) readonly buffer GrassStore {
+    GrassInstance grassPositions[];
+};
+
+// Per-vertex attributes, the only binding of this pipeline
+layout(location = 0) in vec2 vertexPosition;
+
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec3 fragPosition;
+layout(location = 2) out float fragWeight;
+
+// Same as getStoreIndex in grass.comp
+uint getStoreIndex(uint globalPosIndex, uint ring, uint bladeOffset)
+{
+    uint gridSize = placement.tileGridSizes.w;
+    ivec2 centerTile = ivec2(round(placement.centerPos / placement.tileSize));
+    ivec2 worldTile = centerTile + ivec2(globalPosIndex % gridSize, globalPosIndex / gridSize) - ivec2(gridSize / 2);
+
+    uint ringBase = 0;
+    for (uint i = 0; i < ring; i++)
+        ringBase += placement.tileGridSizes[i] * placement.tileGridSizes[i] * placement.tileDensities[i] * placement.tileDensities[i];
+
+    // Floored modulo, % is undefined for negative operands
+    int ringSize = int(placement.tileGridSizes[ring]);
+    ivec2 slot = worldTile - ringSize * ivec2(floor(vec2(worldTile) / float(ringSize)));
+
+    uint density = placement.tileDensities[ring];
+    return ringBase + (uint(slot.y) * uint(ringSize) + uint(slot.x)) * density * density + bladeOffset;
+}
+
+// Finds the tile and blade the way grass_procedural.vert does, then reads what grass.comp stored for them
+Blade getBlade(uint globalIndex)
+{
+    uint densities[4] = {placement.tileDensities.x, placement.tileDensities.y, placement.tileDensities.z, placement.tileDensities.w};
+
+    uint ringIndex = int(globalIndex >= instanceOffsets[1]) + int(globalIndex >= instanceOffsets[2]) + int(globalIndex >= instanceOffsets[3]);
+    uint density = densities[ringIndex];
+    uint localInstanceIndex = globalIndex - instanceOffsets[ringIndex];
+    uint computeTileIndex = (localInstanceIndex / (density * density)) + tileOffsets[ringIndex];
+    uint globalPosIndex = tileIndexes[computeTileIndex].globalTileIndex;
+    uint bladeOffset = localInstanceIndex % (density * density);
+
+    GrassInstance instance = grassPositions[getStoreIndex(globalPosIndex, ringIndex, bladeOffset)];
+
+    Blade blade;
+    blade.position = instance.position;
+    blade.rotation = instance.rotation;
+    // The stored uv is relative to the grid the blade was generated on, the wind is sampled on the current one
+    blade.uv = (instance.position.xz - placement.worldOffset) / placement.gridExtent;
+    blade.height = instance.height;
+    return blade;
+}
+
+void main() {
+    // firstInstance of every draw is the LOD's instance offset in the tile list, like the procedural draw
+    Blade blade = getBlade(gl_InstanceIndex);
+
+    vec2 finalVertPos = vertexPosition;
+    float xSign = -sign(finalVertPos.x);
+    finalVertPos.x *= pc.widthMult;
+    float weight = -finalVertPos.y;
+
+    float localTilt = 0.0;
+    if (weight > 0.0)
+        localTilt = mix(0.0, pc.tilt, pow(weight, pc.bend));
+
+    finalVertPos.y *= blade.height;
+
+    float windBendIntensity = mix(0.0, texture(windNoise, blade.uv).r * pc.windStrength, weight);
+    vec3 windAxis = normalize(cross(vec3(0.0, 1.0, 0.0), vec3(-pc.windDir.x, 0.0, -pc.windDir.y)));
+
+    mat3 rotation = getPositionRotationMatrix(windAxis, windBendIntensity)
+                  * getPositionRotationMatrix(vec3(0.0, 1.0, 0.0), blade.rotation)
+                  * getPositionRotationMatrix(vec3(-1.0, 0.0, 0.0), localTilt);
+
+    vec3 windBendPos = rotation * vec3(finalVertPos, 0.0);
+
+    vec3 normal = vec3(pc.grassRoundness * xSign, 0.0, 1.0);
+
+    mat3 normalRotation = getPositionRotationMatrix(windAxis, 2 * windBendIntensity)
+                  * getPositionRotationMatrix(vec3(0.0, 1.0, 0.0), blade.rotation)
+                  * getPositionRotationMatrix(vec3(-1.0, 0.0, 0.0), 2 * localTilt);
+
+    fragPosition = blade.position + windBendPos;
+    fragNormal = normalize(normalRotation * normalize(normal));
+    fragWeight = weight;
+
+    gl_Position = pc.VPMatrix * vec4(fragPosition, 1.0);
+}
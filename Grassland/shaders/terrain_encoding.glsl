@@ -0,0 +1,58 @@
+// Storage of the heightmap and its normal map, included by the passes that write them and by every pass that samples them.
+// The formats behind the encodings are NoiseEngine::TerrainFormat
+
+// NoiseEngine::NoiseObject::getEncoding, 0 for noise that is not a terrain
+#define TERRAIN_ENCODING_RAW 0u
+// Normal remapped to [0, 1] in rgb, for RGBA float images
+#define TERRAIN_ENCODING_FULL 1u
+// Octahedral normal in rg, for two channel SNORM images
+#define TERRAIN_ENCODING_OCTAHEDRAL 2u
+
+// Terrain heights are stored remapped from this range to [0, 1] in every format, so UNORM images can hold them.
+// Covers the heightmap noise down to a persistence of about 1.5 at 3 octaves, UNORM images clamp anything past it
+const float terrainHeightMin = -1.0;
+const float terrainHeightMax = 2.0;
+
+float encodeHeight(float height)
+{
+    return (height - terrainHeightMin) / (terrainHeightMax - terrainHeightMin);
+}
+
+float decodeHeight(float stored)
+{
+    return stored * (terrainHeightMax - terrainHeightMin) + terrainHeightMin;
+}
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector folded onto the octahedron and unwrapped onto [-1, 1]^2
+vec2 encodeOctahedral(vec3 n)
+{
+    vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z <= 0.0 ? (1.0 - abs(p.yx)) * signNotZero(p) : p;
+}
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
+
+vec4 encodeNormal(vec3 normal, uint encoding)
+{
+    if (encoding == TERRAIN_ENCODING_OCTAHEDRAL)
+        return vec4(encodeOctahedral(normal), 0.0, 0.0);
+    return vec4(normal * 0.5 + 0.5, 1.0);
+}
+
+vec3 decodeNormal(vec4 stored, uint encoding)
+{
+    if (encoding == TERRAIN_ENCODING_OCTAHEDRAL)
+        return decodeOctahedral(stored.xy);
+    return normalize(stored.xyz * 2.0 - 1.0);
+}
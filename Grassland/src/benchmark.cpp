@@ -0,0 +1,108 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+void BenchmarkRecorder::setGpuTime(const uint32_t p_Frame, const float p_GpuMs)
+{
+    // Frames are pushed in order, so the lookup is almost always the last element
+    for (auto l_It = m_Frames.rbegin(); l_It != m_Frames.rend(); ++l_It)
+    {
+        if (l_It->frame == p_Frame)
+        {
+            l_It->gpuMs = p_GpuMs;
+            return;
+        }
+    }
+}
+
+void BenchmarkRecorder::write(const std::string_view p_Path) const
+{
+    if (p_Path.size() >= 5 && p_Path.substr(p_Path.size() - 5) == ".json")
+        writeJSON(p_Path);
+    else
+        writeCSV(p_Path);
+}
+
+void BenchmarkRecorder::writeCSV(const std::string_view p_Path) const
+{
+    std::ofstream l_File{ std::string(p_Path) };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open benchmark output file " + std::string(p_Path));
+
+    l_File << "frame,time,cpu_ms,frame_ms,gpu_ms,post_cull_tiles,post_cull_instances,grass_height,culling_transfer,heightmap,wind,grass\n";
+    for (const FrameStats& l_Frame : m_Frames)
+    {
+        l_File << l_Frame.frame << ',' << l_Frame.time << ',' << l_Frame.cpuMs << ',' << l_Frame.frameMs << ',' << l_Frame.gpuMs << ','
+               << l_Frame.postCullTiles << ',' << l_Frame.postCullInstances << ','
+               << l_Frame.grassHeight << ',' << l_Frame.cullingTransfer << ',' << l_Frame.heightmap << ',' << l_Frame.wind << ',' << l_Frame.grass << '\n';
+    }
+}
+
+void BenchmarkRecorder::writeJSON(const std::string_view p_Path) const
+{
+    std::ofstream l_File{ std::string(p_Path) };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open benchmark output file " + std::string(p_Path));
+
+    l_File << std::boolalpha << "{\n  \"frames\": [\n";
+    for (size_t i = 0; i < m_Frames.size(); i++)
+    {
+        const FrameStats& l_Frame = m_Frames[i];
+        l_File << "    {\"frame\": " << l_Frame.frame << ", \"time\": " << l_Frame.time
+               << ", \"cpu_ms\": " << l_Frame.cpuMs << ", \"frame_ms\": " << l_Frame.frameMs << ", \"gpu_ms\": " << l_Frame.gpuMs
+               << ", \"post_cull_tiles\": " << l_Frame.postCullTiles << ", \"post_cull_instances\": " << l_Frame.postCullInstances
+               << ", \"recomputes\": {\"grass_height\": " << l_Frame.grassHeight << ", \"culling_transfer\": " << l_Frame.cullingTransfer
+               << ", \"heightmap\": " << l_Frame.heightmap << ", \"wind\": " << l_Frame.wind << ", \"grass\": " << l_Frame.grass << "}}"
+               << (i + 1 < m_Frames.size() ? ",\n" : "\n");
+    }
+    l_File << "  ]\n}\n";
+}
+
+void ComputeBatchBenchmark::addFrame(const uint32_t p_Frame, const uint32_t p_Submits, const float p_RecordMs, const float p_FrameMs)
+{
+    const uint32_t l_Mode = getMeasuredMode(p_Frame);
+    if (l_Mode == UINT32_MAX)
+        return;
+
+    ModeStats& l_Stats = m_Modes[l_Mode];
+    l_Stats.frames++;
+    l_Stats.submits += p_Submits;
+    l_Stats.recordMs += p_RecordMs;
+    l_Stats.frameMs += p_FrameMs;
+}
+
+void ComputeBatchBenchmark::setGpuTime(const uint32_t p_Frame, const float p_GpuMs)
+{
+    const uint32_t l_Mode = getMeasuredMode(p_Frame);
+    if (l_Mode == UINT32_MAX)
+        return;
+
+    m_Modes[l_Mode].gpuMs += p_GpuMs;
+    m_Modes[l_Mode].gpuFrames++;
+}
+
+void ComputeBatchBenchmark::print() const
+{
+    constexpr std::array<const char*, 2> l_Names{ "per job", "batched" };
+    std::printf("Compute submission benchmark, %u tile crossing frames per mode\n", m_FramesPerMode);
+    std::printf("%10s %14s %12s %10s %10s\n", "mode", "submits/frame", "record ms", "frame ms", "gpu ms");
+    for (uint32_t i = 0; i < m_Modes.size(); i++)
+    {
+        const ModeStats& l_Stats = m_Modes[i];
+        const float l_Frames = static_cast<float>(std::max(l_Stats.frames, 1u));
+        const float l_GpuFrames = static_cast<float>(std::max(l_Stats.gpuFrames, 1u));
+        std::printf("%10s %14.2f %12.3f %10.3f %10.3f\n", l_Names[i], static_cast<float>(l_Stats.submits) / l_Frames, l_Stats.recordMs / l_Frames, l_Stats.frameMs / l_Frames, l_Stats.gpuMs / l_GpuFrames);
+    }
+}
+
+uint32_t ComputeBatchBenchmark::getMeasuredMode(const uint32_t p_Frame) const
+{
+    for (uint32_t i = 0; i < m_Modes.size(); i++)
+        if (p_Frame >= getModeStart(i) && p_Frame < getModeEnd(i))
+            return i;
+    return UINT32_MAX;
+}
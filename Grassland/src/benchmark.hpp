@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class BenchmarkRecorder
+{
+public:
+    struct FrameStats
+    {
+        uint32_t frame = 0;
+        float time = 0.f;
+        float cpuMs = 0.f;
+        float frameMs = 0.f;
+        float gpuMs = 0.f;
+        uint32_t postCullTiles = 0;
+        uint32_t postCullInstances = 0;
+
+        // Which recomputes fired this frame
+        bool grassHeight = false;
+        bool cullingTransfer = false;
+        bool heightmap = false;
+        bool wind = false;
+        bool grass = false;
+    };
+
+    void reserve(const size_t p_FrameCount) { m_Frames.reserve(p_FrameCount); }
+    void pushFrame(const FrameStats& p_Stats) { m_Frames.push_back(p_Stats); }
+
+    // GPU timestamps for a frame are only available once its render has been waited on, so they are filled in late
+    void setGpuTime(uint32_t p_Frame, float p_GpuMs);
+
+    // Writes JSON if the path ends in .json, CSV otherwise
+    void write(std::string_view p_Path) const;
+    void writeCSV(std::string_view p_Path) const;
+    void writeJSON(std::string_view p_Path) const;
+
+    [[nodiscard]] const std::vector<FrameStats>& getFrames() const { return m_Frames; }
+
+private:
+    std::vector<FrameStats> m_Frames{};
+};
+
+// Crosses a tile every frame so every compute job fires, first with one submission per job and then batched
+class ComputeBatchBenchmark
+{
+public:
+    static constexpr uint32_t s_WarmupFrames = 16;
+
+    struct ModeStats
+    {
+        uint32_t frames = 0;
+        uint32_t submits = 0;
+        float recordMs = 0.f;
+        float frameMs = 0.f;
+        float gpuMs = 0.f;
+        uint32_t gpuFrames = 0;
+    };
+
+    void begin(const uint32_t p_FramesPerMode) { m_FramesPerMode = p_FramesPerMode; }
+    [[nodiscard]] bool isRunning() const { return m_FramesPerMode != 0; }
+
+    // Each mode runs its warmup frames before the measured ones
+    [[nodiscard]] bool isBatched(const uint32_t p_Frame) const { return p_Frame >= getModeEnd(0); }
+    [[nodiscard]] bool isFinished(const uint32_t p_Frame) const { return isRunning() && p_Frame >= getModeEnd(1); }
+
+    void addFrame(uint32_t p_Frame, uint32_t p_Submits, float p_RecordMs, float p_FrameMs);
+    void setGpuTime(uint32_t p_Frame, float p_GpuMs);
+
+    void print() const;
+
+private:
+    [[nodiscard]] uint32_t getModeStart(const uint32_t p_Mode) const { return p_Mode * (s_WarmupFrames + m_FramesPerMode) + s_WarmupFrames; }
+    [[nodiscard]] uint32_t getModeEnd(const uint32_t p_Mode) const { return getModeStart(p_Mode) + m_FramesPerMode; }
+    // Index of the mode p_Frame is measured in, UINT32_MAX during warmups
+    [[nodiscard]] uint32_t getMeasuredMode(uint32_t p_Frame) const;
+
+    std::array<ModeStats, 2> m_Modes{};
+    uint32_t m_FramesPerMode = 0;
+};
@@ -341,6 +341,11 @@ bool Camera::isBoxInFrustum(const glm::vec3& aabbMin, const glm::vec3& aabbMax)
 	return true;
 }
 
+const glm::vec4* Camera::getFrustumPlanes()
+{
+    return getFrustum().planes;
+}
+
 void Camera::setViewDirty()
 {
     m_viewDirty = true;
@@ -48,6 +48,8 @@ public:
 
     [[nodiscard]] bool isFrustumDirty() const { return m_Frustum.frustumDirty; }
     [[nodiscard]] bool isBoxInFrustum(const glm::vec3& aabbMin, const glm::vec3& aabbMax);
+    // Left, right, bottom, top, near and far planes, normalized, as used by isBoxInFrustum
+    [[nodiscard]] const glm::vec4* getFrustumPlanes();
 
     void setViewDirty();
     void setProjDirty();
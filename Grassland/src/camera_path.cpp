@@ -0,0 +1,89 @@
+#include "camera_path.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// File format: one keyframe per line as "time px py pz dx dy dz", lines starting with '#' are ignored
+void CameraPath::load(const std::string_view p_Path)
+{
+    std::ifstream l_File{ std::string(p_Path) };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open camera path file " + std::string(p_Path));
+
+    m_Keyframes.clear();
+
+    std::string l_Line;
+    uint32_t l_LineNumber = 0;
+    while (std::getline(l_File, l_Line))
+    {
+        l_LineNumber++;
+        if (l_Line.empty() || l_Line[0] == '#')
+            continue;
+
+        std::istringstream l_Stream{ l_Line };
+        Keyframe l_Keyframe{};
+        if (!(l_Stream >> l_Keyframe.time
+                       >> l_Keyframe.position.x >> l_Keyframe.position.y >> l_Keyframe.position.z
+                       >> l_Keyframe.direction.x >> l_Keyframe.direction.y >> l_Keyframe.direction.z))
+            throw std::runtime_error("Malformed keyframe at line " + std::to_string(l_LineNumber) + " of " + std::string(p_Path));
+
+        if (!m_Keyframes.empty() && l_Keyframe.time < m_Keyframes.back().time)
+            throw std::runtime_error("Keyframe times must be increasing (line " + std::to_string(l_LineNumber) + " of " + std::string(p_Path) + ")");
+
+        l_Keyframe.direction = glm::normalize(l_Keyframe.direction);
+        m_Keyframes.push_back(l_Keyframe);
+    }
+
+    if (m_Keyframes.empty())
+        throw std::runtime_error("Camera path file " + std::string(p_Path) + " has no keyframes");
+}
+
+void CameraPath::save(const std::string_view p_Path) const
+{
+    std::ofstream l_File{ std::string(p_Path) };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open camera path file " + std::string(p_Path) + " for writing");
+
+    l_File << "# time px py pz dx dy dz\n";
+    l_File.precision(9);
+    for (const Keyframe& l_Keyframe : m_Keyframes)
+    {
+        l_File << l_Keyframe.time << ' '
+               << l_Keyframe.position.x << ' ' << l_Keyframe.position.y << ' ' << l_Keyframe.position.z << ' '
+               << l_Keyframe.direction.x << ' ' << l_Keyframe.direction.y << ' ' << l_Keyframe.direction.z << '\n';
+    }
+}
+
+void CameraPath::addKeyframe(const float p_Time, const glm::vec3 p_Position, const glm::vec3 p_Direction)
+{
+    m_Keyframes.push_back({ p_Time, p_Position, p_Direction });
+}
+
+CameraPath::Keyframe CameraPath::sample(const float p_Time) const
+{
+    if (m_Keyframes.empty())
+        throw std::runtime_error("Sampling an empty camera path");
+
+    if (p_Time <= m_Keyframes.front().time)
+        return m_Keyframes.front();
+    if (p_Time >= m_Keyframes.back().time)
+        return m_Keyframes.back();
+
+    const auto l_Next = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), p_Time, [](const float p_T, const Keyframe& p_Keyframe) { return p_T < p_Keyframe.time; });
+    const Keyframe& l_B = *l_Next;
+    const Keyframe& l_A = *(l_Next - 1);
+
+    const float l_Span = l_B.time - l_A.time;
+    const float l_T = l_Span > 0.f ? (p_Time - l_A.time) / l_Span : 1.f;
+
+    Keyframe l_Result;
+    l_Result.time = p_Time;
+    l_Result.position = glm::mix(l_A.position, l_B.position, l_T);
+    const glm::vec3 l_Dir = glm::mix(l_A.direction, l_B.direction, l_T);
+    // Opposite directions would collapse to zero, keep the previous one in that case
+    l_Result.direction = glm::length(l_Dir) > 1e-6f ? glm::normalize(l_Dir) : l_A.direction;
+    return l_Result;
+}
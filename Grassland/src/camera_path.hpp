@@ -0,0 +1,33 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class CameraPath
+{
+public:
+    struct Keyframe
+    {
+        float time;
+        glm::vec3 position;
+        glm::vec3 direction;
+    };
+
+    void load(std::string_view p_Path);
+    void save(std::string_view p_Path) const;
+
+    // Keyframes must be pushed in increasing time order
+    void addKeyframe(float p_Time, glm::vec3 p_Position, glm::vec3 p_Direction);
+    void clear() { m_Keyframes.clear(); }
+
+    // Linearly interpolates between the two keyframes surrounding p_Time, clamping at both ends
+    [[nodiscard]] Keyframe sample(float p_Time) const;
+
+    [[nodiscard]] float getDuration() const { return m_Keyframes.empty() ? 0.f : m_Keyframes.back().time; }
+    [[nodiscard]] bool isEmpty() const { return m_Keyframes.empty(); }
+    [[nodiscard]] size_t getKeyframeCount() const { return m_Keyframes.size(); }
+
+private:
+    std::vector<Keyframe> m_Keyframes{};
+};
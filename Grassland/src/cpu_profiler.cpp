@@ -0,0 +1,86 @@
+#include "cpu_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+std::array<CpuProfiler::Event, CpuProfiler::s_Capacity> CpuProfiler::s_Events{};
+std::atomic<uint64_t> CpuProfiler::s_WriteIndex{ 0 };
+std::atomic<uint32_t> CpuProfiler::s_NextThreadID{ 0 };
+std::atomic<bool> CpuProfiler::s_Enabled{ true };
+
+void CpuProfiler::record(const char* p_Name, const uint64_t p_StartNs, const uint64_t p_EndNs)
+{
+    if (!isEnabled())
+        return;
+
+    const uint64_t l_Index = s_WriteIndex.fetch_add(1, std::memory_order_relaxed);
+    Event& l_Event = s_Events[l_Index % s_Capacity];
+
+    // Invalidate the slot first so a concurrent dump doesn't pick up a half written event
+    l_Event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    l_Event.name = p_Name;
+    l_Event.startNs = p_StartNs;
+    l_Event.endNs = p_EndNs;
+    l_Event.threadID = getThreadID();
+    l_Event.sequence.store(l_Index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::dumpChromeTrace(const std::string_view p_Path)
+{
+    std::ofstream l_File{ std::string(p_Path) };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open CPU trace output file " + std::string(p_Path));
+
+    const uint64_t l_End = s_WriteIndex.load(std::memory_order_acquire);
+    const uint64_t l_Begin = l_End > s_Capacity ? l_End - s_Capacity : 0;
+
+    // Chrome expects microseconds, make them relative to the oldest event so the numbers stay readable
+    uint64_t l_Origin = UINT64_MAX;
+    for (uint64_t i = l_Begin; i < l_End; i++)
+    {
+        const Event& l_Event = s_Events[i % s_Capacity];
+        if (l_Event.sequence.load(std::memory_order_acquire) != i + 1)
+            continue;
+
+        const uint64_t l_Start = l_Event.startNs;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (l_Event.sequence.load(std::memory_order_relaxed) == i + 1)
+            l_Origin = std::min(l_Origin, l_Start);
+    }
+
+    l_File << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool l_First = true;
+    for (uint64_t i = l_Begin; i < l_End; i++)
+    {
+        const Event& l_Event = s_Events[i % s_Capacity];
+        if (l_Event.sequence.load(std::memory_order_acquire) != i + 1)
+            continue;
+
+        const char* l_Name = l_Event.name;
+        const uint64_t l_Start = l_Event.startNs;
+        const uint64_t l_Duration = l_Event.endNs - l_Event.startNs;
+        const uint32_t l_Thread = l_Event.threadID;
+        // The slot may have been overwritten while it was being read, the fence keeps the copies above before the re-check
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (l_Event.sequence.load(std::memory_order_relaxed) != i + 1)
+            continue;
+
+        if (!l_First)
+            l_File << ",\n";
+        l_First = false;
+        l_File << "{\"name\": \"" << l_Name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << l_Thread
+               << ", \"ts\": " << static_cast<double>(l_Start - l_Origin) / 1000.0
+               << ", \"dur\": " << static_cast<double>(l_Duration) / 1000.0 << "}";
+    }
+    l_File << "\n]}\n";
+}
+
+uint32_t CpuProfiler::getThreadID()
+{
+    thread_local const uint32_t l_ThreadID = s_NextThreadID.fetch_add(1, std::memory_order_relaxed);
+    return l_ThreadID;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+// Scoped CPU zones recorded into a fixed size lock-free ring buffer. Any thread can record, older events are
+// overwritten once the ring wraps around. Zone names must outlive the profiler (string literals)
+class CpuProfiler
+{
+public:
+    static constexpr uint32_t s_Capacity = 1 << 16;
+
+    class ScopedZone
+    {
+    public:
+        explicit ScopedZone(const char* p_Name) : m_Name(p_Name), m_Start(now()) {}
+        ~ScopedZone() { record(m_Name, m_Start, now()); }
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+        const char* m_Name;
+        uint64_t m_Start;
+    };
+
+    static void setEnabled(const bool p_Enabled) { s_Enabled.store(p_Enabled, std::memory_order_relaxed); }
+    [[nodiscard]] static bool isEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+    static void record(const char* p_Name, uint64_t p_StartNs, uint64_t p_EndNs);
+
+    // Writes every event still in the ring as Chrome trace-event JSON (chrome://tracing, Perfetto)
+    static void dumpChromeTrace(std::string_view p_Path);
+
+    [[nodiscard]] static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    struct Event
+    {
+        // Index + 1 of the write that last completed this slot, lets readers skip slots that are mid-write
+        std::atomic<uint64_t> sequence{ 0 };
+        const char* name = nullptr;
+        uint64_t startNs = 0;
+        uint64_t endNs = 0;
+        uint32_t threadID = 0;
+    };
+
+    [[nodiscard]] static uint32_t getThreadID();
+
+    static std::array<Event, s_Capacity> s_Events;
+    static std::atomic<uint64_t> s_WriteIndex;
+    static std::atomic<uint32_t> s_NextThreadID;
+    static std::atomic<bool> s_Enabled;
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_ZONE(p_Name) const CpuProfiler::ScopedZone CPU_PROFILE_CONCAT(l_CpuProfileZone, __LINE__){ p_Name }
@@ -1,5 +1,6 @@
 #include "engine.hpp"
 
+#include <algorithm>
 #include <array>
 
 #include <imgui.h>
@@ -7,6 +8,9 @@
 #include <backends/imgui_impl_vulkan.h>
 
 #include "camera.hpp"
+#include "cpu_profiler.hpp"
+#include "mesh_shader_extension.hpp"
+#include "timeline_semaphore_extension.hpp"
 
 #include "vertex.hpp"
 #include "vulkan_binding.hpp"
@@ -46,14 +50,21 @@ static VulkanGPU chooseCorrectGPU()
     throw std::runtime_error("No discrete GPU found");
 }
 
-Engine::Engine()
-    : m_Window("Vulkan", 1920, 1080), m_Camera(glm::vec3{0.f, -20.f, 0.f}, glm::vec3{0.f, 0.f, -1.f})
+Engine::Engine(const EngineSettings& p_Settings)
+    : m_Settings(p_Settings), m_Camera(glm::vec3{0.f, -20.f, 0.f}, glm::vec3{0.f, 0.f, -1.f})
 {
     // Vulkan Instance
     Logger::setRootContext("Engine init");
 
-    std::vector<const char*> l_RequiredExtensions{ m_Window.getRequiredVulkanExtensionCount() };
-    m_Window.getRequiredVulkanExtensions(l_RequiredExtensions.data());
+    if (!m_Settings.headless)
+        m_Window.open("Vulkan", 1920, 1080);
+
+    std::vector<const char*> l_RequiredExtensions{};
+    if (!m_Settings.headless)
+    {
+        l_RequiredExtensions.resize(m_Window.getRequiredVulkanExtensionCount());
+        m_Window.getRequiredVulkanExtensions(l_RequiredExtensions.data());
+    }
 #ifndef _DEBUG
     Logger::setLevels(Logger::WARN | Logger::ERR);
     VulkanContext::init(VK_API_VERSION_1_3, false, false, l_RequiredExtensions);
@@ -66,7 +77,8 @@ Engine::Engine()
     VulkanContext::initializeArenaMemory(1LL * 1024 * 1024);
 
     // Vulkan Surface
-    m_Window.createSurface(VulkanContext::getHandle());
+    if (!m_Settings.headless)
+        m_Window.createSurface(VulkanContext::getHandle());
 
     // Choose Physical Device
     const VulkanGPU l_GPU = chooseCorrectGPU();
@@ -77,101 +89,198 @@ Engine::Engine()
 
     const QueueFamily l_GraphicsQueueFamily = l_QueueStructure.findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
     const QueueFamily l_ComputeQueueFamily = l_QueueStructure.findQueueFamily(VK_QUEUE_COMPUTE_BIT);
-    const QueueFamily l_PresentQueueFamily = l_QueueStructure.findPresentQueueFamily(m_Window.getSurface());
     const QueueFamily l_TransferQueueFamily = l_QueueStructure.findQueueFamily(VK_QUEUE_TRANSFER_BIT);
 
     // Select Queue Families and assign queues
     QueueFamilySelector l_Selector{ l_QueueStructure };
     l_Selector.selectQueueFamily(l_GraphicsQueueFamily, QueueFamilyTypeBits::GRAPHICS);
     l_Selector.selectQueueFamily(l_ComputeQueueFamily, QueueFamilyTypeBits::COMPUTE);
-    l_Selector.selectQueueFamily(l_PresentQueueFamily, QueueFamilyTypeBits::PRESENT);
     m_GraphicsQueuePos = l_Selector.getOrAddQueue(l_GraphicsQueueFamily, 1.0);
     m_ComputeQueuePos = l_Selector.getOrAddQueue(l_ComputeQueueFamily, 1.0);
-    m_PresentQueuePos = l_Selector.getOrAddQueue(l_PresentQueueFamily, 1.0);
+    if (!m_Settings.headless)
+    {
+        const QueueFamily l_PresentQueueFamily = l_QueueStructure.findPresentQueueFamily(m_Window.getSurface());
+        l_Selector.selectQueueFamily(l_PresentQueueFamily, QueueFamilyTypeBits::PRESENT);
+        m_PresentQueuePos = l_Selector.getOrAddQueue(l_PresentQueueFamily, 1.0);
+    }
     m_TransferQueuePos = l_Selector.addQueue(l_TransferQueueFamily, 1.0);
     
     // Logical Device
     VulkanDeviceExtensionManager l_Extensions{};
-    l_Extensions.addExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME, new VulkanSwapchainExtension(m_DeviceID));
-    m_DeviceID = VulkanContext::createDevice(l_GPU, l_Selector, &l_Extensions, {.tessellationShader = true, .fillModeNonSolid = true});
+    if (!m_Settings.headless)
+        l_Extensions.addExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME, new VulkanSwapchainExtension(m_DeviceID));
+    l_Extensions.addExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, new TimelineSemaphoreExtension(m_DeviceID));
+    // Grass can then be drawn by task and mesh shaders, the instanced draw stays for every other GPU
+    m_MeshShaderSupported = MeshShaderExtension::isSupported(l_GPU.getHandle());
+    if (m_MeshShaderSupported)
+        l_Extensions.addExtension(VK_EXT_MESH_SHADER_EXTENSION_NAME, new MeshShaderExtension(m_DeviceID));
+    // Needed by the storage qualifiers of the reduced precision terrain formats
+    const VkBool32 l_ExtendedFormats = l_GPU.getFeatures().shaderStorageImageExtendedFormats;
+    m_DeviceID = VulkanContext::createDevice(l_GPU, l_Selector, &l_Extensions, {.tessellationShader = true, .fillModeNonSolid = true, .pipelineStatisticsQuery = l_GPU.getFeatures().pipelineStatisticsQuery,
+                                                                                .shaderStorageImageExtendedFormats = l_ExtendedFormats});
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
 
     // Swapchain
-    m_PresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
-    VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
-    m_SwapchainID = l_SwapchainExt->createSwapchain(m_Window.getSurface(), m_Window.getSize().toExtent2D(), { VK_FORMAT_R8G8B8A8_SRGB, VK_COLORSPACE_SRGB_NONLINEAR_KHR }, m_PresentMode);
-    VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
+    if (!m_Settings.headless)
+    {
+        m_PresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
+        m_SwapchainID = l_SwapchainExt->createSwapchain(m_Window.getSurface(), m_Window.getSize().toExtent2D(), { VK_FORMAT_R8G8B8A8_SRGB, VK_COLORSPACE_SRGB_NONLINEAR_KHR }, m_PresentMode);
+    }
+    const VkExtent2D l_RenderExtent = getRenderExtent();
 
     // Command Buffers
     l_Device.configureOneTimeQueue(m_TransferQueuePos);
     l_Device.initializeCommandPool(l_GraphicsQueueFamily, 0, true);
-    m_RenderCmdBufferID = l_Device.createCommandBuffer(l_GraphicsQueueFamily, 0, false);
     l_Device.initializeCommandPool(l_ComputeQueueFamily, 0, true);
-    m_HeightmapCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
-    m_GrassHeightCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
-    m_WindCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
-    m_ComputeCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
     l_Device.initializeCommandPool(l_TransferQueueFamily, 0, true);
-    m_TransferCmdBufferID = l_Device.createCommandBuffer(l_TransferQueueFamily, 0, false);
+    // Command pools can't be shared between threads, so every worker gets its own pool for the render task secondaries.
+    // They are made for every hardware thread so the worker count can change at runtime
+    for (uint32_t l_Thread = 1; l_Thread < WorkerPool::getMaxThreadCount(); l_Thread++)
+        l_Device.initializeCommandPool(l_GraphicsQueueFamily, l_Thread, true);
+
+    for (FrameResources& l_Frame : m_Frames)
+    {
+        l_Frame.renderCmdBufferID = l_Device.createCommandBuffer(l_GraphicsQueueFamily, 0, false);
+        l_Frame.heightmapCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
+        l_Frame.grassHeightCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
+        l_Frame.windCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
+        l_Frame.computeCmdBufferID = l_Device.createCommandBuffer(l_ComputeQueueFamily, 0, false);
+        l_Frame.transferCmdBufferID = l_Device.createCommandBuffer(l_TransferQueueFamily, 0, false);
+        for (uint32_t l_Thread = 0; l_Thread < WorkerPool::getMaxThreadCount(); l_Thread++)
+            for (uint32_t l_Task = 0; l_Task < RENDER_TASK_COUNT; l_Task++)
+                l_Frame.renderTaskCmdBufferIDs.push_back(l_Device.createCommandBuffer(l_GraphicsQueueFamily, l_Thread, true));
+    }
 
     // Depth Buffer
-    m_DepthBufferID = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_D32_SFLOAT, { l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, 0);
+    m_DepthBufferID = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_D32_SFLOAT, { l_RenderExtent.width, l_RenderExtent.height, 1 }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0);
     VulkanImage& l_DepthImage = l_Device.getImage(m_DepthBufferID);
     l_DepthImage.allocateFromFlags({ .desiredProperties= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired= false });
     m_DepthBufferViewID = l_DepthImage.createImageView(VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT);
 
     // Color Image
-    m_RenderImageID = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB, { l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, 0);
+    m_RenderImageID = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB, { l_RenderExtent.width, l_RenderExtent.height, 1 }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, 0);
     VulkanImage& l_RenderImage = l_Device.getImage(m_RenderImageID);
     l_RenderImage.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
     m_RenderImageViewID = l_RenderImage.createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
 
+    // Offscreen output image, replaces the swapchain image in the post process subpass
+    if (m_Settings.headless)
+    {
+        m_OffscreenImageID = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB, { l_RenderExtent.width, l_RenderExtent.height, 1 }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 0);
+        VulkanImage& l_OffscreenImage = l_Device.getImage(m_OffscreenImageID);
+        l_OffscreenImage.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+        m_OffscreenImageViewID = l_OffscreenImage.createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+
     l_Device.configureStagingBuffer(100LL * 1024 * 1024, m_TransferQueuePos);
 
     //Descriptor pool
     std::array<VkDescriptorPoolSize, 4> l_PoolSizes = {
-        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8},
-        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4},
-        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 32},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 6},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 36},
         VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 2}
     };
-    m_DescriptorPoolID = l_Device.createDescriptorPool(l_PoolSizes, 8, 0);
+    // The grass compute, toroidal compute and cull sets exist once per grass buffer set, the wind noise and grass sets once per wind image
+    // and the procedural grass sets once per buffer set and wind image
+    m_DescriptorPoolID = l_Device.createDescriptorPool(l_PoolSizes, 20, 0);
 
     // Renderpass and pipelines
     createRenderPasses();
 
     // Framebuffers
-    m_FramebufferIDs.resize(l_Swapchain.getImageCount());
-    for (uint32_t i = 0; i < l_Swapchain.getImageCount(); i++)
+    createFramebuffers();
+
+    // Sync objects
+    for (FrameResources& l_Frame : m_Frames)
+        l_Frame.renderFinishedSemaphoreID = l_Device.createSemaphore();
+    for (Timeline* l_Timeline : { &m_GraphicsTimeline, &m_ComputeTimeline, &m_TransferTimeline })
     {
-        VkImageView l_Color = *l_Swapchain.getImage(i).getImageView(l_Swapchain.getImageView(i));
-        const std::array<VkImageView, 3> l_Attachments = {
-            *l_Device.getImage(m_RenderImageID).getImageView(m_RenderImageViewID),
-            l_Color,
-            *l_Device.getImage(m_DepthBufferID).getImageView(m_DepthBufferViewID)
+        const VkSemaphoreTypeCreateInfo l_TypeInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = 0
+        };
+        const VkSemaphoreCreateInfo l_CreateInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &l_TypeInfo
         };
-        m_FramebufferIDs[i] = VulkanContext::getDevice(m_DeviceID).createFramebuffer({ l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, m_RenderPassID, l_Attachments);
+        if (vkCreateSemaphore(*l_Device, &l_CreateInfo, nullptr, &l_Timeline->semaphore) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create timeline semaphore");
     }
+    setFramesInFlight(m_Settings.framesInFlight);
+    m_BatchCompute = m_Settings.batchCompute;
+    m_ComputeBenchmark.begin(m_Settings.computeBenchmarkFrames);
 
-    // Sync objects
-    m_HeightmapFinishedSemaphoreID = l_Device.createSemaphore();
-    m_GrassHeightFinishedSemaphoreID = l_Device.createSemaphore();
-    m_WindFinishedSemaphoreID = l_Device.createSemaphore();
-    m_TransferFinishedSemaphoreID = l_Device.createSemaphore();
-    m_ComputeFinishedSemaphoreID = l_Device.createSemaphore();
-    m_RenderFinishedSemaphoreID = l_Device.createSemaphore();
+    if (l_GPU.getProperties().limits.timestampComputeAndGraphics)
+        m_GpuProfiler.initialize(*l_Device, l_GPU.getHandle());
+    else
+        Logger::print("GPU does not support timestamps on graphics and compute queues, GPU profiling is disabled", Logger::WARN);
+
+    if (l_GPU.getFeatures().pipelineStatisticsQuery)
+        m_PipelineStatistics.initialize(*l_Device);
+
+    m_WorkerPool.setThreadCount(m_Settings.workerThreads == 0 ? WorkerPool::getMaxThreadCount() : m_Settings.workerThreads);
+
+    // Linear filtering of R32 float and storage of the smaller formats are both optional, try every format from the requested one on
+    m_TerrainFormat = m_Settings.terrainFormat;
+    for (uint32_t i = 0; i < NoiseEngine::s_TerrainFormatCount; i++)
+    {
+        const auto l_Format = static_cast<NoiseEngine::TerrainFormat>((static_cast<uint32_t>(m_Settings.terrainFormat) + i) % NoiseEngine::s_TerrainFormatCount);
+        if (NoiseEngine::isTerrainFormatSupported(l_GPU.getHandle(), l_Format, isToroidalNoise()))
+        {
+            m_TerrainFormat = l_Format;
+            break;
+        }
+    }
+    if (m_TerrainFormat != m_Settings.terrainFormat)
+        Logger::print(std::string("GPU does not support the ") + NoiseEngine::getTerrainFormatName(m_Settings.terrainFormat) + " terrain format, using "
+                      + NoiseEngine::getTerrainFormatName(m_TerrainFormat), Logger::WARN);
 
-    m_RenderFenceID = l_Device.createFence(true);
-    m_ComputeFenceID = l_Device.createFence(false);
+    // The wind and grass height noise are sampled with linear filtering as well, they keep raw values so only R16 float can replace R32 float
+    if (!NoiseEngine::isTerrainFormatSupported(l_GPU.getHandle(), NoiseEngine::TerrainFormat::FULL, isToroidalNoise(), false))
+    {
+        if (!NoiseEngine::isTerrainFormatSupported(l_GPU.getHandle(), NoiseEngine::TerrainFormat::HALF, isToroidalNoise(), false))
+            throw std::runtime_error("GPU supports neither R32 nor R16 float linear filtering on storage images, the wind and grass height noise need one of them");
+        m_RawNoiseFormat = NoiseEngine::TerrainFormat::HALF;
+        Logger::print("GPU does not support R32 float linear filtering, the wind and grass height noise are stored as R16 float", Logger::WARN);
+    }
 
     m_NoiseEngine.initialize();
-    m_Heightmap.initialize(1024, *this, true);
+    m_Heightmap.initialize("Heightmap", 1024, *this, true, false, isToroidalNoise(), m_TerrainFormat);
+    if (m_Settings.noiseChunkCache)
+        m_Heightmap.createChunkCache();
 
     m_PlaneEngine.initialize();
+    m_HiZEngine.initialize();
     m_GrassEngine.initalize({7, 11, 17, 31}, {120, 100, 80, 60});
+    m_GrassEngine.setGpuCulling(m_Settings.gpuCulling || m_Settings.occlusionCulling);
+    m_GrassEngine.setOcclusionCulling(m_Settings.occlusionCulling);
+    m_GrassEngine.setCompactInstances(m_Settings.compactInstances);
+    m_GrassEngine.setToroidalInstances(m_Settings.toroidalInstances);
+    m_GrassEngine.setProceduralBlades(m_Settings.proceduralBlades);
+    if (m_Settings.meshShaders && !m_MeshShaderSupported)
+        Logger::print("GPU does not support VK_EXT_mesh_shader, grass is drawn with instanced draws", Logger::WARN);
+    m_GrassEngine.setMeshShaders(m_Settings.meshShaders);
     m_SkyboxEngine.initialize();
     m_PPFogEngine.initialize();
 
+    setLightDir(0.4f, 0.6f);
+
+    if (isBenchmarking())
+    {
+        m_CameraPath.load(m_Settings.cameraPathFile);
+        m_Benchmark.reserve(static_cast<size_t>(m_CameraPath.getDuration() / m_Settings.fixedDelta) + 1);
+    }
+
+    // There is nothing to interact with or display ImGui on when headless
+    if (m_Settings.headless)
+    {
+        m_ShowImGui = false;
+        return;
+    }
+
     initImgui();
     m_NoiseEngine.initializeImgui();
     m_Heightmap.initializeImgui();
@@ -183,8 +292,6 @@ Engine::Engine()
 
     m_Window.toggleMouseCapture();
 
-    setLightDir(0.4f, 0.6f);
-
     m_Window.getMouseMovedSignal().connect(&m_Camera, &Camera::mouseMoved);
     m_Window.getKeyPressedSignal().connect(&m_Camera, &Camera::keyPressed);
     m_Window.getKeyReleasedSignal().connect(&m_Camera, &Camera::keyReleased);
@@ -206,90 +313,173 @@ Engine::~Engine()
 
     Logger::setRootContext("Resource cleanup");
 
-    m_PlaneEngine.cleanupImgui();
-    m_Heightmap.cleanupImgui();
-    m_GrassEngine.cleanupImgui();
-    m_NoiseEngine.cleanupImgui();
+    if (!m_Settings.headless)
+    {
+        m_PlaneEngine.cleanupImgui();
+        m_Heightmap.cleanupImgui();
+        m_GrassEngine.cleanupImgui();
+        m_NoiseEngine.cleanupImgui();
+
+        ImGui_ImplVulkan_Shutdown();
+        m_Window.shutdownImgui();
+        ImGui::DestroyContext();
+    }
+
+    m_GpuProfiler.free();
+    m_PipelineStatistics.free();
 
-    ImGui_ImplVulkan_Shutdown();
-    m_Window.shutdownImgui();
-    ImGui::DestroyContext();
+    for (const Timeline* l_Timeline : { &m_GraphicsTimeline, &m_ComputeTimeline, &m_TransferTimeline })
+        vkDestroySemaphore(*VulkanContext::getDevice(m_DeviceID), l_Timeline->semaphore, nullptr);
 
     VulkanContext::freeDevice(m_DeviceID);
-    m_Window.free();
+    if (!m_Settings.headless)
+        m_Window.free();
     VulkanContext::free();
 }
 
 void Engine::run()
 {
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(l_Device);
-
-    VulkanFence& l_RenderFence = l_Device.getFence(m_RenderFenceID);
-    VulkanFence& l_ComputeFence = l_Device.getFence(m_ComputeFenceID);
+    VulkanSwapchainExtension* l_SwapchainExt = m_Settings.headless ? nullptr : VulkanSwapchainExtension::get(l_Device);
 
     std::chrono::high_resolution_clock::time_point l_Frame = std::chrono::high_resolution_clock::now();
 
     m_CurrentFrame = 0;
-    while (!m_Window.shouldClose())
+    m_PathTime = 0.f;
+    if (isBenchmarking())
+        m_Delta = m_Settings.fixedDelta;
+
+    while (!shouldClose())
     {
-        m_Window.pollEvents();
-        if (m_Window.isMinimized())
-            continue;
+        CPU_PROFILE_ZONE("Frame");
 
-        update();
-        
-        if (m_MustWaitForGrass)
+        if (!m_Settings.headless)
         {
-            l_ComputeFence.wait();
-            l_ComputeFence.reset();
-            m_MustWaitForGrass = false;
+            {
+                CPU_PROFILE_ZONE("Poll events");
+                m_Window.pollEvents();
+            }
+            if (m_Window.isMinimized())
+                continue;
         }
 
-        const bool l_RenderedGrassHeight = computeGrassHeight();
-        const bool l_TransferredCullData = transferCulling();
+        const std::chrono::high_resolution_clock::time_point l_FrameStart = std::chrono::high_resolution_clock::now();
+        m_FrameWaitTime = std::chrono::duration<float, std::milli>{ 0.f };
+        m_FrameSubmits = 0;
 
-        l_RenderFence.wait();
-        l_RenderFence.reset();
+        // The replayed pose overrides any input processed by the window
+        if (isBenchmarking())
+        {
+            const CameraPath::Keyframe l_Keyframe = m_CameraPath.sample(m_PathTime);
+            m_Camera.setPosition(l_Keyframe.position);
+            m_Camera.setDir(l_Keyframe.direction);
+        }
+        if (m_ComputeBenchmark.isRunning())
+        {
+            m_Camera.setPosition(m_Camera.getPosition() + glm::vec3{ m_PlaneEngine.getTileSize(), 0.f, 0.f });
+            m_BatchCompute = m_ComputeBenchmark.isBatched(m_CurrentFrame);
+        }
 
-        const bool l_RenderedHeightmap = computeHeightmap();
-        const bool l_RenderedWind = computeWind();
+        update();
 
-        // Record
-        bool l_ComputedGrass;
+        // Only the frame that used this slot m_FramesInFlight frames ago has to be done, the ones after it keep running
+        m_FrameSlot = m_CurrentFrame % m_FramesInFlight;
+        if (m_CurrentFrame >= m_FramesInFlight)
+            waitForFrame(m_CurrentFrame - m_FramesInFlight);
+
+        // Headless frames always render to the single offscreen framebuffer and skip acquire/present.
+        // Acquiring comes before any of this frame's submissions, a failed acquire can then retry without anything pending
+        uint32_t l_ImageIndex = 0;
+        ResourceID l_ImageSemaphore = UINT32_MAX;
+        if (!m_Settings.headless)
         {
-            l_ComputedGrass = updateGrass(l_RenderedGrassHeight, l_TransferredCullData, l_RenderedHeightmap);
+            CPU_PROFILE_ZONE("Acquire image");
+            VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
+            l_ImageIndex = l_Swapchain.acquireNextImage();
+            if (l_ImageIndex == UINT32_MAX)
+                continue;
+            l_ImageSemaphore = l_Swapchain.getImgSemaphore();
         }
 
-        VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
-        const uint32_t l_ImageIndex = l_Swapchain.acquireNextImage();
-        if (l_ImageIndex == UINT32_MAX)
-            continue;
-
+        // An empty display still renders the frame without the UI so the timelines and the frame index move on
         ImDrawData* l_ImguiDrawData = nullptr;
         if (m_ShowImGui)
         {
             l_ImguiDrawData = ImGui::GetDrawData();
-
             if (l_ImguiDrawData->DisplaySize.x <= 0.0f || l_ImguiDrawData->DisplaySize.y <= 0.0f)
-                continue;
+                l_ImguiDrawData = nullptr;
         }
 
+        m_GpuProfiler.beginFrame(m_CurrentFrame);
+        m_PipelineStatistics.beginFrame();
+
+        // Every submission of that frame is finished once its render signaled the graphics timeline
+        if (m_GpuProfiler.collectFrame(m_FramesInFlight))
+        {
+            if (isBenchmarking())
+                m_Benchmark.setGpuTime(m_GpuProfiler.getLastCollectedFrame(), m_GpuProfiler.getLastCollectedTotal());
+            m_ComputeBenchmark.setGpuTime(m_GpuProfiler.getLastCollectedFrame(), m_GpuProfiler.getLastCollectedTotal());
+        }
+        m_PipelineStatistics.collectFrame(m_FramesInFlight);
+
+        m_GrassEngine.readBackCulling();
+
+        // Record
+        const std::chrono::high_resolution_clock::time_point l_ComputeStart = std::chrono::high_resolution_clock::now();
+        ComputeJobs l_ComputeJobs = m_BatchCompute ? submitBatchedCompute() : submitComputeJobs();
+        // Everything this frame's render reads is submitted, the wind is submitted after it for the next frame
+        m_RenderComputeValue = m_ComputeTimeline.value;
+        const bool l_WindAhead = m_GrassEngine.isWindAhead();
+        l_ComputeJobs.wind = computeWind();
+        if (!l_WindAhead)
+            m_RenderComputeValue = m_ComputeTimeline.value;
+        const std::chrono::duration<float, std::milli> l_ComputeTime = std::chrono::high_resolution_clock::now() - l_ComputeStart;
+
         // Render
-        render(l_ImageIndex, l_ImguiDrawData, l_Swapchain.getImgSemaphore(), l_RenderedHeightmap, l_ComputedGrass, l_RenderedWind);
+        render(l_ImageIndex, l_ImguiDrawData, l_ImageSemaphore);
 
         // Present
+        if (!m_Settings.headless)
+        {
+            CPU_PROFILE_ZONE("Present");
+            std::array<ResourceID, 1> l_Semaphores = { getFrame().renderFinishedSemaphoreID };
+            l_SwapchainExt->getSwapchain(m_SwapchainID).present(m_PresentQueuePos, l_Semaphores);
+        }
+
+        const std::chrono::duration<float, std::milli> l_FrameTime = std::chrono::high_resolution_clock::now() - l_FrameStart;
+        m_ComputeBenchmark.addFrame(m_CurrentFrame, m_FrameSubmits, (l_ComputeTime - m_FrameWaitTime).count(), l_FrameTime.count());
+        if (isBenchmarking())
         {
-            std::array<ResourceID, 1> l_Semaphores = { m_RenderFinishedSemaphoreID };
-            l_Swapchain.present(m_PresentQueuePos, l_Semaphores);
+            m_Benchmark.pushFrame({
+                .frame = m_CurrentFrame,
+                .time = m_PathTime,
+                .cpuMs = (l_FrameTime - m_FrameWaitTime).count(),
+                .frameMs = l_FrameTime.count(),
+                .postCullTiles = m_GrassEngine.getPostCullTileCount(),
+                .postCullInstances = m_GrassEngine.getPostCullInstanceCount(),
+                .grassHeight = l_ComputeJobs.grassHeight,
+                .cullingTransfer = l_ComputeJobs.cullingTransfer,
+                .heightmap = l_ComputeJobs.heightmap,
+                .wind = l_ComputeJobs.wind,
+                .grass = l_ComputeJobs.grass
+            });
         }
+        if (isRecordingPath())
+            m_RecordedPath.addKeyframe(m_PathTime, m_Camera.getPosition(), m_Camera.getDir());
 
         VulkanContext::resetTransMemory();
         m_CurrentFrame++;
         std::chrono::high_resolution_clock::time_point l_Prev = l_Frame;
         l_Frame = std::chrono::high_resolution_clock::now();
-        m_Delta = std::chrono::duration<float>(l_Frame - l_Prev).count();
+        if (!isBenchmarking())
+            m_Delta = std::chrono::duration<float>(l_Frame - l_Prev).count();
+        m_PathTime += m_Delta;
     }
+
+    finishBenchmark();
+
+    if (!m_Settings.cpuTraceFile.empty())
+        CpuProfiler::dumpChromeTrace(m_Settings.cpuTraceFile);
 }
 
 VulkanDevice& Engine::getDevice() const
@@ -302,6 +492,55 @@ VulkanSwapchain& Engine::getSwapchain() const
     return VulkanSwapchainExtension::get(m_DeviceID)->getSwapchain(m_SwapchainID);
 }
 
+VkExtent2D Engine::getRenderExtent() const
+{
+    if (m_Settings.headless)
+        return m_Settings.headlessExtent;
+    return getSwapchain().getExtent();
+}
+
+bool Engine::shouldClose() const
+{
+    if (isBenchmarking() && m_PathTime > m_CameraPath.getDuration())
+        return true;
+    if (m_ComputeBenchmark.isFinished(m_CurrentFrame))
+        return true;
+    if (m_Settings.headless)
+        return m_Settings.headlessFrameCount != 0 && m_CurrentFrame >= m_Settings.headlessFrameCount;
+    return m_Window.shouldClose();
+}
+
+void Engine::finishBenchmark()
+{
+    if (!isBenchmarking() && !isRecordingPath() && !m_ComputeBenchmark.isRunning())
+        return;
+
+    VulkanContext::getDevice(m_DeviceID).waitIdle();
+
+    // The last frames in flight were never collected by the loop, oldest first
+    for (uint32_t l_FramesAgo = m_FramesInFlight; l_FramesAgo-- > 0;)
+    {
+        if (m_GpuProfiler.collectFrame(l_FramesAgo))
+        {
+            m_Benchmark.setGpuTime(m_GpuProfiler.getLastCollectedFrame(), m_GpuProfiler.getLastCollectedTotal());
+            m_ComputeBenchmark.setGpuTime(m_GpuProfiler.getLastCollectedFrame(), m_GpuProfiler.getLastCollectedTotal());
+        }
+    }
+
+    if (m_ComputeBenchmark.isRunning())
+        m_ComputeBenchmark.print();
+    if (isBenchmarking())
+    {
+        m_Benchmark.write(m_Settings.benchmarkOutputFile);
+        std::cout << "Benchmark of " << m_Benchmark.getFrames().size() << " frames written to " << m_Settings.benchmarkOutputFile << '\n';
+    }
+    if (isRecordingPath())
+    {
+        m_RecordedPath.save(m_Settings.recordPathFile);
+        std::cout << "Camera path of " << m_RecordedPath.getKeyframeCount() << " keyframes written to " << m_Settings.recordPathFile << '\n';
+    }
+}
+
 void Engine::setLightDir(const float p_Azimuth, const float p_Altitude)
 {
     m_LightDirAltitude = p_Altitude;
@@ -327,6 +566,8 @@ float Engine::getDelta() const
 
 void Engine::update()
 {
+    CPU_PROFILE_ZONE("Update");
+
     if (m_ShowImGui)
         Engine::drawImgui();
 
@@ -358,9 +599,9 @@ void Engine::createRenderPasses()
     Logger::pushContext("Create RenderPass");
     VulkanRenderPassBuilder l_Builder{};
     
-    VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
-    const VkFormat l_Format = l_SwapchainExt->getSwapchain(m_SwapchainID).getFormat().format;
-
+    const VkFormat l_Format = m_Settings.headless ? VK_FORMAT_R8G8B8A8_SRGB : getSwapchain().getFormat().format;
+    // The offscreen target is left ready to be copied out instead of presented
+    const VkImageLayout l_OutputLayout = m_Settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     
     const VkAttachmentDescription l_ColorAttachment = VulkanRenderPassBuilder::createAttachment(l_Format,
         VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE,
@@ -368,11 +609,12 @@ void Engine::createRenderPasses()
     l_Builder.addAttachment(l_ColorAttachment);
     const VkAttachmentDescription l_PresentAttachment = VulkanRenderPassBuilder::createAttachment(l_Format,
         VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_STORE,
-        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        VK_IMAGE_LAYOUT_UNDEFINED, l_OutputLayout);
     l_Builder.addAttachment(l_PresentAttachment);
+    // Depth is kept after the pass so the Hi-Z pyramid can be built from it
     const VkAttachmentDescription l_DepthAttachment = VulkanRenderPassBuilder::createAttachment(VK_FORMAT_D32_SFLOAT,
-        VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     l_Builder.addAttachment(l_DepthAttachment);
 
     const std::array<VulkanRenderPassBuilder::AttachmentReference, 2> l_RenderReferences = {
@@ -388,13 +630,15 @@ void Engine::createRenderPasses()
     };
     l_Builder.addSubpass(l_PostProcessReferences, 0);
 
+    // The color and depth targets are shared by every frame in flight, so the pass also waits for the previous one
+    // on the queue to stop writing them and for its fog pass and Hi-Z build to stop reading them
     VkSubpassDependency l_ExternalDependency{};
     l_ExternalDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     l_ExternalDependency.dstSubpass = 0;
-    l_ExternalDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    l_ExternalDependency.srcAccessMask = 0;
-    l_ExternalDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    l_ExternalDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    l_ExternalDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    l_ExternalDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    l_ExternalDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    l_ExternalDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
     l_Builder.addDependency(l_ExternalDependency);
 
     VkSubpassDependency l_PostProcessDependency;
@@ -407,59 +651,265 @@ void Engine::createRenderPasses()
     l_PostProcessDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
     l_Builder.addDependency(l_PostProcessDependency);
 
+    // The Hi-Z build runs on the same command buffer right after the pass
+    VkSubpassDependency l_HiZDependency{};
+    l_HiZDependency.srcSubpass = 1;
+    l_HiZDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    l_HiZDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    l_HiZDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    l_HiZDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    l_HiZDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    l_Builder.addDependency(l_HiZDependency);
+
     m_RenderPassID = VulkanContext::getDevice(m_DeviceID).createRenderPass(l_Builder, 0);
     Logger::popContext();
 }
 
-void Engine::render(const uint32_t l_ImageIndex, ImDrawData* p_ImGuiDrawData, const ResourceID p_SwapchainSemaphore, const bool p_RenderedHeightmap, const bool p_ComputedGrass, const bool p_RenderedWind)
+void Engine::render(const uint32_t l_ImageIndex, ImDrawData* p_ImGuiDrawData, const ResourceID p_SwapchainSemaphore)
 {
+    CPU_PROFILE_ZONE("Record render");
+
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    FrameResources& l_Frame = getFrame();
 
-    VulkanCommandBuffer& p_CmdBuffer = VulkanContext::getDevice(m_DeviceID).getCommandBuffer(m_RenderCmdBufferID, 0);
+    VulkanCommandBuffer& p_CmdBuffer = VulkanContext::getDevice(m_DeviceID).getCommandBuffer(l_Frame.renderCmdBufferID, 0);
     
-    const VkExtent2D& extent = getSwapchain().getExtent();
+    const VkExtent2D extent = getRenderExtent();
 
     std::array<VkClearValue, 3> clearValues;
     clearValues[1].color = clearValues[0].color = { {0.0f, 1.0f, 1.0f, 1.0f} };
     clearValues[2].depthStencil = { .depth= 1.0f, .stencil= 0};
 
     p_CmdBuffer.beginRecording();
-    p_CmdBuffer.cmdBeginRenderPass(m_RenderPassID, m_FramebufferIDs[l_ImageIndex], extent, clearValues);
+    // One zone per render task, every one of them is recorded inside the render pass
+    m_GpuProfiler.cmdResetZones(p_CmdBuffer, RENDER_TASK_COUNT);
+    m_PipelineStatistics.cmdResetGraphics(p_CmdBuffer);
+
+    // The device's resource lookups are not made for concurrent use, so every handle the passes need is resolved
+    // here before the fan out and the workers only record
+    RenderTaskHandles l_Handles{
+        .renderPass = *l_Device.getRenderPass(m_RenderPassID),
+        .framebuffer = *l_Device.getFramebuffer(m_FramebufferIDs[l_ImageIndex])
+    };
+    l_Handles.cmdBuffers.reserve(l_Frame.renderTaskCmdBufferIDs.size());
+    for (uint32_t i = 0; i < l_Frame.renderTaskCmdBufferIDs.size(); i++)
+        l_Handles.cmdBuffers.push_back(&l_Device.getCommandBuffer(l_Frame.renderTaskCmdBufferIDs[i], i / RENDER_TASK_COUNT));
+    m_SkyboxEngine.prepareRender();
+    m_PlaneEngine.prepareRender();
+    m_GrassEngine.prepareRender();
+    m_PPFogEngine.prepareRender();
+
+    // Each pass is recorded into its own secondary command buffer by whichever worker picks it up
+    std::array<VkCommandBuffer, RENDER_TASK_COUNT> l_TaskBuffers{};
+    {
+        CPU_PROFILE_ZONE("Record render tasks");
+        m_WorkerPool.parallelFor(RENDER_TASK_COUNT, [&](const uint32_t p_Task, const uint32_t p_Thread)
+        {
+            l_TaskBuffers[p_Task] = recordRenderTask(static_cast<RenderTask>(p_Task), p_Thread, l_Handles, p_ImGuiDrawData);
+        });
+    }
 
-    m_SkyboxEngine.render(p_CmdBuffer);
-    m_PlaneEngine.render(p_CmdBuffer);
-    m_GrassEngine.render(p_CmdBuffer);
+    const VkRenderPassBeginInfo l_RenderPassInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = l_Handles.renderPass,
+        .framebuffer = l_Handles.framebuffer,
+        .renderArea = { { 0, 0 }, extent },
+        .clearValueCount = static_cast<uint32_t>(clearValues.size()),
+        .pClearValues = clearValues.data()
+    };
+    vkCmdBeginRenderPass(*p_CmdBuffer, &l_RenderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(*p_CmdBuffer, RENDER_FOG, l_TaskBuffers.data());
+    vkCmdNextSubpass(*p_CmdBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    vkCmdExecuteCommands(*p_CmdBuffer, RENDER_TASK_COUNT - RENDER_FOG, l_TaskBuffers.data() + RENDER_FOG);
+    p_CmdBuffer.cmdEndRenderPass();
 
-    p_CmdBuffer.cmdNextSubpass();
+    m_HiZEngine.recordBuild(p_CmdBuffer);
 
-    m_PPFogEngine.render(p_CmdBuffer);
+    p_CmdBuffer.endRecording();
 
-    if (p_ImGuiDrawData)
-        ImGui_ImplVulkan_RenderDrawData(p_ImGuiDrawData, *p_CmdBuffer);
+    // Covers every compute submission of this frame but the wind, the first reader of their results is the indirect draw
+    const std::array<TimelineWait, 1> l_Waits{ { { &m_ComputeTimeline, m_RenderComputeValue, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT } } };
 
-    p_CmdBuffer.cmdEndRenderPass();
-    p_CmdBuffer.endRecording();
+    // Nothing waits on the render when there is no present, so the binary semaphore would never be unsignaled
+    if (m_Settings.headless)
+    {
+        submit(p_CmdBuffer, m_GraphicsQueuePos, m_GraphicsTimeline, l_Waits);
+        return;
+    }
+
+    submit(p_CmdBuffer, m_GraphicsQueuePos, m_GraphicsTimeline, l_Waits, *l_Device.getSemaphore(p_SwapchainSemaphore), *l_Device.getSemaphore(l_Frame.renderFinishedSemaphoreID));
+}
+
+VkCommandBuffer Engine::recordRenderTask(const RenderTask p_Task, const uint32_t p_Thread, const RenderTaskHandles& p_Handles, ImDrawData* p_ImGuiDrawData)
+{
+    CPU_PROFILE_ZONE("Record render task");
+
+    // Runs on a worker, everything from the device comes from p_Handles and the passes' prepareRender
+    VulkanCommandBuffer& l_CmdBuffer = *p_Handles.cmdBuffers[p_Thread * RENDER_TASK_COUNT + p_Task];
 
-    std::vector<VulkanCommandBuffer::WaitSemaphoreData> l_WaitSemaphores;
-    l_WaitSemaphores.emplace_back(p_SwapchainSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    if (p_ComputedGrass)
-        l_WaitSemaphores.emplace_back(m_ComputeFinishedSemaphoreID, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    else if (p_RenderedHeightmap)
-        l_WaitSemaphores.emplace_back(m_HeightmapFinishedSemaphoreID, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    if (p_RenderedWind)
-        l_WaitSemaphores.emplace_back(m_WindFinishedSemaphoreID, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    const VkCommandBufferInheritanceInfo l_InheritanceInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = p_Handles.renderPass,
+        .subpass = p_Task >= RENDER_FOG ? 1u : 0u,
+        .framebuffer = p_Handles.framebuffer
+    };
+    const VkCommandBufferBeginInfo l_BeginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &l_InheritanceInfo
+    };
+    l_CmdBuffer.reset();
+    vkBeginCommandBuffer(*l_CmdBuffer, &l_BeginInfo);
+
+    // Secondary buffers inherit no dynamic state, every pass sets its own viewport and scissor
+    const uint32_t l_GraphicsFamily = m_GraphicsQueuePos.familyIndex;
+    uint32_t l_Zone = UINT32_MAX;
+    switch (p_Task)
+    {
+    case RENDER_SKYBOX:
+        l_Zone = m_GpuProfiler.cmdBeginZone(l_CmdBuffer, "Skybox", l_GraphicsFamily);
+        m_PipelineStatistics.cmdBeginGraphics(l_CmdBuffer, PipelineStatistics::SKYBOX);
+        m_SkyboxEngine.render(l_CmdBuffer);
+        m_PipelineStatistics.cmdEndGraphics(l_CmdBuffer, PipelineStatistics::SKYBOX);
+        break;
+    case RENDER_TERRAIN:
+        l_Zone = m_GpuProfiler.cmdBeginZone(l_CmdBuffer, "Terrain", l_GraphicsFamily);
+        m_PipelineStatistics.cmdBeginGraphics(l_CmdBuffer, PipelineStatistics::TERRAIN);
+        m_PlaneEngine.render(l_CmdBuffer);
+        m_PipelineStatistics.cmdEndGraphics(l_CmdBuffer, PipelineStatistics::TERRAIN);
+        break;
+    case RENDER_GRASS:
+        l_Zone = m_GpuProfiler.cmdBeginZone(l_CmdBuffer, "Grass", l_GraphicsFamily);
+        m_GrassEngine.render(l_CmdBuffer);
+        break;
+    case RENDER_FOG:
+        l_Zone = m_GpuProfiler.cmdBeginZone(l_CmdBuffer, "Fog", l_GraphicsFamily);
+        m_PipelineStatistics.cmdBeginGraphics(l_CmdBuffer, PipelineStatistics::FOG);
+        m_PPFogEngine.render(l_CmdBuffer);
+        m_PipelineStatistics.cmdEndGraphics(l_CmdBuffer, PipelineStatistics::FOG);
+        break;
+    case RENDER_IMGUI:
+        // Left empty when there's no UI, the subpass only takes secondary buffers anyway
+        if (p_ImGuiDrawData)
+        {
+            l_Zone = m_GpuProfiler.cmdBeginZone(l_CmdBuffer, "ImGui", l_GraphicsFamily);
+            ImGui_ImplVulkan_RenderDrawData(p_ImGuiDrawData, *l_CmdBuffer);
+        }
+        break;
+    default:
+        break;
+    }
+    m_GpuProfiler.cmdEndZone(l_CmdBuffer, l_Zone);
+
+    vkEndCommandBuffer(*l_CmdBuffer);
+    return *l_CmdBuffer;
+}
+
+Engine::TimelineWait Engine::getPreviousRenderWait(const VkPipelineStageFlags p_Stage) const
+{
+    // Frame N - 1 is done rendering once the graphics timeline reaches N, the first frame waits on the initial value
+    return { &m_GraphicsTimeline, m_CurrentFrame, p_Stage };
+}
+
+void Engine::waitForFrame(const uint32_t p_Frame)
+{
+    const uint64_t l_Value = static_cast<uint64_t>(p_Frame) + 1;
+    const VkSemaphoreWaitInfo l_WaitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_GraphicsTimeline.semaphore,
+        .pValues = &l_Value
+    };
+
+    CPU_PROFILE_ZONE("Wait frame");
+    const std::chrono::high_resolution_clock::time_point l_WaitStart = std::chrono::high_resolution_clock::now();
+    vkWaitSemaphores(*getDevice(), &l_WaitInfo, UINT64_MAX);
+    m_FrameWaitTime += std::chrono::high_resolution_clock::now() - l_WaitStart;
+}
+
+bool Engine::isFrameFinished(const uint32_t p_Frame) const
+{
+    if (p_Frame >= m_CurrentFrame)
+        return false;
+
+    // The render waits on every other queue's work of its frame, so the graphics timeline covers the whole frame
+    uint64_t l_Value = 0;
+    vkGetSemaphoreCounterValue(*getDevice(), m_GraphicsTimeline.semaphore, &l_Value);
+    return l_Value > p_Frame;
+}
+
+void Engine::submit(const VulkanCommandBuffer& p_CmdBuffer, const QueueSelection p_Queue, Timeline& p_Signal, const std::span<const TimelineWait> p_Waits, const VkSemaphore p_BinaryWait, const VkSemaphore p_BinarySignal)
+{
+    std::array<VkSemaphore, s_MaxSubmitWaits + 1> l_WaitSemaphores{};
+    std::array<uint64_t, s_MaxSubmitWaits + 1> l_WaitValues{};
+    std::array<VkPipelineStageFlags, s_MaxSubmitWaits + 1> l_WaitStages{};
+    // A dropped wait would be a silent race with the pass it depends on
+    if (p_Waits.size() > s_MaxSubmitWaits)
+        throw std::runtime_error("Submission waits on more timelines than s_MaxSubmitWaits");
+
+    uint32_t l_WaitCount = 0;
+    for (const TimelineWait& l_Wait : p_Waits)
+    {
+        l_WaitSemaphores[l_WaitCount] = l_Wait.timeline->semaphore;
+        l_WaitValues[l_WaitCount] = l_Wait.value;
+        l_WaitStages[l_WaitCount] = l_Wait.stage;
+        l_WaitCount++;
+    }
+    // Values of binary semaphores are ignored
+    if (p_BinaryWait != VK_NULL_HANDLE)
+    {
+        l_WaitSemaphores[l_WaitCount] = p_BinaryWait;
+        l_WaitStages[l_WaitCount] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        l_WaitCount++;
+    }
+
+    p_Signal.value++;
+    const std::array<VkSemaphore, 2> l_SignalSemaphores{ p_Signal.semaphore, p_BinarySignal };
+    const std::array<uint64_t, 2> l_SignalValues{ p_Signal.value, 0 };
+    const uint32_t l_SignalCount = p_BinarySignal != VK_NULL_HANDLE ? 2 : 1;
+
+    const VkTimelineSemaphoreSubmitInfo l_TimelineInfo{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .waitSemaphoreValueCount = l_WaitCount,
+        .pWaitSemaphoreValues = l_WaitValues.data(),
+        .signalSemaphoreValueCount = l_SignalCount,
+        .pSignalSemaphoreValues = l_SignalValues.data()
+    };
+    const VkCommandBuffer l_CmdBuffer = *p_CmdBuffer;
+    const VkSubmitInfo l_SubmitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &l_TimelineInfo,
+        .waitSemaphoreCount = l_WaitCount,
+        .pWaitSemaphores = l_WaitSemaphores.data(),
+        .pWaitDstStageMask = l_WaitStages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &l_CmdBuffer,
+        .signalSemaphoreCount = l_SignalCount,
+        .pSignalSemaphores = l_SignalSemaphores.data()
+    };
+    if (vkQueueSubmit(*getDevice().getQueue(p_Queue), 1, &l_SubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        throw std::runtime_error("Failed to submit command buffer");
+    m_FrameSubmits++;
+}
 
-    const VulkanQueue l_GraphicsQueue = l_Device.getQueue(m_GraphicsQueuePos);
-    VulkanCommandBuffer& l_GraphicsBuffer = l_Device.getCommandBuffer(m_RenderCmdBufferID, 0);
+void Engine::setFramesInFlight(const uint32_t p_Count)
+{
+    const uint32_t l_Count = std::clamp(p_Count, 1u, s_MaxFramesInFlight);
+    if (l_Count == m_FramesInFlight)
+        return;
 
-    const std::array<ResourceID, 1> l_SignalSemaphores = { m_RenderFinishedSemaphoreID };
-    l_GraphicsBuffer.submit(l_GraphicsQueue, l_WaitSemaphores, l_SignalSemaphores, m_RenderFenceID);
+    // Slots are assigned by frame index modulo the count, so nothing can be in flight while it changes
+    getDevice().waitIdle();
+    m_FramesInFlight = l_Count;
 }
 
 bool Engine::computeHeightmap()
 {
+    CPU_PROFILE_ZONE("Record heightmap");
+
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(m_HeightmapCmdBufferID, 0);
+    const FrameResources& l_Frame = getFrame();
+    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(l_Frame.heightmapCmdBufferID, 0);
 
     const bool l_Recomputed = m_NoiseEngine.recalculate(l_Buffer, m_Heightmap);
 
@@ -467,9 +917,9 @@ bool Engine::computeHeightmap()
     {
         l_Buffer.endRecording();
 
-        const VulkanQueue l_ComputeQueue = l_Device.getQueue(m_ComputeQueuePos);
-        const std::array<ResourceID, 1> l_SignalSemaphores = { m_HeightmapFinishedSemaphoreID };
-        l_Buffer.submit(l_ComputeQueue, {}, l_SignalSemaphores);
+        // Rewrites the heightmap the previous frame's render reads, chunk cache copies included
+        const std::array<TimelineWait, 1> l_Waits{ getPreviousRenderWait(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT) };
+        submit(l_Buffer, m_ComputeQueuePos, m_ComputeTimeline, l_Waits);
     }
 
     return l_Recomputed;
@@ -477,8 +927,11 @@ bool Engine::computeHeightmap()
 
 bool Engine::computeGrassHeight()
 {
+    CPU_PROFILE_ZONE("Record grass height");
+
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(m_GrassHeightCmdBufferID, 0);
+    const FrameResources& l_Frame = getFrame();
+    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(l_Frame.grassHeightCmdBufferID, 0);
 
     const bool l_Recomputed = m_GrassEngine.recomputeHeight(l_Buffer);
 
@@ -486,9 +939,9 @@ bool Engine::computeGrassHeight()
     {
         l_Buffer.endRecording();
 
-        const VulkanQueue l_ComputeQueue = l_Device.getQueue(m_ComputeQueuePos);
-        const std::array<ResourceID, 1> l_SignalSemaphores = { m_GrassHeightFinishedSemaphoreID };
-        l_Buffer.submit(l_ComputeQueue, {}, l_SignalSemaphores);
+        // Procedural blades sample the image in the draw, so the previous frame's render may still be reading it
+        const std::array<TimelineWait, 1> l_Waits{ getPreviousRenderWait(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT) };
+        submit(l_Buffer, m_ComputeQueuePos, m_ComputeTimeline, std::span<const TimelineWait>(l_Waits).first(m_GrassEngine.isHeightNoiseRendered() ? 1 : 0));
     }
 
     return l_Recomputed;
@@ -496,8 +949,11 @@ bool Engine::computeGrassHeight()
 
 bool Engine::computeWind()
 {
+    CPU_PROFILE_ZONE("Record wind");
+
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(m_WindCmdBufferID, 0);
+    const FrameResources& l_Frame = getFrame();
+    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(l_Frame.windCmdBufferID, 0);
 
     const bool l_Recomputed = m_GrassEngine.recomputeWind(l_Buffer);
 
@@ -505,18 +961,21 @@ bool Engine::computeWind()
     {
         l_Buffer.endRecording();
 
-        const VulkanQueue l_ComputeQueue = l_Device.getQueue(m_ComputeQueuePos);
-        const std::array<ResourceID, 1> l_SignalSemaphores = { m_WindFinishedSemaphoreID };
-        l_Buffer.submit(l_ComputeQueue, {}, l_SignalSemaphores);
+        // The image written was drawn by the previous frame
+        const std::array<TimelineWait, 1> l_Waits{ getPreviousRenderWait(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) };
+        submit(l_Buffer, m_ComputeQueuePos, m_ComputeTimeline, l_Waits);
     }
 
     return l_Recomputed;
 }
 
-bool Engine::updateGrass(const bool p_GrassHeightComputed, const bool p_DataTransferred, const bool p_HeightmapComputed)
+bool Engine::updateGrass()
 {
+    CPU_PROFILE_ZONE("Record grass compute");
+
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(m_ComputeCmdBufferID, 0);
+    const FrameResources& l_Frame = getFrame();
+    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(l_Frame.computeCmdBufferID, 0);
 
     const bool l_Recomputed = m_GrassEngine.recompute(l_Buffer, m_PlaneEngine.getTileSize(), m_PlaneEngine.getGridSize(), m_PlaneEngine.getHeightScale());
 
@@ -524,17 +983,14 @@ bool Engine::updateGrass(const bool p_GrassHeightComputed, const bool p_DataTran
     {
         l_Buffer.endRecording();
 
-        const VulkanQueue l_ComputeQueue = l_Device.getQueue(m_ComputeQueuePos);
-        const std::array<ResourceID, 1> l_SignalSemaphores = { m_ComputeFinishedSemaphoreID };
-        std::vector<VulkanCommandBuffer::WaitSemaphoreData> l_WaitSemaphores;
-        if (p_GrassHeightComputed)
-            l_WaitSemaphores.emplace_back(m_GrassHeightFinishedSemaphoreID, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        if (p_DataTransferred)
-            l_WaitSemaphores.emplace_back(m_TransferFinishedSemaphoreID, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        if (p_HeightmapComputed)
-            l_WaitSemaphores.emplace_back(m_HeightmapFinishedSemaphoreID, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        l_Buffer.submit(l_ComputeQueue, l_WaitSemaphores, l_SignalSemaphores, m_ComputeFenceID);
-        m_MustWaitForGrass = true;
+        // Heightmap and grass height went to the compute queue before this, waiting on an already reached value is free.
+        // Occlusion culling reads the Hi-Z pyramid the last render built, so it waits for that render too
+        const std::array<TimelineWait, 3> l_Waits{ {
+            { &m_ComputeTimeline, m_ComputeTimeline.value, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT },
+            { &m_TransferTimeline, m_TransferTimeline.value, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT },
+            getPreviousRenderWait(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+        } };
+        submit(l_Buffer, m_ComputeQueuePos, m_ComputeTimeline, std::span<const TimelineWait>(l_Waits).first(m_GrassEngine.isOcclusionCulling() ? 3 : 2));
     }
 
     return l_Recomputed;
@@ -542,8 +998,11 @@ bool Engine::updateGrass(const bool p_GrassHeightComputed, const bool p_DataTran
 
 bool Engine::transferCulling()
 {
+    CPU_PROFILE_ZONE("Record culling transfer");
+
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(m_TransferCmdBufferID, 0);
+    const FrameResources& l_Frame = getFrame();
+    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(l_Frame.transferCmdBufferID, 0);
 
     const bool l_Transferred = m_GrassEngine.transferCulling(l_Buffer);
 
@@ -551,14 +1010,62 @@ bool Engine::transferCulling()
     {
         l_Buffer.endRecording();
 
-        const VulkanQueue l_TransferQueue = l_Device.getQueue(m_TransferQueuePos);
-        const std::array<ResourceID, 1> l_SignalSemaphores = { m_TransferFinishedSemaphoreID };
-        l_Buffer.submit(l_TransferQueue, {}, l_SignalSemaphores);
+        submit(l_Buffer, m_TransferQueuePos, m_TransferTimeline, {});
     }
 
     return l_Transferred;
 }
 
+Engine::ComputeJobs Engine::submitComputeJobs()
+{
+    ComputeJobs l_Jobs{};
+    l_Jobs.grassHeight = computeGrassHeight();
+    l_Jobs.cullingTransfer = transferCulling();
+    l_Jobs.heightmap = computeHeightmap();
+    l_Jobs.grass = updateGrass();
+    return l_Jobs;
+}
+
+Engine::ComputeJobs Engine::submitBatchedCompute()
+{
+    CPU_PROFILE_ZONE("Record batched compute");
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    VulkanCommandBuffer& l_Buffer = l_Device.getCommandBuffer(getFrame().computeCmdBufferID, 0);
+
+    // Every job starts recording if no job before it did
+    ComputeJobs l_Jobs{};
+    l_Jobs.grassHeight = m_GrassEngine.recomputeHeight(l_Buffer);
+    l_Jobs.cullingTransfer = m_GrassEngine.transferCulling(l_Buffer);
+    if (l_Jobs.cullingTransfer)
+    {
+        // Takes the place of the transfer semaphore, the tiles and cull table are only read by compute shaders
+        const VkMemoryBarrier l_UploadBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+        };
+        vkCmdPipelineBarrier(*l_Buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &l_UploadBarrier, 0, nullptr, 0, nullptr);
+    }
+    // Noise passes end with a compute to compute barrier on their image, which orders them before the grass compute
+    l_Jobs.heightmap = m_NoiseEngine.recalculate(l_Buffer, m_Heightmap);
+    l_Jobs.grass = m_GrassEngine.recompute(l_Buffer, m_PlaneEngine.getTileSize(), m_PlaneEngine.getGridSize(), m_PlaneEngine.getHeightScale());
+
+    if (!l_Jobs.grassHeight && !l_Jobs.cullingTransfer && !l_Jobs.heightmap && !l_Jobs.grass)
+        return l_Jobs;
+
+    l_Buffer.endRecording();
+
+    // The whole batch waits on the GPU for the last render when it rewrites a noise image that render reads,
+    // or when the culling reads the Hi-Z pyramid that render built
+    const bool l_RewritesRendered = l_Jobs.heightmap || (l_Jobs.grassHeight && m_GrassEngine.isHeightNoiseRendered());
+    const bool l_ReadsHiZ = l_Jobs.grass && m_GrassEngine.isOcclusionCulling();
+    const std::array<TimelineWait, 1> l_Waits{ getPreviousRenderWait(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT) };
+    submit(l_Buffer, m_ComputeQueuePos, m_ComputeTimeline, std::span<const TimelineWait>(l_Waits).first(l_RewritesRendered || l_ReadsHiZ ? 1 : 0));
+
+    return l_Jobs;
+}
+
 void Engine::recreateSwapchain(const VkExtent2D p_NewSize)
 {
     Logger::pushContext("Recreate Swapchain");
@@ -569,19 +1076,42 @@ void Engine::recreateSwapchain(const VkExtent2D p_NewSize)
 
     m_SwapchainID = swapchainExtension->createSwapchain(m_Window.getSurface(), p_NewSize, swapchainExtension->getSwapchain(m_SwapchainID).getFormat(), m_PresentMode, m_SwapchainID);
 
-    VulkanSwapchain& l_Swapchain = swapchainExtension->getSwapchain(m_SwapchainID);
+    createFramebuffers();
+    Logger::popContext();
+}
+
+void Engine::createFramebuffers()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const VkExtent2D l_Extent = getRenderExtent();
+
+    const VkImageView l_RenderView = *l_Device.getImage(m_RenderImageID).getImageView(m_RenderImageViewID);
+    const VkImageView l_DepthView = *l_Device.getImage(m_DepthBufferID).getImageView(m_DepthBufferViewID);
+
+    if (m_Settings.headless)
+    {
+        const std::array<VkImageView, 3> l_Attachments = {
+            l_RenderView,
+            *l_Device.getImage(m_OffscreenImageID).getImageView(m_OffscreenImageViewID),
+            l_DepthView
+        };
+        m_FramebufferIDs.resize(1);
+        m_FramebufferIDs[0] = l_Device.createFramebuffer({ l_Extent.width, l_Extent.height, 1 }, m_RenderPassID, l_Attachments);
+        return;
+    }
 
+    const VulkanSwapchain& l_Swapchain = getSwapchain();
+    m_FramebufferIDs.resize(l_Swapchain.getImageCount());
     for (uint32_t i = 0; i < l_Swapchain.getImageCount(); ++i)
     {
         const VkImageView l_Color = *l_Swapchain.getImage(i).getImageView(l_Swapchain.getImageView(i));
         const std::array<VkImageView, 3> l_Attachments = {
-            *l_Device.getImage(m_RenderImageID).getImageView(m_RenderImageViewID),
+            l_RenderView,
             l_Color,
-            *l_Device.getImage(m_DepthBufferID).getImageView(m_DepthBufferViewID)
+            l_DepthView
         };
-        m_FramebufferIDs[i] = VulkanContext::getDevice(m_DeviceID).createFramebuffer({ l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, m_RenderPassID, l_Attachments);
+        m_FramebufferIDs[i] = l_Device.createFramebuffer({ l_Extent.width, l_Extent.height, 1 }, m_RenderPassID, l_Attachments);
     }
-    Logger::popContext();
 }
 
 void Engine::initImgui() const
@@ -625,7 +1155,8 @@ void Engine::initImgui() const
     l_InitInfo.RenderPass = *l_Device.getRenderPass(m_RenderPassID);
     l_InitInfo.Subpass = 1;
     l_InitInfo.MinImageCount = l_Swapchain.getMinImageCount();
-    l_InitInfo.ImageCount = l_Swapchain.getImageCount();
+    // The backend cycles its vertex buffers over ImageCount frames, which must not be fewer than the frames in flight
+    l_InitInfo.ImageCount = std::max(l_Swapchain.getImageCount(), s_MaxFramesInFlight);
     l_InitInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     ImGui_ImplVulkan_Init(&l_InitInfo);
 }
@@ -644,6 +1175,15 @@ void Engine::drawImgui()
     ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
     ImGui::Text("Camera position (%.2f, %.2f, %.2f)", m_Camera.getPosition().x, m_Camera.getPosition().y, m_Camera.getPosition().z);
 
+    ImGui::Separator();
+
+    m_GpuProfiler.drawImgui();
+
+    ImGui::Separator();
+
+    if (ImGui::Button("Dump CPU trace to cpu_trace.json"))
+        CpuProfiler::dumpChromeTrace("cpu_trace.json");
+
     ImGui::End();
 
     ImGui::Begin("General");
@@ -660,6 +1200,18 @@ void Engine::drawImgui()
 
     ImGui::Separator();
 
+    int l_WorkerThreads = static_cast<int>(m_WorkerPool.getThreadCount());
+    if (ImGui::SliderInt("Worker threads", &l_WorkerThreads, 1, static_cast<int>(WorkerPool::getMaxThreadCount())))
+        m_WorkerPool.setThreadCount(static_cast<uint32_t>(l_WorkerThreads));
+
+    int l_FramesInFlight = static_cast<int>(m_FramesInFlight);
+    if (ImGui::SliderInt("Frames in flight", &l_FramesInFlight, 1, static_cast<int>(s_MaxFramesInFlight)))
+        setFramesInFlight(static_cast<uint32_t>(l_FramesInFlight));
+
+    ImGui::Checkbox("Batch compute", &m_BatchCompute);
+
+    ImGui::Separator();
+
     if (ImGui::Button("Edit heightmap"))
         m_Heightmap.toggleImgui();
 
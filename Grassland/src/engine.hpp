@@ -1,38 +1,120 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <span>
+#include <string>
 #include <utils/identifiable.hpp>
 
+#include "benchmark.hpp"
 #include "camera.hpp"
+#include "camera_path.hpp"
+#include "gpu_profiler.hpp"
+#include "pipeline_statistics.hpp"
 #include "grass_engine.hpp"
+#include "hiz_engine.hpp"
 #include "imgui.h"
 #include "plane_engine.hpp"
 #include "pp_fog_engine.hpp"
 #include "sdl_window.hpp"
 #include "skybox_engine.hpp"
 #include "vulkan_queues.hpp"
+#include "worker_pool.hpp"
 
 class VulkanSwapchain;
 
+struct EngineSettings
+{
+    // Renders into an offscreen image instead of a window surface, no SDL window or swapchain is created
+    bool headless = false;
+    VkExtent2D headlessExtent{ 1920, 1080 };
+    // Number of frames to render before exiting in headless mode, 0 runs until the process is stopped
+    uint32_t headlessFrameCount = 0;
+
+    // Replays the keyframes in this file with a fixed delta and exits once the path ends
+    std::string cameraPathFile{};
+    // Per frame stats of a replay are written here, as JSON if it ends in .json and as CSV otherwise
+    std::string benchmarkOutputFile = "benchmark.csv";
+    // Simulated delta used while replaying, so every run sees the same camera poses and wind state
+    float fixedDelta = 1.f / 60.f;
+    // Records the camera pose of every frame and saves it as a camera path file on exit
+    std::string recordPathFile{};
+    // Dumps the CPU profiler zones still in its ring buffer as a Chrome trace when the engine stops
+    std::string cpuTraceFile{};
+
+    // Starts with the grass tiles culled and compacted on the GPU instead of on the CPU, can be toggled at runtime
+    bool gpuCulling = false;
+    // Also rejects tiles hidden behind the terrain using last frame's depth pyramid, needs GPU culling
+    bool occlusionCulling = false;
+    // Starts with the quantized 12 byte grass instances instead of the 32 byte ones, can be toggled at runtime
+    bool compactInstances = false;
+    // Starts with the blades kept in a wrap-around store that tile crossings only partly regenerate, overrides compactInstances
+    bool toroidalInstances = false;
+    // Keeps the heightmap and the grass height noise as wrap-around windows that tile crossings only partly regenerate
+    bool toroidalNoise = false;
+    // Keeps chunks of noise that leave those windows in a GPU pool and copies them back instead of regenerating them, implies toroidalNoise
+    bool noiseChunkCache = false;
+    // Formats of the heightmap and its normal map, the first supported one from here on is used
+    NoiseEngine::TerrainFormat terrainFormat = NoiseEngine::TerrainFormat::FULL;
+    // Starts with the blades placed by the grass vertex shader, with no instance buffer or grass compute, can be toggled at runtime
+    bool proceduralBlades = false;
+    // Starts with the procedural blades drawn by task and mesh shaders, ignored when the GPU has no VK_EXT_mesh_shader
+    bool meshShaders = false;
+
+    // Threads used for CPU work split across the worker pool, the main thread included. 0 uses every hardware thread
+    uint32_t workerThreads = 0;
+    // Frames the CPU can record ahead of the GPU, clamped between 1 and Engine::s_MaxFramesInFlight
+    uint32_t framesInFlight = 2;
+
+    // Records every dirty compute job and the tile upload into one command buffer submitted once per frame, can be toggled at runtime
+    bool batchCompute = false;
+    // Crosses a tile every frame for this many frames in each compute submission mode, prints a comparison and exits
+    uint32_t computeBenchmarkFrames = 0;
+};
+
 class Engine
 {
 public:
-    Engine();
+    static constexpr uint32_t s_MaxFramesInFlight = 3;
+
+    explicit Engine(const EngineSettings& p_Settings);
     ~Engine();
     void run();
 
     [[nodiscard]] VulkanDevice& getDevice() const;
     [[nodiscard]] VulkanSwapchain& getSwapchain() const;
+    [[nodiscard]] VkExtent2D getRenderExtent() const;
+    [[nodiscard]] bool isHeadless() const { return m_Settings.headless; }
+    [[nodiscard]] bool isBenchmarking() const { return !m_Settings.cameraPathFile.empty(); }
+    [[nodiscard]] bool isRecordingPath() const { return !m_Settings.recordPathFile.empty(); }
+    [[nodiscard]] bool isToroidalNoise() const { return m_Settings.toroidalNoise || m_Settings.noiseChunkCache; }
+    [[nodiscard]] bool isNoiseChunkCache() const { return m_Settings.noiseChunkCache; }
     [[nodiscard]] ResourceID getRenderPassID() const { return m_RenderPassID; }
     [[nodiscard]] ResourceID getDescriptorPoolID() const { return m_DescriptorPoolID; }
 
     [[nodiscard]] NoiseEngine& getNoiseEngine() { return m_NoiseEngine; }
+    [[nodiscard]] HiZEngine& getHiZEngine() { return m_HiZEngine; }
+    [[nodiscard]] GpuProfiler& getGpuProfiler() { return m_GpuProfiler; }
+    [[nodiscard]] PipelineStatistics& getPipelineStatistics() { return m_PipelineStatistics; }
+    [[nodiscard]] WorkerPool& getWorkerPool() { return m_WorkerPool; }
 
     [[nodiscard]] bool isHeightmapDirty() const { return m_Heightmap.isNoiseDirty(); }
     [[nodiscard]] bool isGrassDirty() const { return m_GrassEngine.isDirty(); }
 
+    [[nodiscard]] uint32_t getCurrentFrame() const { return m_CurrentFrame; }
+    // Whether every submission of a past frame is done, reads the graphics timeline without waiting on it
+    [[nodiscard]] bool isFrameFinished(uint32_t p_Frame) const;
+    // Whether VK_EXT_mesh_shader was enabled on the device
+    [[nodiscard]] bool isMeshShaderSupported() const { return m_MeshShaderSupported; }
+    [[nodiscard]] NoiseEngine::TerrainFormat getTerrainFormat() const { return m_TerrainFormat; }
+    // Format of the noise without a normal map (wind, grass height), only the height format of it is used
+    [[nodiscard]] NoiseEngine::TerrainFormat getRawNoiseFormat() const { return m_RawNoiseFormat; }
+
     [[nodiscard]] QueueSelection getGraphicsQueuePos() const { return m_GraphicsQueuePos; }
     [[nodiscard]] QueueSelection getComputeQueuePos() const { return m_ComputeQueuePos; }
     [[nodiscard]] QueueSelection getPresentQueuePos() const { return m_PresentQueuePos; }
     [[nodiscard]] QueueSelection getTransferQueuePos() const { return m_TransferQueuePos; }
+    // Queue the per frame tile and cull table uploads are recorded for, the compute queue when compute is batched
+    [[nodiscard]] QueueSelection getUploadQueuePos() const { return m_BatchCompute ? m_ComputeQueuePos : m_TransferQueuePos; }
     Camera& getCamera() { return m_Camera; }
     NoiseEngine::NoiseObject& getHeightmap() { return m_Heightmap; }
 
@@ -51,14 +133,99 @@ private:
 
     void createRenderPasses();
 
-    void render(uint32_t l_ImageIndex, ImDrawData* p_ImGuiDrawData, ResourceID p_SwapchainSemaphore, bool p_RenderedHeightmap, bool p_ComputedGrass, bool p_RenderedWind);
+    // Passes of the main render pass in execution order, the first RENDER_FOG belong to subpass 0 and the rest to subpass 1
+    enum RenderTask : uint32_t
+    {
+        RENDER_SKYBOX,
+        RENDER_TERRAIN,
+        RENDER_GRASS,
+        RENDER_FOG,
+        RENDER_IMGUI,
+        RENDER_TASK_COUNT
+    };
+
+    // Command buffers a frame records into, one set per frame that can be in flight
+    struct FrameResources
+    {
+        ResourceID grassHeightCmdBufferID = UINT32_MAX;
+        ResourceID heightmapCmdBufferID = UINT32_MAX;
+        ResourceID windCmdBufferID = UINT32_MAX;
+        ResourceID transferCmdBufferID = UINT32_MAX;
+        ResourceID computeCmdBufferID = UINT32_MAX;
+        ResourceID renderCmdBufferID = UINT32_MAX;
+        // RENDER_TASK_COUNT secondary buffers per worker thread, allocated from that thread's command pool
+        std::vector<ResourceID> renderTaskCmdBufferIDs{};
+
+        // Binary, presentation can't wait on a timeline semaphore
+        ResourceID renderFinishedSemaphoreID = UINT32_MAX;
+    };
+
+    // What the render tasks need from the device, looked up on the main thread so the workers never touch its resource tables
+    struct RenderTaskHandles
+    {
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        // Indexed like FrameResources::renderTaskCmdBufferIDs
+        std::vector<VulkanCommandBuffer*> cmdBuffers{};
+    };
+
+    // One timeline semaphore per queue, every submission to that queue signals the next value
+    struct Timeline
+    {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t value = 0;
+    };
+
+    struct TimelineWait
+    {
+        const Timeline* timeline;
+        uint64_t value;
+        VkPipelineStageFlags stage;
+    };
+
+    // Timeline waits a submission can take, submit throws past it rather than dropping one
+    static constexpr uint32_t s_MaxSubmitWaits = 3;
+
+    [[nodiscard]] FrameResources& getFrame() { return m_Frames[m_FrameSlot]; }
+    // Every rendered frame signals the graphics timeline once, so frame N is done when it reaches N + 1
+    void waitForFrame(uint32_t p_Frame);
+    // GPU side wait for compute work that rewrites what the previous frame's render reads, the CPU never blocks on it
+    [[nodiscard]] TimelineWait getPreviousRenderWait(VkPipelineStageFlags p_Stage) const;
+    // Signals the next value of p_Signal, the binary semaphores are only there for the swapchain
+    void submit(const VulkanCommandBuffer& p_CmdBuffer, QueueSelection p_Queue, Timeline& p_Signal, std::span<const TimelineWait> p_Waits, VkSemaphore p_BinaryWait = VK_NULL_HANDLE, VkSemaphore p_BinarySignal = VK_NULL_HANDLE);
+    void setFramesInFlight(uint32_t p_Count);
+
+    void render(uint32_t l_ImageIndex, ImDrawData* p_ImGuiDrawData, ResourceID p_SwapchainSemaphore);
+    // Records one pass into the secondary buffer owned by p_Thread and returns its handle, ready to be executed
+    VkCommandBuffer recordRenderTask(RenderTask p_Task, uint32_t p_Thread, const RenderTaskHandles& p_Handles, ImDrawData* p_ImGuiDrawData);
     bool computeHeightmap();
     bool computeGrassHeight();
     bool computeWind();
-    bool updateGrass(bool p_GrassHeightComputed, bool p_DataTransferred, bool p_HeightmapComputed);
+    bool updateGrass();
     bool transferCulling();
 
+    // Which compute jobs recorded something this frame
+    struct ComputeJobs
+    {
+        bool grassHeight = false;
+        bool cullingTransfer = false;
+        bool heightmap = false;
+        bool wind = false;
+        bool grass = false;
+    };
+    // The wind is left out of both, it goes in its own submission after them since this frame's render doesn't read it
+    ComputeJobs submitComputeJobs();
+    // Same jobs in the same order, with barriers in place of the semaphores between them
+    ComputeJobs submitBatchedCompute();
+
     void recreateSwapchain(VkExtent2D p_NewSize);
+    void createFramebuffers();
+
+    [[nodiscard]] bool shouldClose() const;
+
+    void finishBenchmark();
+
+    EngineSettings m_Settings;
 
     SDLWindow m_Window;
 
@@ -73,12 +240,15 @@ private:
 
     ResourceID m_SwapchainID = UINT32_MAX;
 
-    ResourceID m_GrassHeightCmdBufferID = UINT32_MAX;
-    ResourceID m_HeightmapCmdBufferID = UINT32_MAX;
-    ResourceID m_WindCmdBufferID = UINT32_MAX;
-    ResourceID m_TransferCmdBufferID = UINT32_MAX;
-    ResourceID m_ComputeCmdBufferID = UINT32_MAX;
-    ResourceID m_RenderCmdBufferID = UINT32_MAX;
+    std::array<FrameResources, s_MaxFramesInFlight> m_Frames{};
+    uint32_t m_FramesInFlight = 2;
+    uint32_t m_FrameSlot = 0;
+
+    Timeline m_GraphicsTimeline{};
+    Timeline m_ComputeTimeline{};
+    Timeline m_TransferTimeline{};
+    // Compute value this frame's render waits on, the wind submitted after it is only drawn next frame
+    uint64_t m_RenderComputeValue = 0;
 
     ResourceID m_DepthBufferID = UINT32_MAX;
     ResourceID m_DepthBufferViewID = UINT32_MAX;
@@ -86,23 +256,27 @@ private:
     ResourceID m_RenderImageID = UINT32_MAX;
     ResourceID m_RenderImageViewID = UINT32_MAX;
 
+    // Final color target when running headless, takes the place of the swapchain images
+    ResourceID m_OffscreenImageID = UINT32_MAX;
+    ResourceID m_OffscreenImageViewID = UINT32_MAX;
+
 	std::vector<ResourceID> m_FramebufferIDs{};
 
     ResourceID m_RenderPassID = UINT32_MAX;
-    
-    ResourceID m_GrassHeightFinishedSemaphoreID = UINT32_MAX;
-    ResourceID m_HeightmapFinishedSemaphoreID = UINT32_MAX;
-    ResourceID m_WindFinishedSemaphoreID = UINT32_MAX;
-    ResourceID m_TransferFinishedSemaphoreID = UINT32_MAX;
-    ResourceID m_ComputeFinishedSemaphoreID = UINT32_MAX;
-    ResourceID m_RenderFinishedSemaphoreID = UINT32_MAX;
-
-    ResourceID m_ComputeFenceID = UINT32_MAX;
-    ResourceID m_RenderFenceID = UINT32_MAX;
 
     ResourceID m_DescriptorPoolID = UINT32_MAX;
 
     uint32_t m_CurrentFrame = 0;
+    // Time the current frame spent blocked on the graphics timeline, left out of the benchmark CPU time
+    std::chrono::duration<float, std::milli> m_FrameWaitTime{ 0.f };
+    uint32_t m_FrameSubmits = 0;
+
+    bool m_BatchCompute = false;
+    bool m_MeshShaderSupported = false;
+    NoiseEngine::TerrainFormat m_TerrainFormat = NoiseEngine::TerrainFormat::FULL;
+    NoiseEngine::TerrainFormat m_RawNoiseFormat = NoiseEngine::TerrainFormat::FULL;
+
+    WorkerPool m_WorkerPool{};
 
     VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_FIFO_KHR;
 
@@ -112,16 +286,25 @@ private: // Plane
     NoiseEngine m_NoiseEngine{ *this };
     SkyboxEngine m_SkyboxEngine{ *this };
     PPFogEngine m_PPFogEngine{ *this };
+    HiZEngine m_HiZEngine{ *this };
     
     NoiseEngine::NoiseObject m_Heightmap{};
 
     glm::vec2 m_CurrentTile{ 0, 0 };
     glm::vec3 m_LightDir{};
 
-    bool m_MustWaitForGrass = false;
-
     float m_Delta = 0.f;
 
+    GpuProfiler m_GpuProfiler{};
+    PipelineStatistics m_PipelineStatistics{};
+
+private: // Benchmark
+    CameraPath m_CameraPath{};
+    CameraPath m_RecordedPath{};
+    BenchmarkRecorder m_Benchmark{};
+    ComputeBatchBenchmark m_ComputeBenchmark{};
+    float m_PathTime = 0.f;
+
 private:
     void initImgui() const;
     void drawImgui();
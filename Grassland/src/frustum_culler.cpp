@@ -0,0 +1,361 @@
+#include "frustum_culler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+#include <glm/gtc/constants.hpp>
+
+#include "camera.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FRUSTUM_CULLER_X64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC emits AVX intrinsics without /arch:AVX, the path is only taken after the runtime check
+#define FRUSTUM_CULLER_TARGET_AVX
+#else
+#define FRUSTUM_CULLER_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+void FrustumCuller::BoxBatch::resize(const uint32_t p_Count)
+{
+    m_Count = p_Count;
+    const uint32_t l_Padded = (p_Count + s_LaneCount - 1) / s_LaneCount * s_LaneCount;
+    // Padding lanes are tested too, their bits are cleared afterwards
+    m_MinX.assign(l_Padded, 0.f);
+    m_MinY.assign(l_Padded, 0.f);
+    m_MinZ.assign(l_Padded, 0.f);
+    m_MaxX.assign(l_Padded, 0.f);
+    m_MaxY.assign(l_Padded, 0.f);
+    m_MaxZ.assign(l_Padded, 0.f);
+}
+
+void FrustumCuller::BoxBatch::set(const uint32_t p_Index, const glm::vec3& p_Min, const glm::vec3& p_Max)
+{
+    m_MinX[p_Index] = p_Min.x;
+    m_MinY[p_Index] = p_Min.y;
+    m_MinZ[p_Index] = p_Min.z;
+    m_MaxX[p_Index] = p_Max.x;
+    m_MaxY[p_Index] = p_Max.y;
+    m_MaxZ[p_Index] = p_Max.z;
+}
+
+void FrustumCuller::cullBoxes(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, std::vector<uint64_t>& p_VisibleMask)
+{
+    cullBoxes(p_Planes, p_Boxes, p_VisibleMask, getBestPath());
+}
+
+void FrustumCuller::cullBoxes(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, std::vector<uint64_t>& p_VisibleMask, Path p_Path)
+{
+    p_VisibleMask.assign((p_Boxes.paddedSize() + 63) / 64, 0);
+    cullBoxRange(p_Planes, p_Boxes, p_VisibleMask.data(), 0, p_Boxes.size(), p_Path);
+}
+
+void FrustumCuller::cullBoxRange(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, uint64_t* p_VisibleMask, const uint32_t p_First, const uint32_t p_Count, Path p_Path)
+{
+    const uint32_t l_End = std::min(p_First + p_Count, p_Boxes.size());
+    if (p_First >= l_End)
+        return;
+
+    const uint32_t l_FirstWord = p_First / 64;
+    const uint32_t l_EndWord = (l_End + 63) / 64;
+    std::fill(p_VisibleMask + l_FirstWord, p_VisibleMask + l_EndWord, 0);
+
+    if (!isPathSupported(p_Path))
+        p_Path = Path::SCALAR;
+
+    // The SIMD paths run whole lanes, which can only spill into padding or into this range's last word
+    const uint32_t l_LaneEnd = std::min((l_End + s_LaneCount - 1) / s_LaneCount * s_LaneCount, p_Boxes.paddedSize());
+    switch (p_Path)
+    {
+    case Path::AVX:
+        cullAVX(p_Planes, p_Boxes, p_First, l_LaneEnd, p_VisibleMask);
+        break;
+    case Path::SSE:
+        cullSSE(p_Planes, p_Boxes, p_First, l_LaneEnd, p_VisibleMask);
+        break;
+    default:
+        cullScalar(p_Planes, p_Boxes, p_First, l_End, p_VisibleMask);
+        break;
+    }
+
+    // Drop the lanes past the end of the range
+    const uint32_t l_LastBits = l_End % 64;
+    if (l_LastBits != 0)
+        p_VisibleMask[l_EndWord - 1] &= (uint64_t{ 1 } << l_LastBits) - 1;
+}
+
+FrustumCuller::Path FrustumCuller::getBestPath()
+{
+    static const Path s_BestPath = isPathSupported(Path::AVX) ? Path::AVX : isPathSupported(Path::SSE) ? Path::SSE : Path::SCALAR;
+    return s_BestPath;
+}
+
+bool FrustumCuller::isPathSupported(const Path p_Path)
+{
+    switch (p_Path)
+    {
+    case Path::SCALAR:
+        return true;
+#ifdef FRUSTUM_CULLER_X64
+    case Path::SSE:
+        // Part of the x86-64 baseline
+        return true;
+    case Path::AVX:
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int l_Info[4];
+        __cpuid(l_Info, 1);
+        const bool l_OSXSave = (l_Info[2] & (1 << 27)) != 0;
+        const bool l_AVX = (l_Info[2] & (1 << 28)) != 0;
+        // The OS also has to save the upper halves of the YMM registers
+        return l_OSXSave && l_AVX && (_xgetbv(0) & 0x6) == 0x6;
+#else
+        return __builtin_cpu_supports("avx");
+#endif
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* FrustumCuller::getPathName(const Path p_Path)
+{
+    switch (p_Path)
+    {
+    case Path::SSE:
+        return "SSE";
+    case Path::AVX:
+        return "AVX";
+    default:
+        return "Scalar";
+    }
+}
+
+FrustumCuller::Containment FrustumCuller::classifyBox(const glm::vec4* p_Planes, const glm::vec3& p_Min, const glm::vec3& p_Max)
+{
+    bool l_Intersecting = false;
+    for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+    {
+        const glm::vec4& l_Plane = p_Planes[l_PlaneIdx];
+        const glm::vec3 l_Far{ l_Plane.x >= 0.0f ? p_Max.x : p_Min.x, l_Plane.y >= 0.0f ? p_Max.y : p_Min.y, l_Plane.z >= 0.0f ? p_Max.z : p_Min.z };
+        if (l_Plane.x * l_Far.x + l_Plane.y * l_Far.y + l_Plane.z * l_Far.z + l_Plane.w < 0.0f)
+            return Containment::OUTSIDE;
+
+        const glm::vec3 l_Near{ l_Plane.x >= 0.0f ? p_Min.x : p_Max.x, l_Plane.y >= 0.0f ? p_Min.y : p_Max.y, l_Plane.z >= 0.0f ? p_Min.z : p_Max.z };
+        if (l_Plane.x * l_Near.x + l_Plane.y * l_Near.y + l_Plane.z * l_Near.z + l_Plane.w < 0.0f)
+            l_Intersecting = true;
+    }
+    return l_Intersecting ? Containment::INTERSECTING : Containment::INSIDE;
+}
+
+float FrustumCuller::getBoxSlack(const glm::vec4* p_Planes, const glm::vec3& p_Min, const glm::vec3& p_Max)
+{
+    float l_Slack = std::numeric_limits<float>::max();
+    for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+    {
+        const glm::vec4& l_Plane = p_Planes[l_PlaneIdx];
+        const glm::vec3 l_Far{ l_Plane.x >= 0.0f ? p_Max.x : p_Min.x, l_Plane.y >= 0.0f ? p_Max.y : p_Min.y, l_Plane.z >= 0.0f ? p_Max.z : p_Min.z };
+        l_Slack = std::min(l_Slack, l_Plane.x * l_Far.x + l_Plane.y * l_Far.y + l_Plane.z * l_Far.z + l_Plane.w);
+    }
+    return l_Slack;
+}
+
+// Every path picks the plane's negative vertex per axis and evaluates ((nx * x + ny * y) + nz * z) + w, the same
+// operations glm::dot does in Camera::isBoxInFrustum, so without FP contraction the results are identical
+
+void FrustumCuller::cullScalar(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, const uint32_t p_Begin, const uint32_t p_End, uint64_t* p_VisibleMask)
+{
+    for (uint32_t i = p_Begin; i < p_End; i++)
+    {
+        bool l_Visible = true;
+        for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+        {
+            const glm::vec4& l_Plane = p_Planes[l_PlaneIdx];
+            const float l_X = l_Plane.x >= 0.0f ? p_Boxes.m_MaxX[i] : p_Boxes.m_MinX[i];
+            const float l_Y = l_Plane.y >= 0.0f ? p_Boxes.m_MaxY[i] : p_Boxes.m_MinY[i];
+            const float l_Z = l_Plane.z >= 0.0f ? p_Boxes.m_MaxZ[i] : p_Boxes.m_MinZ[i];
+            if (l_Plane.x * l_X + l_Plane.y * l_Y + l_Plane.z * l_Z + l_Plane.w < 0.0f)
+            {
+                l_Visible = false;
+                break;
+            }
+        }
+        if (l_Visible)
+            p_VisibleMask[i / 64] |= uint64_t{ 1 } << (i % 64);
+    }
+}
+
+#ifdef FRUSTUM_CULLER_X64
+
+void FrustumCuller::cullSSE(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, const uint32_t p_Begin, const uint32_t p_End, uint64_t* p_VisibleMask)
+{
+    // The negative vertex only depends on the plane, so each plane reads straight from the min or max arrays
+    std::array<const float*, 18> l_Sources{};
+    for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+    {
+        l_Sources[l_PlaneIdx * 3 + 0] = p_Planes[l_PlaneIdx].x >= 0.0f ? p_Boxes.m_MaxX.data() : p_Boxes.m_MinX.data();
+        l_Sources[l_PlaneIdx * 3 + 1] = p_Planes[l_PlaneIdx].y >= 0.0f ? p_Boxes.m_MaxY.data() : p_Boxes.m_MinY.data();
+        l_Sources[l_PlaneIdx * 3 + 2] = p_Planes[l_PlaneIdx].z >= 0.0f ? p_Boxes.m_MaxZ.data() : p_Boxes.m_MinZ.data();
+    }
+
+    const __m128 l_Zero = _mm_setzero_ps();
+    for (uint32_t i = p_Begin; i < p_End; i += 4)
+    {
+        __m128 l_Outside = _mm_setzero_ps();
+        for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+        {
+            const glm::vec4& l_Plane = p_Planes[l_PlaneIdx];
+            __m128 l_Distance = _mm_mul_ps(_mm_set1_ps(l_Plane.x), _mm_loadu_ps(l_Sources[l_PlaneIdx * 3 + 0] + i));
+            l_Distance = _mm_add_ps(l_Distance, _mm_mul_ps(_mm_set1_ps(l_Plane.y), _mm_loadu_ps(l_Sources[l_PlaneIdx * 3 + 1] + i)));
+            l_Distance = _mm_add_ps(l_Distance, _mm_mul_ps(_mm_set1_ps(l_Plane.z), _mm_loadu_ps(l_Sources[l_PlaneIdx * 3 + 2] + i)));
+            l_Distance = _mm_add_ps(l_Distance, _mm_set1_ps(l_Plane.w));
+            l_Outside = _mm_or_ps(l_Outside, _mm_cmplt_ps(l_Distance, l_Zero));
+        }
+        const uint64_t l_Bits = ~static_cast<uint64_t>(_mm_movemask_ps(l_Outside)) & 0xF;
+        p_VisibleMask[i / 64] |= l_Bits << (i % 64);
+    }
+}
+
+FRUSTUM_CULLER_TARGET_AVX void FrustumCuller::cullAVX(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, const uint32_t p_Begin, const uint32_t p_End, uint64_t* p_VisibleMask)
+{
+    std::array<const float*, 18> l_Sources{};
+    for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+    {
+        l_Sources[l_PlaneIdx * 3 + 0] = p_Planes[l_PlaneIdx].x >= 0.0f ? p_Boxes.m_MaxX.data() : p_Boxes.m_MinX.data();
+        l_Sources[l_PlaneIdx * 3 + 1] = p_Planes[l_PlaneIdx].y >= 0.0f ? p_Boxes.m_MaxY.data() : p_Boxes.m_MinY.data();
+        l_Sources[l_PlaneIdx * 3 + 2] = p_Planes[l_PlaneIdx].z >= 0.0f ? p_Boxes.m_MaxZ.data() : p_Boxes.m_MinZ.data();
+    }
+
+    const __m256 l_Zero = _mm256_setzero_ps();
+    for (uint32_t i = p_Begin; i < p_End; i += 8)
+    {
+        __m256 l_Outside = _mm256_setzero_ps();
+        for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < 6; l_PlaneIdx++)
+        {
+            const glm::vec4& l_Plane = p_Planes[l_PlaneIdx];
+            __m256 l_Distance = _mm256_mul_ps(_mm256_set1_ps(l_Plane.x), _mm256_loadu_ps(l_Sources[l_PlaneIdx * 3 + 0] + i));
+            l_Distance = _mm256_add_ps(l_Distance, _mm256_mul_ps(_mm256_set1_ps(l_Plane.y), _mm256_loadu_ps(l_Sources[l_PlaneIdx * 3 + 1] + i)));
+            l_Distance = _mm256_add_ps(l_Distance, _mm256_mul_ps(_mm256_set1_ps(l_Plane.z), _mm256_loadu_ps(l_Sources[l_PlaneIdx * 3 + 2] + i)));
+            l_Distance = _mm256_add_ps(l_Distance, _mm256_set1_ps(l_Plane.w));
+            // Ordered compare, a NaN distance counts as inside just like the scalar < does
+            l_Outside = _mm256_or_ps(l_Outside, _mm256_cmp_ps(l_Distance, l_Zero, _CMP_LT_OQ));
+        }
+        const uint64_t l_Bits = ~static_cast<uint64_t>(_mm256_movemask_ps(l_Outside)) & 0xFF;
+        p_VisibleMask[i / 64] |= l_Bits << (i % 64);
+    }
+}
+
+#else
+
+void FrustumCuller::cullSSE(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, const uint32_t p_Begin, const uint32_t p_End, uint64_t* p_VisibleMask)
+{
+    cullScalar(p_Planes, p_Boxes, p_Begin, p_End, p_VisibleMask);
+}
+
+void FrustumCuller::cullAVX(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, const uint32_t p_Begin, const uint32_t p_End, uint64_t* p_VisibleMask)
+{
+    cullScalar(p_Planes, p_Boxes, p_Begin, p_End, p_VisibleMask);
+}
+
+#endif
+
+bool FrustumCuller::runBenchmark(const uint32_t p_Iterations)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Same tile and height sizes as the default plane, on the default grass grid and a few larger ones
+    constexpr float l_TileSize = 20.f;
+    constexpr float l_HeightScale = 15.f;
+    constexpr float l_Margin = 3.f;
+    constexpr std::array<uint32_t, 3> l_GridSizes{ 31, 63, 127 };
+    constexpr uint32_t l_PoseCount = 16;
+
+    const std::array<Path, 3> l_Paths{ Path::SCALAR, Path::SSE, Path::AVX };
+
+    bool l_AllMatch = true;
+    std::printf("Frustum culling benchmark, %u iterations over %u camera poses (best path: %s)\n", p_Iterations, l_PoseCount, getPathName(getBestPath()));
+    std::printf("%8s %10s %14s %14s %14s %14s\n", "grid", "visible", "per box ns", "scalar ns", "sse ns", "avx ns");
+
+    for (const uint32_t l_GridSize : l_GridSizes)
+    {
+        const uint32_t l_TileCount = l_GridSize * l_GridSize;
+        std::vector<glm::vec3> l_Mins(l_TileCount);
+        std::vector<glm::vec3> l_Maxs(l_TileCount);
+        BoxBatch l_Batch;
+        l_Batch.resize(l_TileCount);
+        const glm::vec2 l_TileShift = glm::vec2((l_GridSize / 2) * l_TileSize);
+        for (uint32_t l_Tile = 0; l_Tile < l_TileCount; l_Tile++)
+        {
+            const glm::vec2 l_TilePos = glm::vec2(l_Tile % l_GridSize, l_Tile / l_GridSize) * l_TileSize - l_TileShift;
+            l_Mins[l_Tile] = glm::vec3(l_TilePos.x, -l_HeightScale, l_TilePos.y) - glm::vec3(l_Margin);
+            l_Maxs[l_Tile] = glm::vec3(l_TilePos.x + l_TileSize, 0.0f, l_TilePos.y + l_TileSize) + glm::vec3(l_Margin);
+            l_Batch.set(l_Tile, l_Mins[l_Tile], l_Maxs[l_Tile]);
+        }
+
+        std::array<double, 4> l_Nanoseconds{};
+        uint64_t l_VisibleTotal = 0;
+        std::vector<uint64_t> l_Reference;
+        std::vector<uint64_t> l_Mask;
+        for (uint32_t l_Pose = 0; l_Pose < l_PoseCount; l_Pose++)
+        {
+            // Orbit around the grid looking slightly down, like a player walking over the terrain
+            const float l_Angle = static_cast<float>(l_Pose) / l_PoseCount * glm::two_pi<float>();
+            Camera l_Camera{ glm::vec3{ 0.f, -20.f, 0.f }, glm::normalize(glm::vec3{ glm::cos(l_Angle), 0.3f, glm::sin(l_Angle) }) };
+            const glm::vec4* l_Planes = l_Camera.getFrustumPlanes();
+
+            // The old path, one camera call per tile
+            l_Reference.assign((l_Batch.paddedSize() + 63) / 64, 0);
+            Clock::time_point l_Start = Clock::now();
+            for (uint32_t l_Iteration = 0; l_Iteration < p_Iterations; l_Iteration++)
+            {
+                for (uint32_t l_Tile = 0; l_Tile < l_TileCount; l_Tile++)
+                {
+                    if (l_Camera.isBoxInFrustum(l_Mins[l_Tile], l_Maxs[l_Tile]))
+                        l_Reference[l_Tile / 64] |= uint64_t{ 1 } << (l_Tile % 64);
+                }
+            }
+            l_Nanoseconds[0] += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - l_Start).count());
+
+            for (uint32_t l_Tile = 0; l_Tile < l_TileCount; l_Tile++)
+                l_VisibleTotal += isVisible(l_Reference, l_Tile);
+
+            for (uint32_t l_PathIdx = 0; l_PathIdx < l_Paths.size(); l_PathIdx++)
+            {
+                if (!isPathSupported(l_Paths[l_PathIdx]))
+                    continue;
+
+                l_Start = Clock::now();
+                for (uint32_t l_Iteration = 0; l_Iteration < p_Iterations; l_Iteration++)
+                    cullBoxes(l_Planes, l_Batch, l_Mask, l_Paths[l_PathIdx]);
+                l_Nanoseconds[l_PathIdx + 1] += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - l_Start).count());
+
+                if (l_Mask != l_Reference)
+                {
+                    std::printf("Mismatch: %s path on a %ux%u grid, pose %u\n", getPathName(l_Paths[l_PathIdx]), l_GridSize, l_GridSize, l_Pose);
+                    l_AllMatch = false;
+                }
+            }
+        }
+
+        const double l_Runs = static_cast<double>(p_Iterations) * l_PoseCount;
+        std::printf("%5ux%-3u %10.1f", l_GridSize, l_GridSize, static_cast<double>(l_VisibleTotal) / l_PoseCount);
+        for (uint32_t i = 0; i < l_Nanoseconds.size(); i++)
+        {
+            if (i > 0 && !isPathSupported(l_Paths[i - 1]))
+                std::printf(" %14s", "n/a");
+            else
+                std::printf(" %14.1f", l_Nanoseconds[i] / l_Runs);
+        }
+        std::puts("");
+    }
+
+    std::puts(l_AllMatch ? "All paths match the per box test" : "Some paths do NOT match the per box test");
+    return l_AllMatch;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Batched AABB vs frustum test. Boxes are kept as structure of arrays so the SSE and AVX paths test 4 or 8 boxes
+// per plane at once, and every path evaluates the plane distance in the same order as Camera::isBoxInFrustum
+// so their results match it bit for bit
+class FrustumCuller
+{
+public:
+    enum class Path : uint8_t
+    {
+        SCALAR,
+        SSE,
+        AVX
+    };
+
+    enum class Containment : uint8_t
+    {
+        OUTSIDE,
+        INTERSECTING,
+        INSIDE
+    };
+
+    // Widest SIMD path, the box arrays are padded to it so no path needs a tail loop
+    static constexpr uint32_t s_LaneCount = 8;
+
+    class BoxBatch
+    {
+    public:
+        void resize(uint32_t p_Count);
+        void set(uint32_t p_Index, const glm::vec3& p_Min, const glm::vec3& p_Max);
+
+        [[nodiscard]] uint32_t size() const { return m_Count; }
+        [[nodiscard]] uint32_t paddedSize() const { return static_cast<uint32_t>(m_MinX.size()); }
+
+    private:
+        uint32_t m_Count = 0;
+
+        std::vector<float> m_MinX{};
+        std::vector<float> m_MinY{};
+        std::vector<float> m_MinZ{};
+        std::vector<float> m_MaxX{};
+        std::vector<float> m_MaxY{};
+        std::vector<float> m_MaxZ{};
+
+        friend class FrustumCuller;
+    };
+
+    // Bit i of p_VisibleMask is set when box i is at least partially inside the six planes
+    static void cullBoxes(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, std::vector<uint64_t>& p_VisibleMask);
+    static void cullBoxes(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, std::vector<uint64_t>& p_VisibleMask, Path p_Path);
+    // Only writes the mask words of boxes [p_First, p_First + p_Count), the mask must already hold paddedSize() bits.
+    // With p_First a multiple of 64 ranges never share a word, so disjoint ranges can be culled from different threads
+    static void cullBoxRange(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, uint64_t* p_VisibleMask, uint32_t p_First, uint32_t p_Count, Path p_Path);
+
+    // Single box test that also tells apart boxes fully inside. A box inside (or outside) contains only boxes
+    // that cullBoxes and Camera::isBoxInFrustum accept (or reject), rounding can't flip the result
+    [[nodiscard]] static Containment classifyBox(const glm::vec4* p_Planes, const glm::vec3& p_Min, const glm::vec3& p_Max);
+    // Smallest distance of the box's far vertex to the six planes, the box passes cullBoxes exactly when it's not negative
+    [[nodiscard]] static float getBoxSlack(const glm::vec4* p_Planes, const glm::vec3& p_Min, const glm::vec3& p_Max);
+
+    [[nodiscard]] static bool isVisible(const std::vector<uint64_t>& p_VisibleMask, const uint32_t p_Index) { return (p_VisibleMask[p_Index / 64] >> (p_Index % 64)) & 1; }
+
+    // Widest path the CPU and OS support, detected once
+    [[nodiscard]] static Path getBestPath();
+    [[nodiscard]] static bool isPathSupported(Path p_Path);
+    [[nodiscard]] static const char* getPathName(Path p_Path);
+
+    // Times the per box camera test against every supported batched path on tile grids of a few sizes and
+    // checks that all of them produce the same visibility. Returns false on any mismatch
+    static bool runBenchmark(uint32_t p_Iterations);
+
+private:
+    static void cullScalar(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, uint32_t p_Begin, uint32_t p_End, uint64_t* p_VisibleMask);
+    static void cullSSE(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, uint32_t p_Begin, uint32_t p_End, uint64_t* p_VisibleMask);
+    static void cullAVX(const glm::vec4* p_Planes, const BoxBatch& p_Boxes, uint32_t p_Begin, uint32_t p_End, uint64_t* p_VisibleMask);
+};
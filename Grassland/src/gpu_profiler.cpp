@@ -0,0 +1,247 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <imgui.h>
+
+#include "vulkan_device.hpp"
+
+void GpuProfiler::initialize(const VkDevice p_Device, const VkPhysicalDevice p_GPU)
+{
+    m_Device = p_Device;
+
+    VkPhysicalDeviceProperties l_Properties;
+    vkGetPhysicalDeviceProperties(p_GPU, &l_Properties);
+    m_TimestampPeriod = l_Properties.limits.timestampPeriod;
+
+    // Families with 0 valid bits (usually dedicated transfer queues) can't write timestamps at all
+    uint32_t l_FamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(p_GPU, &l_FamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> l_Families{ l_FamilyCount };
+    vkGetPhysicalDeviceQueueFamilyProperties(p_GPU, &l_FamilyCount, l_Families.data());
+    m_FamilyTimestampMasks.resize(l_FamilyCount);
+    for (uint32_t i = 0; i < l_FamilyCount; i++)
+    {
+        const uint32_t l_Bits = l_Families[i].timestampValidBits;
+        m_FamilyTimestampMasks[i] = l_Bits >= 64 ? UINT64_MAX : (1ULL << l_Bits) - 1;
+    }
+
+    const VkQueryPoolCreateInfo l_CreateInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = s_MaxZonesPerFrame * 2 * s_FrameSlots
+    };
+    if (vkCreateQueryPool(m_Device, &l_CreateInfo, nullptr, &m_QueryPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create GPU profiler query pool");
+
+    m_ReadbackScratch.resize(s_MaxZonesPerFrame * 2);
+}
+
+void GpuProfiler::free()
+{
+    if (m_QueryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(m_Device, m_QueryPool, nullptr);
+    m_QueryPool = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::beginFrame(const uint32_t p_FrameIndex)
+{
+    m_CurrentSlot = (m_CurrentSlot + 1) % s_FrameSlots;
+
+    FrameSlot& l_Slot = m_Slots[m_CurrentSlot];
+    l_Slot.frameIndex = p_FrameIndex;
+    l_Slot.nextQuery = 0;
+    l_Slot.resetQueries = 0;
+    l_Slot.pending = false;
+    l_Slot.zones.clear();
+}
+
+bool GpuProfiler::collectFrame(const uint32_t p_FramesAgo)
+{
+    return collect(m_Slots[(m_CurrentSlot + s_FrameSlots - p_FramesAgo) % s_FrameSlots]);
+}
+
+void GpuProfiler::cmdResetZones(const VulkanCommandBuffer& p_CmdBuffer, const uint32_t p_ZoneCount)
+{
+    if (!isEnabled())
+        return;
+
+    std::lock_guard l_Lock{ m_ZoneMutex };
+    FrameSlot& l_Slot = m_Slots[m_CurrentSlot];
+    const uint32_t l_Count = std::min(p_ZoneCount * 2, s_MaxZonesPerFrame * 2 - l_Slot.nextQuery);
+    if (l_Count == 0)
+        return;
+
+    vkCmdResetQueryPool(*p_CmdBuffer, m_QueryPool, getSlotBaseQuery(l_Slot) + l_Slot.nextQuery, l_Count);
+    l_Slot.resetQueries = std::max(l_Slot.resetQueries, l_Slot.nextQuery + l_Count);
+}
+
+uint32_t GpuProfiler::cmdBeginZone(const VulkanCommandBuffer& p_CmdBuffer, const std::string_view p_Name, const uint32_t p_QueueFamily)
+{
+    if (!isEnabled() || p_QueueFamily >= m_FamilyTimestampMasks.size() || m_FamilyTimestampMasks[p_QueueFamily] == 0)
+        return UINT32_MAX;
+
+    std::lock_guard l_Lock{ m_ZoneMutex };
+    FrameSlot& l_Slot = m_Slots[m_CurrentSlot];
+    if (l_Slot.nextQuery + 2 > s_MaxZonesPerFrame * 2)
+        return UINT32_MAX;
+
+    // Resetting here instead would be invalid whenever the zone is recorded inside a render pass
+    if (l_Slot.nextQuery + 2 > l_Slot.resetQueries)
+        throw std::runtime_error("GPU zone " + std::string(p_Name) + " was begun without a cmdResetZones covering it");
+
+    const uint32_t l_Query = getSlotBaseQuery(l_Slot) + l_Slot.nextQuery;
+    vkCmdWriteTimestamp(*p_CmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, l_Query);
+
+    const uint32_t l_Zone = static_cast<uint32_t>(l_Slot.zones.size());
+    l_Slot.zones.push_back({ std::string(p_Name), m_FamilyTimestampMasks[p_QueueFamily] });
+    l_Slot.nextQuery += 2;
+    l_Slot.pending = true;
+    return l_Zone;
+}
+
+void GpuProfiler::cmdEndZone(const VulkanCommandBuffer& p_CmdBuffer, const uint32_t p_Zone)
+{
+    if (p_Zone == UINT32_MAX)
+        return;
+
+    const FrameSlot& l_Slot = m_Slots[m_CurrentSlot];
+    vkCmdWriteTimestamp(*p_CmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, getSlotBaseQuery(l_Slot) + p_Zone * 2 + 1);
+}
+
+GpuProfiler::ZoneStats GpuProfiler::getZoneStats(const std::string_view p_Name) const
+{
+    const auto l_It = m_HistoryIndices.find(std::string(p_Name));
+    if (l_It == m_HistoryIndices.end())
+        return {};
+
+    return computeStats(m_History[l_It->second]);
+}
+
+GpuProfiler::ZoneStats GpuProfiler::computeStats(const ZoneHistory& p_History)
+{
+    ZoneStats l_Stats{};
+    l_Stats.sampleCount = p_History.count;
+    if (p_History.count == 0)
+        return l_Stats;
+
+    std::vector<float> l_Samples{ p_History.samples.begin(), p_History.samples.begin() + p_History.count };
+    std::ranges::sort(l_Samples);
+
+    float l_Sum = 0.f;
+    for (const float l_Sample : l_Samples)
+        l_Sum += l_Sample;
+
+    const auto l_Percentile = [&l_Samples](const float p_P) { return l_Samples[static_cast<size_t>(p_P * static_cast<float>(l_Samples.size() - 1) + 0.5f)]; };
+    l_Stats.last = p_History.samples[(p_History.head + s_HistorySize - 1) % s_HistorySize];
+    l_Stats.average = l_Sum / static_cast<float>(p_History.count);
+    l_Stats.p50 = l_Percentile(0.5f);
+    l_Stats.p95 = l_Percentile(0.95f);
+    l_Stats.p99 = l_Percentile(0.99f);
+    return l_Stats;
+}
+
+void GpuProfiler::startCapture()
+{
+    m_Capture.clear();
+    m_Capturing = true;
+}
+
+void GpuProfiler::exportCapture(const std::string_view p_Path) const
+{
+    std::ofstream l_File{ std::string(p_Path) };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open GPU profile output file " + std::string(p_Path));
+
+    l_File << "frame,zone,gpu_ms\n";
+    for (const CaptureRow& l_Row : m_Capture)
+        l_File << l_Row.frame << ',' << m_History[l_Row.zone].name << ',' << l_Row.milliseconds << '\n';
+}
+
+void GpuProfiler::drawImgui()
+{
+    if (!isEnabled())
+    {
+        ImGui::Text("GPU profiler unavailable");
+        return;
+    }
+
+    ImGui::Text("GPU passes (ms, last %u samples)", s_HistorySize);
+    for (const ZoneHistory& l_History : m_History)
+    {
+        const ZoneStats l_Stats = computeStats(l_History);
+        ImGui::Text("%-20s avg %7.3f | p50 %7.3f | p95 %7.3f | p99 %7.3f", l_History.name.c_str(), l_Stats.average, l_Stats.p50, l_Stats.p95, l_Stats.p99);
+    }
+    const ZoneStats l_Total = computeStats(m_FrameTotals);
+    ImGui::Text("%-20s avg %7.3f | p50 %7.3f | p95 %7.3f | p99 %7.3f", "Total", l_Total.average, l_Total.p50, l_Total.p95, l_Total.p99);
+
+    if (!m_Capturing)
+    {
+        if (ImGui::Button("Start GPU capture"))
+            startCapture();
+    }
+    else
+    {
+        ImGui::Text("Capturing GPU zones (%zu samples)", m_Capture.size());
+        if (ImGui::Button("Stop and export to gpu_profile.csv"))
+        {
+            stopCapture();
+            exportCapture("gpu_profile.csv");
+        }
+    }
+}
+
+bool GpuProfiler::collect(FrameSlot& p_Slot)
+{
+    if (!p_Slot.pending)
+        return false;
+    p_Slot.pending = false;
+
+    const uint32_t l_QueryCount = static_cast<uint32_t>(p_Slot.zones.size()) * 2;
+    const VkResult l_Result = vkGetQueryPoolResults(m_Device, m_QueryPool, getSlotBaseQuery(p_Slot), l_QueryCount, l_QueryCount * sizeof(uint64_t), m_ReadbackScratch.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (l_Result != VK_SUCCESS)
+        return false;
+
+    float l_Total = 0.f;
+    for (size_t i = 0; i < p_Slot.zones.size(); i++)
+    {
+        const Zone& l_Zone = p_Slot.zones[i];
+        const uint64_t l_Ticks = (m_ReadbackScratch[i * 2 + 1] - m_ReadbackScratch[i * 2]) & l_Zone.timestampMask;
+        const float l_Milliseconds = static_cast<float>(l_Ticks) * m_TimestampPeriod / 1e6f;
+        pushSample(l_Zone.name, p_Slot.frameIndex, l_Milliseconds);
+        l_Total += l_Milliseconds;
+    }
+
+    m_FrameTotals.samples[m_FrameTotals.head] = l_Total;
+    m_FrameTotals.head = (m_FrameTotals.head + 1) % s_HistorySize;
+    m_FrameTotals.count = std::min(m_FrameTotals.count + 1, s_HistorySize);
+
+    m_LastCollectedFrame = p_Slot.frameIndex;
+    m_LastCollectedTotal = l_Total;
+    return true;
+}
+
+void GpuProfiler::pushSample(const std::string_view p_Name, const uint32_t p_FrameIndex, const float p_Milliseconds)
+{
+    auto l_It = m_HistoryIndices.find(std::string(p_Name));
+    if (l_It == m_HistoryIndices.end())
+    {
+        l_It = m_HistoryIndices.emplace(std::string(p_Name), static_cast<uint32_t>(m_History.size())).first;
+        m_History.push_back({ std::string(p_Name) });
+    }
+
+    ZoneHistory& l_History = m_History[l_It->second];
+    l_History.samples[l_History.head] = p_Milliseconds;
+    l_History.head = (l_History.head + 1) % s_HistorySize;
+    l_History.count = std::min(l_History.count + 1, s_HistorySize);
+
+    if (m_Capturing)
+        m_Capture.push_back({ p_FrameIndex, l_It->second, p_Milliseconds });
+}
+
+uint32_t GpuProfiler::getSlotBaseQuery(const FrameSlot& p_Slot) const
+{
+    return static_cast<uint32_t>(&p_Slot - m_Slots.data()) * s_MaxZonesPerFrame * 2;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Volk/volk.h>
+
+class VulkanCommandBuffer;
+
+// Timestamp query profiler for GPU passes. Every frame gets its own range of the query pool so the zones
+// of frames still in flight aren't overwritten and finished ones can be read back while the current one is being recorded
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t s_MaxZonesPerFrame = 32;
+    // One more than the most frames the engine keeps in flight, a slot is only reused once it was read back
+    static constexpr uint32_t s_FrameSlots = 4;
+    static constexpr uint32_t s_HistorySize = 256;
+
+    struct ZoneStats
+    {
+        float last = 0.f;
+        float average = 0.f;
+        float p50 = 0.f;
+        float p95 = 0.f;
+        float p99 = 0.f;
+        uint32_t sampleCount = 0;
+    };
+
+    void initialize(VkDevice p_Device, VkPhysicalDevice p_GPU);
+    void free();
+
+    [[nodiscard]] bool isEnabled() const { return m_QueryPool != VK_NULL_HANDLE; }
+
+    // Moves recording to the next query range, must be called before any zone of the frame is recorded
+    void beginFrame(uint32_t p_FrameIndex);
+    // Reads back the zones of the frame begun p_FramesAgo frames before the current one, below s_FrameSlots. Returns false
+    // if there was nothing to read or the GPU is not done with it yet
+    bool collectFrame(uint32_t p_FramesAgo);
+
+    // Resets the queries of the next p_ZoneCount zones. Queries can't be reset inside a render pass, so every zone must be
+    // covered by a call to this outside of one before it is begun
+    void cmdResetZones(const VulkanCommandBuffer& p_CmdBuffer, uint32_t p_ZoneCount);
+    // Returns UINT32_MAX if the zone can't be recorded, which cmdEndZone ignores, and throws if no cmdResetZones covered it.
+    // Safe to call from several threads recording different command buffers, zones are numbered in the order they are begun
+    uint32_t cmdBeginZone(const VulkanCommandBuffer& p_CmdBuffer, std::string_view p_Name, uint32_t p_QueueFamily);
+    void cmdEndZone(const VulkanCommandBuffer& p_CmdBuffer, uint32_t p_Zone);
+
+    [[nodiscard]] uint32_t getLastCollectedFrame() const { return m_LastCollectedFrame; }
+    [[nodiscard]] float getLastCollectedTotal() const { return m_LastCollectedTotal; }
+    [[nodiscard]] ZoneStats getZoneStats(std::string_view p_Name) const;
+
+    void startCapture();
+    void stopCapture() { m_Capturing = false; }
+    [[nodiscard]] bool isCapturing() const { return m_Capturing; }
+    // Writes every captured zone as one "frame,zone,gpu_ms" row
+    void exportCapture(std::string_view p_Path) const;
+
+    void drawImgui();
+
+private:
+    struct Zone
+    {
+        std::string name;
+        uint64_t timestampMask;
+    };
+
+    struct FrameSlot
+    {
+        uint32_t frameIndex = 0;
+        uint32_t nextQuery = 0;
+        uint32_t resetQueries = 0;
+        bool pending = false;
+        std::vector<Zone> zones{};
+    };
+
+    struct ZoneHistory
+    {
+        std::string name;
+        std::array<float, s_HistorySize> samples{};
+        uint32_t head = 0;
+        uint32_t count = 0;
+    };
+
+    struct CaptureRow
+    {
+        uint32_t frame;
+        uint32_t zone;
+        float milliseconds;
+    };
+
+    [[nodiscard]] static ZoneStats computeStats(const ZoneHistory& p_History);
+    bool collect(FrameSlot& p_Slot);
+    void pushSample(std::string_view p_Name, uint32_t p_FrameIndex, float p_Milliseconds);
+    [[nodiscard]] uint32_t getSlotBaseQuery(const FrameSlot& p_Slot) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkQueryPool m_QueryPool = VK_NULL_HANDLE;
+    float m_TimestampPeriod = 1.f;
+    std::vector<uint64_t> m_FamilyTimestampMasks{};
+
+    std::array<FrameSlot, s_FrameSlots> m_Slots{};
+    std::mutex m_ZoneMutex{};
+    uint32_t m_CurrentSlot = 0;
+
+    std::vector<ZoneHistory> m_History{};
+    std::unordered_map<std::string, uint32_t> m_HistoryIndices{};
+
+    uint32_t m_LastCollectedFrame = UINT32_MAX;
+    float m_LastCollectedTotal = 0.f;
+    // Sum of every zone of a frame, kept apart from the zone map so it can't clash with a zone name
+    ZoneHistory m_FrameTotals{ "Total" };
+
+    bool m_Capturing = false;
+    std::vector<CaptureRow> m_Capture{};
+
+    std::vector<uint64_t> m_ReadbackScratch{};
+};
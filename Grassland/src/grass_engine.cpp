@@ -1,6 +1,11 @@
 #include "grass_engine.hpp"
 
+#include <algorithm>
+
+#include <glm/gtc/constants.hpp>
+
 #include "camera.hpp"
+#include "cpu_profiler.hpp"
 #include "engine.hpp"
 #include "vertex.hpp"
 #include "vulkan_device.hpp"
@@ -20,7 +25,9 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
         .persistence = 1.2f,
         .lacunarity = 2.f,
     });
-    m_HeightNoise.initialize(512, m_Engine, false);
+    m_HeightNoise.initialize("Grass height", 512, m_Engine, false, false, m_Engine.isToroidalNoise());
+    if (m_Engine.isNoiseChunkCache())
+        m_HeightNoise.createChunkCache();
 
     m_WindNoise.overridePushConstant({
         .scale = 15.f,
@@ -28,7 +35,8 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
         .persistence = 1.1f,
         .lacunarity = 1.3f,
     });
-    m_WindNoise.initialize(512, m_Engine, false);
+    // Computed one frame ahead, the grass draws the previous result while the compute queue writes the next
+    m_WindNoise.initialize("Wind", 512, m_Engine, false, true);
 
     m_LODColors = {
         glm::vec3{1.f, 0.f, 0.f},
@@ -41,7 +49,7 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
 
     {
         {
-            std::array<VkDescriptorSetLayoutBinding, 4> l_Bindings;
+            std::array<VkDescriptorSetLayoutBinding, 6> l_Bindings;
             l_Bindings[0].binding = 0;
             l_Bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
             l_Bindings[0].descriptorCount = 1;
@@ -62,12 +70,20 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
             l_Bindings[3].descriptorCount = 1;
             l_Bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
             l_Bindings[3].pImmutableSamplers = nullptr;
+            l_Bindings[4].binding = 4;
+            l_Bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            l_Bindings[4].descriptorCount = 1;
+            l_Bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            l_Bindings[4].pImmutableSamplers = nullptr;
+            l_Bindings[5].binding = 5;
+            l_Bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            l_Bindings[5].descriptorCount = 1;
+            l_Bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            l_Bindings[5].pImmutableSamplers = nullptr;
 
             m_ComputeDescriptorSetLayoutID = l_Device.createDescriptorSetLayout(l_Bindings, 0);
         }
 
-        m_ComputeDescriptorSetID = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_ComputeDescriptorSetLayoutID);
-
         const VkDescriptorImageInfo l_InstanceDataHeightmapInfo{
             .sampler = *l_Device.getImage(m_Engine.getHeightmap().noiseImage.image).getSampler(m_Engine.getHeightmap().noiseImage.sampler),
             .imageView = *l_Device.getImage(m_Engine.getHeightmap().noiseImage.image).getImageView(m_Engine.getHeightmap().noiseImage.view),
@@ -80,25 +96,35 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
         };
 
-        std::array<VkWriteDescriptorSet, 2> l_DescriptorWrite{};
-    
-        l_DescriptorWrite[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        l_DescriptorWrite[0].dstSet = *l_Device.getDescriptorSet(m_ComputeDescriptorSetID);
-        l_DescriptorWrite[0].dstBinding = 0;
-        l_DescriptorWrite[0].dstArrayElement = 0;
-        l_DescriptorWrite[0].descriptorCount = 1;
-        l_DescriptorWrite[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        l_DescriptorWrite[0].pImageInfo = &l_InstanceDataHeightmapInfo;
-    
-        l_DescriptorWrite[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        l_DescriptorWrite[1].dstSet = *l_Device.getDescriptorSet(m_ComputeDescriptorSetID);
-        l_DescriptorWrite[1].dstBinding = 1;
-        l_DescriptorWrite[1].dstArrayElement = 0;
-        l_DescriptorWrite[1].descriptorCount = 1;
-        l_DescriptorWrite[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        l_DescriptorWrite[1].pImageInfo = &l_InstanceGrassHeightInfo;
+        for (BufferSet& l_Set : m_BufferSets)
+        {
+            l_Set.computeDescriptorSetID = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_ComputeDescriptorSetLayoutID);
+            // Same bindings, but the tile list is the one of the toroidal tiles to regenerate
+            l_Set.toroidalComputeDescriptorSetID = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_ComputeDescriptorSetLayoutID);
 
-        l_Device.updateDescriptorSets(l_DescriptorWrite);
+            for (const ResourceID l_DescriptorSetID : { l_Set.computeDescriptorSetID, l_Set.toroidalComputeDescriptorSetID })
+            {
+                std::array<VkWriteDescriptorSet, 2> l_DescriptorWrite{};
+
+                l_DescriptorWrite[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                l_DescriptorWrite[0].dstSet = *l_Device.getDescriptorSet(l_DescriptorSetID);
+                l_DescriptorWrite[0].dstBinding = 0;
+                l_DescriptorWrite[0].dstArrayElement = 0;
+                l_DescriptorWrite[0].descriptorCount = 1;
+                l_DescriptorWrite[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                l_DescriptorWrite[0].pImageInfo = &l_InstanceDataHeightmapInfo;
+
+                l_DescriptorWrite[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                l_DescriptorWrite[1].dstSet = *l_Device.getDescriptorSet(l_DescriptorSetID);
+                l_DescriptorWrite[1].dstBinding = 1;
+                l_DescriptorWrite[1].dstArrayElement = 0;
+                l_DescriptorWrite[1].descriptorCount = 1;
+                l_DescriptorWrite[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                l_DescriptorWrite[1].pImageInfo = &l_InstanceGrassHeightInfo;
+
+                l_Device.updateDescriptorSets(l_DescriptorWrite);
+            }
+        }
     }
 
     {
@@ -115,6 +141,182 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
         l_Device.freeShader(l_ShaderID);
     }
 
+    // GPU culling
+    {
+        {
+            // Cull table, tile buffer, indirect buffer and occlusion params, then the heightmap and the Hi-Z atlas
+            std::array<VkDescriptorSetLayoutBinding, 6> l_Bindings;
+            for (uint32_t i = 0; i < l_Bindings.size(); ++i)
+            {
+                l_Bindings[i].binding = i;
+                l_Bindings[i].descriptorType = i < 4 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                l_Bindings[i].descriptorCount = 1;
+                l_Bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+                l_Bindings[i].pImmutableSamplers = nullptr;
+            }
+
+            m_CullDescriptorSetLayoutID = l_Device.createDescriptorSetLayout(l_Bindings, 0);
+        }
+
+        {
+            std::array<VkPushConstantRange, 1> l_PushConstantRanges;
+            l_PushConstantRanges[0] = { .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(CullPushConstantData) };
+            std::array<ResourceID, 1> l_DescriptorSetLayouts = { m_CullDescriptorSetLayoutID };
+            m_CullPipelineLayoutID = l_Device.createPipelineLayout(l_DescriptorSetLayouts, l_PushConstantRanges);
+        }
+        {
+            std::array<VkPushConstantRange, 1> l_PushConstantRanges;
+            l_PushConstantRanges[0] = { .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(CullFinalizePushConstantData) };
+            std::array<ResourceID, 1> l_DescriptorSetLayouts = { m_CullDescriptorSetLayoutID };
+            m_CullFinalizePipelineLayoutID = l_Device.createPipelineLayout(l_DescriptorSetLayouts, l_PushConstantRanges);
+        }
+
+        const ResourceID l_CullShaderID = l_Device.createShader("shaders/grass_cull.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, {});
+        const ResourceID l_FinalizeShaderID = l_Device.createShader("shaders/grass_cull_finalize.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, {});
+
+        m_CullPipelineID = l_Device.createComputePipeline(m_CullPipelineLayoutID, l_CullShaderID, "main");
+        m_CullFinalizePipelineID = l_Device.createComputePipeline(m_CullFinalizePipelineLayoutID, l_FinalizeShaderID, "main");
+
+        l_Device.freeShader(l_CullShaderID);
+        l_Device.freeShader(l_FinalizeShaderID);
+
+        m_BladeCullBufferID = l_Device.createBuffer(sizeof(BladeCullParams), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getComputeQueuePos().familyIndex);
+        VulkanBuffer& l_BladeCullBuffer = l_Device.getBuffer(m_BladeCullBufferID);
+        l_BladeCullBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+        l_BladeCullBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+
+        m_OcclusionBufferID = l_Device.createBuffer(sizeof(OcclusionParams), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getComputeQueuePos().familyIndex);
+        VulkanBuffer& l_OcclusionBuffer = l_Device.getBuffer(m_OcclusionBufferID);
+        l_OcclusionBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+        l_OcclusionBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+
+        const VkDescriptorBufferInfo l_BladeCullBufferInfo{
+            .buffer = *l_BladeCullBuffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        const VkDescriptorBufferInfo l_OcclusionBufferInfo{
+            .buffer = *l_OcclusionBuffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        const VkDescriptorImageInfo l_CullHeightmapInfo{
+            .sampler = *l_Device.getImage(m_Engine.getHeightmap().noiseImage.image).getSampler(m_Engine.getHeightmap().noiseImage.sampler),
+            .imageView = *l_Device.getImage(m_Engine.getHeightmap().noiseImage.image).getImageView(m_Engine.getHeightmap().noiseImage.view),
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+
+        const HiZEngine& l_HiZ = m_Engine.getHiZEngine();
+        const VkDescriptorImageInfo l_HiZAtlasInfo{
+            .sampler = *l_Device.getImage(l_HiZ.getAtlasImage()).getSampler(l_HiZ.getAtlasSampler()),
+            .imageView = *l_Device.getImage(l_HiZ.getAtlasImage()).getImageView(l_HiZ.getAtlasView()),
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+
+        for (BufferSet& l_Set : m_BufferSets)
+        {
+            l_Set.cullDescriptorSetID = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_CullDescriptorSetLayoutID);
+
+            l_Set.indirectBufferID = l_Device.createBuffer(sizeof(CullIndirectData), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getComputeQueuePos().familyIndex);
+            VulkanBuffer& l_IndirectBuffer = l_Device.getBuffer(l_Set.indirectBufferID);
+            l_IndirectBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+            l_IndirectBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+
+            // Host copy of the indirect data so the CPU side stats and benchmark still see the visible tile counts
+            l_Set.cullReadbackBufferID = l_Device.createBuffer(sizeof(CullIndirectData), VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getComputeQueuePos().familyIndex);
+            VulkanBuffer& l_ReadbackBuffer = l_Device.getBuffer(l_Set.cullReadbackBufferID);
+            l_ReadbackBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, .undesiredProperties = 0, .allowUndesired = false });
+            l_ReadbackBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+            l_Set.cullReadbackData = static_cast<const CullIndirectData*>(l_ReadbackBuffer.map(sizeof(CullIndirectData), 0));
+
+            const VkDescriptorBufferInfo l_IndirectBufferInfo{
+                .buffer = *l_IndirectBuffer,
+                .offset = 0,
+                .range = VK_WHOLE_SIZE,
+            };
+
+            const std::array<VkWriteDescriptorSet, 8> l_DescriptorWrite{
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.cullDescriptorSetID),
+                    .dstBinding = 3,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_OcclusionBufferInfo,
+                },
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.cullDescriptorSetID),
+                    .dstBinding = 4,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &l_CullHeightmapInfo,
+                },
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.cullDescriptorSetID),
+                    .dstBinding = 5,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &l_HiZAtlasInfo,
+                },
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.cullDescriptorSetID),
+                    .dstBinding = 2,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_IndirectBufferInfo,
+                },
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.computeDescriptorSetID),
+                    .dstBinding = 4,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_IndirectBufferInfo,
+                },
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.computeDescriptorSetID),
+                    .dstBinding = 5,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_BladeCullBufferInfo,
+                },
+                // Never appended to, toroidal stores are not blade culled, but the shader still declares both
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.toroidalComputeDescriptorSetID),
+                    .dstBinding = 4,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_IndirectBufferInfo,
+                },
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_Set.toroidalComputeDescriptorSetID),
+                    .dstBinding = 5,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_BladeCullBufferInfo,
+                }
+            };
+
+            l_Device.updateDescriptorSets(l_DescriptorWrite);
+        }
+    }
+
     {
         {
             std::array<VkDescriptorSetLayoutBinding, 1> l_Bindings;
@@ -127,24 +329,126 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
             m_GrassDescriptorSetLayoutID = l_Device.createDescriptorSetLayout(l_Bindings, 0);
         }
 
-        m_GrassDescriptorSetID = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_GrassDescriptorSetLayoutID);
+        // Nothing was swapped yet, so the front and back images are still the first and second ones
+        const std::array<const ImageData*, 2> l_WindImages = { &m_WindNoise.noiseImage, &m_WindNoise.backNoiseImage };
+        for (uint32_t i = 0; i < m_GrassDescriptorSetIDs.size(); i++)
+        {
+            m_GrassDescriptorSetIDs[i] = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_GrassDescriptorSetLayoutID);
+
+            const VkDescriptorImageInfo l_GrassWindInfo{
+                .sampler = *l_Device.getImage(l_WindImages[i]->image).getSampler(l_WindImages[i]->sampler),
+                .imageView = *l_Device.getImage(l_WindImages[i]->image).getImageView(l_WindImages[i]->view),
+                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            };
+
+            std::array<VkWriteDescriptorSet, 1> l_DescriptorWrite{};
+            l_DescriptorWrite[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            l_DescriptorWrite[0].dstSet = *l_Device.getDescriptorSet(m_GrassDescriptorSetIDs[i]);
+            l_DescriptorWrite[0].dstBinding = 0;
+            l_DescriptorWrite[0].dstArrayElement = 0;
+            l_DescriptorWrite[0].descriptorCount = 1;
+            l_DescriptorWrite[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            l_DescriptorWrite[0].pImageInfo = &l_GrassWindInfo;
+
+            l_Device.updateDescriptorSets(l_DescriptorWrite);
+        }
 
-        const VkDescriptorImageInfo l_GrassWindInfo{
-            .sampler = *l_Device.getImage(m_WindNoise.noiseImage.image).getSampler(m_WindNoise.noiseImage.sampler),
-            .imageView = *l_Device.getImage(m_WindNoise.noiseImage.image).getImageView(m_WindNoise.noiseImage.view),
+        {
+            // Wind, tile buffer and placement, then the heightmap, the grass height and the toroidal store
+            std::array<VkDescriptorSetLayoutBinding, 6> l_Bindings;
+            for (uint32_t i = 0; i < l_Bindings.size(); ++i)
+            {
+                l_Bindings[i].binding = i;
+                l_Bindings[i].descriptorType = i == 1 || i == 2 || i == 5 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                l_Bindings[i].descriptorCount = 1;
+                // The mesh shader draw reads the same sets from its task and mesh stages
+                l_Bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | (m_Engine.isMeshShaderSupported() ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT : 0);
+                l_Bindings[i].pImmutableSamplers = nullptr;
+            }
+
+            m_ProceduralDescriptorSetLayoutID = l_Device.createDescriptorSetLayout(l_Bindings, 0);
+        }
+
+        const VkDescriptorImageInfo l_ProceduralHeightmapInfo{
+            .sampler = *l_Device.getImage(m_Engine.getHeightmap().noiseImage.image).getSampler(m_Engine.getHeightmap().noiseImage.sampler),
+            .imageView = *l_Device.getImage(m_Engine.getHeightmap().noiseImage.image).getImageView(m_Engine.getHeightmap().noiseImage.view),
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
         };
 
-        std::array<VkWriteDescriptorSet, 1> l_DescriptorWrite{};
-        l_DescriptorWrite[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        l_DescriptorWrite[0].dstSet = *l_Device.getDescriptorSet(m_GrassDescriptorSetID);
-        l_DescriptorWrite[0].dstBinding = 0;
-        l_DescriptorWrite[0].dstArrayElement = 0;
-        l_DescriptorWrite[0].descriptorCount = 1;
-        l_DescriptorWrite[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        l_DescriptorWrite[0].pImageInfo = &l_GrassWindInfo;
+        const VkDescriptorImageInfo l_ProceduralGrassHeightInfo{
+            .sampler = *l_Device.getImage(m_HeightNoise.noiseImage.image).getSampler(m_HeightNoise.noiseImage.sampler),
+            .imageView = *l_Device.getImage(m_HeightNoise.noiseImage.image).getImageView(m_HeightNoise.noiseImage.view),
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
 
-        l_Device.updateDescriptorSets(l_DescriptorWrite);
+        // The tile buffers are written along with the compute sets in rebuildTileResources, the toroidal stores in rebuildInstanceResources
+        for (BufferSet& l_Set : m_BufferSets)
+        {
+            l_Set.placementBufferID = l_Device.createBuffer(sizeof(ComputePushConstantData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
+            VulkanBuffer& l_PlacementBuffer = l_Device.getBuffer(l_Set.placementBufferID);
+            l_PlacementBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, .undesiredProperties = 0, .allowUndesired = false });
+            l_PlacementBuffer.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+            l_Set.placementData = static_cast<ComputePushConstantData*>(l_PlacementBuffer.map(sizeof(ComputePushConstantData), 0));
+
+            const VkDescriptorBufferInfo l_PlacementBufferInfo{
+                .buffer = *l_PlacementBuffer,
+                .offset = 0,
+                .range = VK_WHOLE_SIZE,
+            };
+
+            for (uint32_t i = 0; i < l_Set.proceduralDescriptorSetIDs.size(); i++)
+            {
+                l_Set.proceduralDescriptorSetIDs[i] = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_ProceduralDescriptorSetLayoutID);
+                const VkDescriptorSet l_DescriptorSet = *l_Device.getDescriptorSet(l_Set.proceduralDescriptorSetIDs[i]);
+
+                const VkDescriptorImageInfo l_ProceduralWindInfo{
+                    .sampler = *l_Device.getImage(l_WindImages[i]->image).getSampler(l_WindImages[i]->sampler),
+                    .imageView = *l_Device.getImage(l_WindImages[i]->image).getImageView(l_WindImages[i]->view),
+                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                };
+
+                const std::array<VkWriteDescriptorSet, 4> l_DescriptorWrite{
+                    VkWriteDescriptorSet{
+                        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                        .dstSet = l_DescriptorSet,
+                        .dstBinding = 0,
+                        .dstArrayElement = 0,
+                        .descriptorCount = 1,
+                        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        .pImageInfo = &l_ProceduralWindInfo,
+                    },
+                    VkWriteDescriptorSet{
+                        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                        .dstSet = l_DescriptorSet,
+                        .dstBinding = 2,
+                        .dstArrayElement = 0,
+                        .descriptorCount = 1,
+                        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        .pBufferInfo = &l_PlacementBufferInfo,
+                    },
+                    VkWriteDescriptorSet{
+                        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                        .dstSet = l_DescriptorSet,
+                        .dstBinding = 3,
+                        .dstArrayElement = 0,
+                        .descriptorCount = 1,
+                        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        .pImageInfo = &l_ProceduralHeightmapInfo,
+                    },
+                    VkWriteDescriptorSet{
+                        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                        .dstSet = l_DescriptorSet,
+                        .dstBinding = 4,
+                        .dstArrayElement = 0,
+                        .descriptorCount = 1,
+                        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        .pImageInfo = &l_ProceduralGrassHeightInfo,
+                    }
+                };
+
+                l_Device.updateDescriptorSets(l_DescriptorWrite);
+            }
+        }
     }
 
     {
@@ -154,10 +458,24 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
             l_PushConstantRanges[1] = { VK_SHADER_STAGE_FRAGMENT_BIT, GrassPushConstantData::getFragmentShaderOffset(), GrassPushConstantData::getFragmentShaderSize() };
             std::array<ResourceID, 1> l_DescriptorSetLayouts = { m_GrassDescriptorSetLayoutID };
             m_GrassPipelineLayoutID = l_Device.createPipelineLayout(l_DescriptorSetLayouts, l_PushConstantRanges);
+
+            std::array<ResourceID, 1> l_ProceduralDescriptorSetLayouts = { m_ProceduralDescriptorSetLayoutID };
+            m_ProceduralPipelineLayoutID = l_Device.createPipelineLayout(l_ProceduralDescriptorSetLayouts, l_PushConstantRanges);
+
+            if (m_Engine.isMeshShaderSupported())
+            {
+                // Both stages see the whole block, the task shader culls with the view projection and the mesh shader needs the blade shape
+                std::array<VkPushConstantRange, 2> l_MeshPushConstantRanges;
+                l_MeshPushConstantRanges[0] = { VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, 0, MeshPushConstantData::getOffset() + MeshPushConstantData::getSize() };
+                l_MeshPushConstantRanges[1] = l_PushConstantRanges[1];
+                m_MeshPipelineLayoutID = l_Device.createPipelineLayout(l_ProceduralDescriptorSetLayouts, l_MeshPushConstantRanges);
+            }
         }
 
         const ResourceID l_VertexShaderID = l_Device.createShader("shaders/grass.vert", VK_SHADER_STAGE_VERTEX_BIT, false, {});
         const ResourceID l_FragmentShaderID = l_Device.createShader("shaders/grass.frag", VK_SHADER_STAGE_FRAGMENT_BIT, false, {});
+        const ResourceID l_ProceduralVertexShaderID = l_Device.createShader("shaders/grass_procedural.vert", VK_SHADER_STAGE_VERTEX_BIT, false, {});
+        const ResourceID l_ToroidalVertexShaderID = l_Device.createShader("shaders/grass_toroidal.vert", VK_SHADER_STAGE_VERTEX_BIT, false, {});
 
         VkPipelineColorBlendAttachmentState l_ColorBlendAttachment;
         l_ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -171,33 +489,77 @@ void GrassEngine::initalize(const std::array<uint32_t, 4> p_TileGridSizes, const
          
         std::array<VkDynamicState, 2> l_DynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
+        VulkanBinding l_VertexBinding{ 1, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex) };
+        l_VertexBinding.addAttribDescription(VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position));
+
+        // Procedural blades have no instance binding, so the blade vertices go first
+        VulkanBinding l_ProceduralVertexBinding{ 0, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex) };
+        l_ProceduralVertexBinding.addAttribDescription(VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position));
+
+        auto l_SetGrassPipelineState = [&](VulkanPipelineBuilder& p_PipelineBuilder)
+        {
+            p_PipelineBuilder.setInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_FALSE);
+            p_PipelineBuilder.setViewportState(1, 1);
+            p_PipelineBuilder.setRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+            p_PipelineBuilder.setMultisampleState(VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f);
+            p_PipelineBuilder.setDepthStencilState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
+            p_PipelineBuilder.addColorBlendAttachment(l_ColorBlendAttachment);
+            p_PipelineBuilder.setColorBlendState(VK_FALSE, VK_LOGIC_OP_COPY, { 0.0f, 0.0f, 0.0f, 0.0f });
+            p_PipelineBuilder.setDynamicState(l_DynamicStates);
+        };
+
+        auto l_CreateGrassPipeline = [&](const VulkanBinding* p_InstanceBinding, const VulkanBinding& p_VertexBinding, const ResourceID p_VertexShaderID, const ResourceID p_LayoutID) -> ResourceID
+        {
+            VulkanPipelineBuilder l_PipelineBuilder{l_Device.getID()};
+            if (p_InstanceBinding != nullptr)
+                l_PipelineBuilder.addVertexBinding(*p_InstanceBinding);
+            l_PipelineBuilder.addVertexBinding(p_VertexBinding);
+            l_SetGrassPipelineState(l_PipelineBuilder);
+            l_PipelineBuilder.addShaderStage(p_VertexShaderID, "main");
+            l_PipelineBuilder.addShaderStage(l_FragmentShaderID, "main");
+
+            return l_Device.createPipeline(l_PipelineBuilder, p_LayoutID, m_Engine.getRenderPassID(), 0);
+        };
+
         VulkanBinding l_InstanceBinding{ 0, VK_VERTEX_INPUT_RATE_INSTANCE, sizeof(InstanceElem)};
         l_InstanceBinding.addAttribDescription(VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceElem, position));
         l_InstanceBinding.addAttribDescription(VK_FORMAT_R32_SFLOAT, offsetof(InstanceElem, rotation));
         l_InstanceBinding.addAttribDescription(VK_FORMAT_R32G32_SFLOAT, offsetof(InstanceElem, uv));
         l_InstanceBinding.addAttribDescription(VK_FORMAT_R32_SFLOAT, offsetof(InstanceElem, height));
+        m_GrassPipelineID = l_CreateGrassPipeline(&l_InstanceBinding, l_VertexBinding, l_VertexShaderID, m_GrassPipelineLayoutID);
 
-        VulkanBinding l_VertexBinding{ 1, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex) };
-        l_VertexBinding.addAttribDescription(VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position));
+        // Same locations as the full layout, the vertex shader undoes the quantization with instanceScale and instanceOrigin
+        VulkanBinding l_CompactInstanceBinding{ 0, VK_VERTEX_INPUT_RATE_INSTANCE, sizeof(CompactInstanceElem)};
+        l_CompactInstanceBinding.addAttribDescription(VK_FORMAT_R16G16_SFLOAT, offsetof(CompactInstanceElem, heightAndY));
+        l_CompactInstanceBinding.addAttribDescription(VK_FORMAT_R16_UNORM, offsetof(CompactInstanceElem, rotation));
+        l_CompactInstanceBinding.addAttribDescription(VK_FORMAT_R16G16_UNORM, offsetof(CompactInstanceElem, uv));
+        l_CompactInstanceBinding.addAttribDescription(VK_FORMAT_R16_SFLOAT, offsetof(CompactInstanceElem, heightAndY));
+        m_CompactGrassPipelineID = l_CreateGrassPipeline(&l_CompactInstanceBinding, l_VertexBinding, l_VertexShaderID, m_GrassPipelineLayoutID);
 
-        VulkanPipelineBuilder l_PipelineBuilder{l_Device.getID()};
-        l_PipelineBuilder.addVertexBinding(l_InstanceBinding);
-        l_PipelineBuilder.addVertexBinding(l_VertexBinding);
-        l_PipelineBuilder.setInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_FALSE);
-        l_PipelineBuilder.setViewportState(1, 1);
-        l_PipelineBuilder.setRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-        l_PipelineBuilder.setMultisampleState(VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f);
-        l_PipelineBuilder.setDepthStencilState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
-        l_PipelineBuilder.addColorBlendAttachment(l_ColorBlendAttachment);
-        l_PipelineBuilder.setColorBlendState(VK_FALSE, VK_LOGIC_OP_COPY, { 0.0f, 0.0f, 0.0f, 0.0f });
-        l_PipelineBuilder.setDynamicState(l_DynamicStates);
-        l_PipelineBuilder.addShaderStage(l_VertexShaderID, "main");
-        l_PipelineBuilder.addShaderStage(l_FragmentShaderID, "main");
-
-        m_GrassPipelineID = l_Device.createPipeline(l_PipelineBuilder, m_GrassPipelineLayoutID, m_Engine.getRenderPassID(), 0);
+        m_ProceduralGrassPipelineID = l_CreateGrassPipeline(nullptr, l_ProceduralVertexBinding, l_ProceduralVertexShaderID, m_ProceduralPipelineLayoutID);
+        m_ToroidalGrassPipelineID = l_CreateGrassPipeline(nullptr, l_ProceduralVertexBinding, l_ToroidalVertexShaderID, m_ProceduralPipelineLayoutID);
+
+        if (m_Engine.isMeshShaderSupported())
+        {
+            const ResourceID l_TaskShaderID = l_Device.createShader("shaders/grass.task", VK_SHADER_STAGE_TASK_BIT_EXT, false, {});
+            const ResourceID l_MeshShaderID = l_Device.createShader("shaders/grass.mesh", VK_SHADER_STAGE_MESH_BIT_EXT, false, {});
+
+            // No vertex input, the mesh shader writes the blade triangles itself. The input assembly state is ignored
+            VulkanPipelineBuilder l_PipelineBuilder{l_Device.getID()};
+            l_SetGrassPipelineState(l_PipelineBuilder);
+            l_PipelineBuilder.addShaderStage(l_TaskShaderID, "main");
+            l_PipelineBuilder.addShaderStage(l_MeshShaderID, "main");
+            l_PipelineBuilder.addShaderStage(l_FragmentShaderID, "main");
+            m_MeshGrassPipelineID = l_Device.createPipeline(l_PipelineBuilder, m_MeshPipelineLayoutID, m_Engine.getRenderPassID(), 0);
+
+            l_Device.freeShader(l_TaskShaderID);
+            l_Device.freeShader(l_MeshShaderID);
+        }
 
         l_Device.freeShader(l_VertexShaderID);
         l_Device.freeShader(l_FragmentShaderID);
+        l_Device.freeShader(l_ProceduralVertexShaderID);
+        l_Device.freeShader(l_ToroidalVertexShaderID);
     }
 
     // Blade vertex buffers
@@ -326,8 +688,11 @@ void GrassEngine::update(const glm::ivec2 p_CameraTile, const float p_HeightmapS
 
     m_PushConstants.windDir = glm::normalize(glm::vec2(glm::sin(m_ImguiWindDirection), glm::cos(m_ImguiWindDirection)));
 
-    m_WindOffset += m_PushConstants.windDir * m_ImguiWindSpeed * m_Engine.getDelta(); 
-    m_WindNoise.updateOffset(m_TileOffset + m_WindOffset);
+    // Last frame's wind is drawn from now on, this frame's is generated one step ahead for the next one
+    m_WindNoise.swapPingPong();
+    const glm::vec2 l_WindStep = m_PushConstants.windDir * m_ImguiWindSpeed * m_Engine.getDelta();
+    m_WindOffset += l_WindStep;
+    m_WindNoise.updateOffset(m_TileOffset + m_WindOffset + l_WindStep);
 
     if (m_ImguiWAnimated)
         m_WindNoise.shiftW(m_ImguiWindWSpeed * m_Engine.getDelta() * m_ImguiWindSpeed);
@@ -351,6 +716,8 @@ void GrassEngine::updateGrassDensity(const std::array<uint32_t, 4> p_NewDensitie
     m_GrassDensities = p_NewDensities;
     m_NeedsUpdate = true;
     m_NeedsInstanceRebuild = true;
+    // The tile buffer header holds the instance offsets, so the next culling update has to upload it
+    m_IncrementalCuller.invalidate();
 }
 
 void GrassEngine::changeCurrentCenter(const glm::ivec2 p_NewCenter, const glm::vec2 p_Offset)
@@ -361,6 +728,72 @@ void GrassEngine::changeCurrentCenter(const glm::ivec2 p_NewCenter, const glm::v
     m_NeedsUpdate = true;
 }
 
+void GrassEngine::setGpuCulling(const bool p_Enabled)
+{
+    if (m_GpuCulling == p_Enabled)
+        return;
+
+    m_GpuCulling = p_Enabled;
+    m_Engine.getHiZEngine().setEnabled(isOcclusionCulling());
+    m_IncrementalCuller.invalidate();
+    m_NeedsCullingUpdate = true;
+    m_NeedsCullTableUpload = true;
+    m_NeedsUpdate = true;
+}
+
+void GrassEngine::setCompactInstances(const bool p_Enabled)
+{
+    if (m_CompactInstances == p_Enabled)
+        return;
+
+    m_CompactInstances = p_Enabled;
+    if (p_Enabled)
+        m_ToroidalInstances = false;
+    m_NeedsInstanceRebuild = true;
+    m_NeedsUpdate = true;
+}
+
+void GrassEngine::setToroidalInstances(const bool p_Enabled)
+{
+    if (m_ToroidalInstances == p_Enabled)
+        return;
+
+    // The store is larger than the pre-cull instance count, both sets are replaced and start over with a full generation
+    m_ToroidalInstances = p_Enabled;
+    if (p_Enabled)
+        m_CompactInstances = false;
+    m_NeedsInstanceRebuild = true;
+    m_NeedsUpdate = true;
+}
+
+void GrassEngine::setProceduralBlades(const bool p_Enabled)
+{
+    if (m_ProceduralBlades == p_Enabled)
+        return;
+
+    // The instance buffers are freed while procedural and allocated again when leaving it
+    m_ProceduralBlades = p_Enabled;
+    if (!p_Enabled)
+        m_MeshShaders = false;
+    m_NeedsInstanceRebuild = true;
+    m_NeedsUpdate = true;
+}
+
+void GrassEngine::setMeshShaders(const bool p_Enabled)
+{
+    // Only changes how the procedural sets are drawn, nothing has to be recomputed
+    m_MeshShaders = p_Enabled && m_Engine.isMeshShaderSupported();
+    if (m_MeshShaders)
+        setProceduralBlades(true);
+}
+
+void GrassEngine::setOcclusionCulling(const bool p_Enabled)
+{
+    m_OcclusionCulling = p_Enabled;
+    // The pyramid is only built while something reads it
+    m_Engine.getHiZEngine().setEnabled(isOcclusionCulling());
+}
+
 bool GrassEngine::recompute(VulkanCommandBuffer& p_CmdBuffer, const float p_TileSize, const uint32_t p_GridSize, const float p_HeightmapScale)
 {
     if (!m_NeedsUpdate)
@@ -368,15 +801,25 @@ bool GrassEngine::recompute(VulkanCommandBuffer& p_CmdBuffer, const float p_Tile
 
     rebuildInstanceResources();
 
+    // The front set stays on screen until the frames drawing the back one are done, nothing waits on the host
+    if (!isBackSetFree())
+    {
+        m_DebugDeferredUpdates++;
+        return false;
+    }
+
+    BufferSet& l_Set = getBackSet();
+    VulkanDevice& l_Device = m_Engine.getDevice();
+
     if (!p_CmdBuffer.isRecording())
     {
         p_CmdBuffer.reset();
         p_CmdBuffer.beginRecording();
     }
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineID);
-    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineLayoutID, m_ComputeDescriptorSetID);
-    
+    if (m_GpuCulling)
+        recordGpuCulling(p_CmdBuffer, l_Set, p_TileSize, p_GridSize, p_HeightmapScale);
+
     const uint32_t groupCount = (getPostCullInstanceCount() + 255) / 256;
 
     const ComputePushConstantData l_PushConstants{
@@ -388,39 +831,283 @@ bool GrassEngine::recompute(VulkanCommandBuffer& p_CmdBuffer, const float p_Tile
         .gridExtent = p_TileSize * p_GridSize,
         .heightmapScale = p_HeightmapScale,
         .grassBaseHeight = m_ImguiGrassBaseHeight,
-        .grassHeightVariation = m_ImguiGrassHeightVariation
+        .grassHeightVariation = m_ImguiGrassHeightVariation,
+        .bladeCulling = isBladeCulling(),
+        .compactInstances = m_CompactInstances,
+        .toroidalInstances = isToroidalStore(),
+        .heightmapOrigin = m_Engine.getHeightmap().getSampleOrigin(),
+        .grassHeightOrigin = m_HeightNoise.getSampleOrigin()
     };
 
-    VulkanBuffer& l_InstanceDataBuffer = m_Engine.getDevice().getBuffer(m_InstanceDataBufferID);
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, "Grass compute", m_Engine.getComputeQueuePos().familyIndex);
 
-    VulkanMemoryBarrierBuilder l_BufferBarrierEnter{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
-    l_BufferBarrierEnter.addBufferMemoryBarrier(m_InstanceDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, m_Engine.getComputeQueuePos().familyIndex);
-    p_CmdBuffer.cmdPipelineBarrier(l_BufferBarrierEnter);
-    l_InstanceDataBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+    if (m_ProceduralBlades)
+    {
+        // Nothing is dispatched, the draw places every blade itself from the same inputs the grass compute would get.
+        // The set is not drawn by any frame in flight, so its placement buffer can be written from here
+        *l_Set.placementData = l_PushConstants;
+        m_DebugComputeThreads = 0;
+
+        if (m_GpuCulling)
+            recordCullReadback(p_CmdBuffer, l_Set);
+
+        // Written by the tile upload or the culling pass, read by the vertex or task and mesh shaders instead of the grass compute
+        VulkanMemoryBarrierBuilder l_TileBarrierExit{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, getProceduralReadStages(), 0};
+        l_TileBarrierExit.addBufferMemoryBarrier(l_Set.tileDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
+        p_CmdBuffer.cmdPipelineBarrier(l_TileBarrierExit);
+        l_Device.getBuffer(l_Set.tileDataBufferID).setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    }
+    else if (isToroidalStore())
+    {
+        // The draw reads the blades of every visible tile from the store through the tile list, like procedural sets.
+        // Only the tiles the set's store does not hold for the current grid are generated, culling changes generate nothing
+        *l_Set.placementData = l_PushConstants;
 
-    m_DebugComputeThreads = groupCount * 256;
-    p_CmdBuffer.cmdPushConstant(m_ComputePipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstantData), &l_PushConstants);
-    p_CmdBuffer.cmdDispatch(groupCount, 1, 1);
+        const glm::ivec2 l_CenterTile = glm::ivec2(glm::round(glm::vec2(m_CurrentTile) / p_TileSize));
+        const StoreInputs l_StoreInputs = getStoreInputs(l_PushConstants);
+        const bool l_FullStore = !l_Set.storeValid || !(l_Set.storeInputs == l_StoreInputs);
+        const uint32_t l_DirtyGroupCount = (writeDirtyTiles(l_Set, l_CenterTile, l_FullStore) + 255) / 256;
+        m_DebugComputeThreads = l_DirtyGroupCount * 256;
 
-    VulkanMemoryBarrierBuilder l_BufferBarrierExit{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0};
-    l_BufferBarrierExit.addBufferMemoryBarrier(m_InstanceDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
-    p_CmdBuffer.cmdPipelineBarrier(l_BufferBarrierExit);
-    l_InstanceDataBuffer.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+        if (l_DirtyGroupCount > 0)
+        {
+            p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineID);
+            p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineLayoutID, l_Set.toroidalComputeDescriptorSetID);
+
+            VulkanBuffer& l_StoreBuffer = l_Device.getBuffer(l_Set.instanceDataBufferID);
+
+            VulkanMemoryBarrierBuilder l_StoreBarrierEnter{l_Device.getID(), VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+            l_StoreBarrierEnter.addBufferMemoryBarrier(l_Set.instanceDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, m_Engine.getComputeQueuePos().familyIndex);
+            p_CmdBuffer.cmdPipelineBarrier(l_StoreBarrierEnter);
+            l_StoreBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+
+            p_CmdBuffer.cmdPushConstant(m_ComputePipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstantData), &l_PushConstants);
+            PipelineStatistics& l_Statistics = m_Engine.getPipelineStatistics();
+            l_Statistics.cmdBeginCompute(p_CmdBuffer, PipelineStatistics::GRASS_COMPUTE);
+            p_CmdBuffer.cmdDispatch(l_DirtyGroupCount, 1, 1);
+            l_Statistics.cmdEndCompute(p_CmdBuffer, PipelineStatistics::GRASS_COMPUTE);
+
+            VulkanMemoryBarrierBuilder l_StoreBarrierExit{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0};
+            l_StoreBarrierExit.addBufferMemoryBarrier(l_Set.instanceDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
+            p_CmdBuffer.cmdPipelineBarrier(l_StoreBarrierExit);
+            l_StoreBuffer.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+        }
+
+        l_Set.storeValid = true;
+        l_Set.storeTile = l_CenterTile;
+        l_Set.storeInputs = l_StoreInputs;
+
+        if (m_GpuCulling)
+            recordCullReadback(p_CmdBuffer, l_Set);
+
+        VulkanMemoryBarrierBuilder l_TileBarrierExit{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0};
+        l_TileBarrierExit.addBufferMemoryBarrier(l_Set.tileDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
+        p_CmdBuffer.cmdPipelineBarrier(l_TileBarrierExit);
+        l_Device.getBuffer(l_Set.tileDataBufferID).setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    }
+    else
+    {
+        p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineID);
+        p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipelineLayoutID, l_Set.computeDescriptorSetID);
+
+        VulkanBuffer& l_InstanceDataBuffer = l_Device.getBuffer(l_Set.instanceDataBufferID);
+
+        VulkanMemoryBarrierBuilder l_BufferBarrierEnter{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+        l_BufferBarrierEnter.addBufferMemoryBarrier(l_Set.instanceDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, m_Engine.getComputeQueuePos().familyIndex);
+        p_CmdBuffer.cmdPipelineBarrier(l_BufferBarrierEnter);
+        l_InstanceDataBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+
+        p_CmdBuffer.cmdPushConstant(m_ComputePipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstantData), &l_PushConstants);
+        PipelineStatistics& l_Statistics = m_Engine.getPipelineStatistics();
+        l_Statistics.cmdBeginCompute(p_CmdBuffer, PipelineStatistics::GRASS_COMPUTE);
+        if (m_GpuCulling)
+        {
+            // The group count was written by the culling pass
+            vkCmdDispatchIndirect(*p_CmdBuffer, *m_Engine.getDevice().getBuffer(l_Set.indirectBufferID), offsetof(CullIndirectData, dispatch));
+        }
+        else
+        {
+            m_DebugComputeThreads = groupCount * 256;
+            p_CmdBuffer.cmdDispatch(groupCount, 1, 1);
+        }
+        l_Statistics.cmdEndCompute(p_CmdBuffer, PipelineStatistics::GRASS_COMPUTE);
+
+        if (m_GpuCulling)
+            recordCullReadback(p_CmdBuffer, l_Set);
+
+        VulkanMemoryBarrierBuilder l_BufferBarrierExit{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0};
+        l_BufferBarrierExit.addBufferMemoryBarrier(l_Set.instanceDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
+        p_CmdBuffer.cmdPipelineBarrier(l_BufferBarrierExit);
+        l_InstanceDataBuffer.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    }
+
+    if (m_GpuCulling)
+    {
+        VulkanMemoryBarrierBuilder l_IndirectBarrierExit{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0};
+        l_IndirectBarrierExit.addBufferMemoryBarrier(l_Set.indirectBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, m_Engine.getGraphicsQueuePos().familyIndex);
+        p_CmdBuffer.cmdPipelineBarrier(l_IndirectBarrierExit);
+        m_Engine.getDevice().getBuffer(l_Set.indirectBufferID).setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    }
 
-    VulkanDevice& l_Device = m_Engine.getDevice();
     VulkanImage& l_HeightmapImage = l_Device.getImage(m_Engine.getHeightmap().noiseImage.image);
 
-    VulkanMemoryBarrierBuilder l_ExitBarrierBuilder2{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0};
+    VulkanMemoryBarrierBuilder l_ExitBarrierBuilder2{m_Engine.getDevice().getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_ProceduralBlades ? getProceduralReadStages() : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0};
     l_ExitBarrierBuilder2.addImageMemoryBarrier(m_Engine.getHeightmap().noiseImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_Engine.getGraphicsQueuePos().familyIndex, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT);
+    // Procedural blades sample the grass height in the vertex shader as well
+    if (m_ProceduralBlades)
+        l_ExitBarrierBuilder2.addImageMemoryBarrier(m_HeightNoise.noiseImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_Engine.getGraphicsQueuePos().familyIndex, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT);
     p_CmdBuffer.cmdPipelineBarrier(l_ExitBarrierBuilder2);
     l_HeightmapImage.setLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     l_HeightmapImage.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    if (m_ProceduralBlades)
+    {
+        VulkanImage& l_GrassHeightImage = l_Device.getImage(m_HeightNoise.noiseImage.image);
+        l_GrassHeightImage.setLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        l_GrassHeightImage.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    }
+
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+
+    l_Set.instanceCounts = getPostCullInstanceCounts();
+    // The visible tiles of a GPU culled set are only known on the GPU, so the mesh draw covers all of them and the task shader clamps
+    const std::array<uint32_t, 4> l_MeshTileCounts = m_GpuCulling ? getPreCullTileCounts() : getPostCullTileCounts();
+    for (uint32_t i = 0; i < l_Set.meshClusterCounts.size(); ++i)
+        l_Set.meshClusterCounts[i] = getMeshClusterCount(i, l_MeshTileCounts[i]);
+    l_Set.gpuCulled = m_GpuCulling;
+    l_Set.procedural = m_ProceduralBlades;
+    l_Set.toroidal = isToroidalStore();
+    l_Set.compactInstances = m_CompactInstances;
+    l_Set.instanceOrigin = glm::vec4(l_PushConstants.worldOffset, l_PushConstants.gridExtent, 0.f);
+    l_Set.readbackPending = m_GpuCulling;
+    l_Set.computeFrame = m_Engine.getCurrentFrame();
+    l_Set.lastDrawFrame = UINT32_MAX;
+
+    // The render of this frame waits on the submission and draws the new front, the old one was last drawn a frame earlier
+    getFrontSet().lastDrawFrame = l_Set.computeFrame == 0 ? UINT32_MAX : l_Set.computeFrame - 1;
+    m_FrontSet = (m_FrontSet + 1) % s_BufferSetCount;
 
     m_NeedsUpdate = false;
 
     return true;
 }
 
+VkPipelineStageFlags GrassEngine::getProceduralReadStages() const
+{
+    if (m_Engine.isMeshShaderSupported())
+        return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+    return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+}
+
+uint32_t GrassEngine::getMeshClusterCount(const uint32_t p_Lod, const uint32_t p_TileCount) const
+{
+    // Patches on the last row and column are cut short when the density is not a multiple of the patch size
+    const uint32_t l_PatchesPerSide = (m_GrassDensities[p_Lod] + s_MeshClusterSize - 1) / s_MeshClusterSize;
+    return p_TileCount * l_PatchesPerSide * l_PatchesPerSide;
+}
+
+GrassEngine::StoreInputs GrassEngine::getStoreInputs(const ComputePushConstantData& p_Placement) const
+{
+    StoreInputs l_Inputs{
+        .placement = p_Placement,
+        .heightmapNoise = m_Engine.getHeightmap().noisePushConstants,
+        .grassHeightNoise = m_HeightNoise.noisePushConstants,
+    };
+
+    // Both noises are offset by the grid center over the grid extent on every crossing
+    const glm::vec2 l_CenterOffset = p_Placement.centerPos / p_Placement.gridExtent;
+    l_Inputs.placement.centerPos = glm::vec2(0.f);
+    l_Inputs.placement.worldOffset = glm::vec2(0.f);
+    l_Inputs.heightmapNoise.offset -= l_CenterOffset;
+    l_Inputs.grassHeightNoise.offset -= l_CenterOffset;
+    return l_Inputs;
+}
+
+bool GrassEngine::StoreInputs::operator==(const StoreInputs& p_Other) const
+{
+    auto l_SameNoise = [](const NoiseEngine::NoisePushConstantData& p_A, const NoiseEngine::NoisePushConstantData& p_B)
+    {
+        // The relative offsets come out of float math on different centers, a real change moves them by far more
+        constexpr float l_OffsetEpsilon = 1e-4f;
+        return glm::all(glm::lessThanEqual(glm::abs(p_A.offset - p_B.offset), glm::vec2(l_OffsetEpsilon)))
+            && p_A.size == p_B.size && p_A.w == p_B.w && p_A.scale == p_B.scale && p_A.octaves == p_B.octaves
+            && p_A.persistence == p_B.persistence && p_A.lacunarity == p_B.lacunarity;
+    };
+
+    const ComputePushConstantData& l_A = placement;
+    const ComputePushConstantData& l_B = p_Other.placement;
+    return l_A.tileGridSizes == l_B.tileGridSizes && l_A.tileDensities == l_B.tileDensities
+        && l_A.tileSize == l_B.tileSize && l_A.gridExtent == l_B.gridExtent && l_A.heightmapScale == l_B.heightmapScale
+        && l_A.grassBaseHeight == l_B.grassBaseHeight && l_A.grassHeightVariation == l_B.grassHeightVariation
+        && l_SameNoise(heightmapNoise, p_Other.heightmapNoise) && l_SameNoise(grassHeightNoise, p_Other.grassHeightNoise);
+}
+
+uint32_t GrassEngine::writeDirtyTiles(BufferSet& p_Set, const glm::ivec2 p_CenterTile, const bool p_Full)
+{
+    CPU_PROFILE_ZONE("Toroidal dirty tiles");
+
+    const std::array<uint32_t, 4> l_TileCounts = getPreCullTileCounts();
+    const int32_t l_GridSize = static_cast<int32_t>(m_TileGridSizes[3]);
+    // A world tile at grid position p now was at p + shift when the store was generated
+    const glm::ivec2 l_Shift = p_CenterTile - p_Set.storeTile;
+
+    auto* l_Elems = reinterpret_cast<TileBufferElem*>(static_cast<uint8_t*>(p_Set.dirtyTileData) + sizeof(TileBufferHeader));
+    std::array<uint32_t, 4> l_DirtyCounts{};
+    uint32_t l_DirtyTiles = 0;
+    uint32_t l_RingStart = 0;
+    for (uint32_t l_Ring = 0; l_Ring < 4; ++l_Ring)
+    {
+        const uint32_t l_RingEnd = l_RingStart + l_TileCounts[l_Ring];
+        for (uint32_t i = l_RingStart; i < l_RingEnd; ++i)
+        {
+            const uint32_t l_GlobalTile = m_GlobalTilePositions[i];
+            if (!p_Full)
+            {
+                // Tiles that were in the same ring already hold their blades in the slot of their world tile
+                const glm::ivec2 l_OldPos = glm::ivec2(static_cast<int32_t>(l_GlobalTile) % l_GridSize, static_cast<int32_t>(l_GlobalTile) / l_GridSize) + l_Shift;
+                if (l_OldPos.x >= 0 && l_OldPos.y >= 0 && l_OldPos.x < l_GridSize && l_OldPos.y < l_GridSize)
+                {
+                    const uint32_t l_OldIndex = m_GlobalToPreCullIndex[l_OldPos.y * l_GridSize + l_OldPos.x];
+                    if (l_OldIndex >= l_RingStart && l_OldIndex < l_RingEnd)
+                        continue;
+                }
+            }
+
+            l_Elems[l_DirtyTiles++] = { .globalTileIndex = l_GlobalTile, .tileIndex = i - l_RingStart };
+            l_DirtyCounts[l_Ring]++;
+        }
+        l_RingStart = l_RingEnd;
+    }
+
+    std::array<uint32_t, 4> l_DirtyBlades{};
+    for (uint32_t i = 0; i < 4; ++i)
+        l_DirtyBlades[i] = l_DirtyCounts[i] * m_GrassDensities[i] * m_GrassDensities[i];
+
+    const TileBufferHeader l_Header{
+        .instanceOffsets = { 0, l_DirtyBlades[0], l_DirtyBlades[0] + l_DirtyBlades[1], l_DirtyBlades[0] + l_DirtyBlades[1] + l_DirtyBlades[2] },
+        .tileOffsets = { 0, l_DirtyCounts[0], l_DirtyCounts[0] + l_DirtyCounts[1], l_DirtyCounts[0] + l_DirtyCounts[1] + l_DirtyCounts[2] },
+        .instanceCounts = { l_DirtyBlades[0], l_DirtyBlades[1], l_DirtyBlades[2], l_DirtyBlades[3] }
+    };
+    memcpy(p_Set.dirtyTileData, &l_Header, sizeof(TileBufferHeader));
+
+    m_DebugRegeneratedTiles = l_DirtyTiles;
+    return l_DirtyBlades[0] + l_DirtyBlades[1] + l_DirtyBlades[2] + l_DirtyBlades[3];
+}
+
+bool GrassEngine::isBackSetFree() const
+{
+    const BufferSet& l_Back = m_BufferSets[(m_FrontSet + 1) % s_BufferSetCount];
+    return l_Back.lastDrawFrame == UINT32_MAX || m_Engine.isFrameFinished(l_Back.lastDrawFrame);
+}
+
+bool GrassEngine::isTileUploadNeeded() const
+{
+    // A set computed with an older tile list gets the current one before it is computed again
+    const BufferSet& l_Back = m_BufferSets[(m_FrontSet + 1) % s_BufferSetCount];
+    return l_Back.tileDataVersion != m_TileDataVersion && (m_NeedsTransfer || m_NeedsUpdate);
+}
+
 bool GrassEngine::recomputeWind(VulkanCommandBuffer& p_CmdBuffer)
 {
     return m_Engine.getNoiseEngine().recalculate(p_CmdBuffer, m_WindNoise);
@@ -428,33 +1115,115 @@ bool GrassEngine::recomputeWind(VulkanCommandBuffer& p_CmdBuffer)
 
 bool GrassEngine::recomputeHeight(VulkanCommandBuffer& p_CmdBuffer)
 {
+    // Its semaphore is only waited on by the grass compute, which would be deferred as well
+    if (!isBackSetFree())
+        return false;
+
     const bool l_RecomputedHeight = m_Engine.getNoiseEngine().recalculate(p_CmdBuffer, m_HeightNoise);
     if (l_RecomputedHeight)
         m_NeedsUpdate = true;
     return l_RecomputedHeight;
 }
 
-void GrassEngine::render(const VulkanCommandBuffer&  p_CmdBuffer)
+void GrassEngine::prepareRender()
 {
     if (!m_RenderEnabled) return;
 
-    const std::array<uint32_t, 4> l_InstanceCounts = getPostCullInstanceCounts();
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    const BufferSet& l_Set = getFrontSet();
+    RenderHandles& l_Handles = m_RenderHandles;
+    l_Handles.extent = m_Engine.getRenderExtent();
+    l_Handles.indirectBuffer = l_Set.gpuCulled ? *l_Device.getBuffer(l_Set.indirectBufferID) : VK_NULL_HANDLE;
+
+    // Procedural sets hold everything the mesh shaders read, so the draw can switch without recomputing
+    if (l_Set.procedural && m_MeshShaders)
+    {
+        l_Handles.pipeline = *l_Device.getPipeline(m_MeshGrassPipelineID);
+        l_Handles.pipelineLayout = *l_Device.getPipelineLayout(m_MeshPipelineLayoutID);
+        l_Handles.descriptorSet = *l_Device.getDescriptorSet(l_Set.proceduralDescriptorSetIDs[m_WindNoise.frontIndex]);
+        return;
+    }
+
+    ResourceID l_PipelineID;
+    if (l_Set.procedural)
+        l_PipelineID = m_ProceduralGrassPipelineID;
+    else if (l_Set.toroidal)
+        l_PipelineID = m_ToroidalGrassPipelineID;
+    else
+        l_PipelineID = l_Set.compactInstances ? m_CompactGrassPipelineID : m_GrassPipelineID;
+    l_Handles.pipeline = *l_Device.getPipeline(l_PipelineID);
+
+    const VkBuffer l_LODBuffer = *l_Device.getBuffer(m_VertexBufferData.m_LODBuffer);
+    l_Handles.indexBuffer = l_LODBuffer;
+
+    // Toroidal sets find their blades through the tile list as well, so they are bound the same way.
+    // Those blades only read the blade vertices, which are bound to the first binding instead
+    if (l_Set.procedural || l_Set.toroidal)
+    {
+        l_Handles.pipelineLayout = *l_Device.getPipelineLayout(m_ProceduralPipelineLayoutID);
+        l_Handles.descriptorSet = *l_Device.getDescriptorSet(l_Set.proceduralDescriptorSetIDs[m_WindNoise.frontIndex]);
+        l_Handles.vertexBuffers = { l_LODBuffer, VK_NULL_HANDLE };
+        l_Handles.vertexBufferCount = 1;
+    }
+    else
+    {
+        l_Handles.pipelineLayout = *l_Device.getPipelineLayout(m_GrassPipelineLayoutID);
+        l_Handles.descriptorSet = *l_Device.getDescriptorSet(m_GrassDescriptorSetIDs[m_WindNoise.frontIndex]);
+        l_Handles.vertexBuffers = { *l_Device.getBuffer(l_Set.instanceDataBufferID), l_LODBuffer };
+        l_Handles.vertexBufferCount = 2;
+    }
+}
 
-    const std::array<ResourceID, 2 > l_Buffers = { m_InstanceDataBufferID, m_VertexBufferData.m_LODBuffer };
+void GrassEngine::render(const VulkanCommandBuffer&  p_CmdBuffer)
+{
+    if (!m_RenderEnabled) return;
+
+    const BufferSet& l_Set = getFrontSet();
+    const std::array<uint32_t, 4>& l_InstanceCounts = l_Set.instanceCounts;
+    const RenderHandles& l_Handles = m_RenderHandles;
     constexpr std::array<VkDeviceSize, 2> l_Offsets = { 0, 0 };
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_GrassPipelineID);
-    p_CmdBuffer.cmdBindVertexBuffers(l_Buffers, l_Offsets);
-    p_CmdBuffer.cmdBindIndexBuffer(m_VertexBufferData.m_LODBuffer, m_VertexBufferData.m_IndexStart, VK_INDEX_TYPE_UINT16);
-    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, m_GrassPipelineLayoutID, m_GrassDescriptorSetID);
+    const VkExtent2D extent = l_Handles.extent;
+
+    VkViewport viewport;
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor;
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+
+    vkCmdBindPipeline(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, l_Handles.pipeline);
+    p_CmdBuffer.cmdSetViewport(viewport);
+    p_CmdBuffer.cmdSetScissor(scissor);
+    vkCmdBindDescriptorSets(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, l_Handles.pipelineLayout, 0, 1, &l_Handles.descriptorSet, 0, nullptr);
+
+    if (l_Set.procedural && m_MeshShaders)
+    {
+        drawMeshShaders(p_CmdBuffer, l_Set);
+        return;
+    }
+
+    vkCmdBindVertexBuffers(*p_CmdBuffer, 0, l_Handles.vertexBufferCount, l_Handles.vertexBuffers.data(), l_Offsets.data());
+    vkCmdBindIndexBuffer(*p_CmdBuffer, l_Handles.indexBuffer, m_VertexBufferData.m_IndexStart, VK_INDEX_TYPE_UINT16);
+
+    PipelineStatistics& l_Statistics = m_Engine.getPipelineStatistics();
 
     const glm::vec3 l_BaseColor = m_PushConstants.baseColor;
     const glm::vec3 l_TipColor = m_PushConstants.tipColor;
 
+    // The compact position attribute holds (height, y), only its y is kept and xz come from the uv
+    m_PushConstants.instanceScale = l_Set.compactInstances ? glm::vec4(0.f, 1.f, 0.f, glm::two_pi<float>()) : glm::vec4(1.f);
+    m_PushConstants.instanceOrigin = l_Set.compactInstances ? l_Set.instanceOrigin : glm::vec4(0.f);
+
     uint32_t l_Offset = 0;
     for (uint32_t i = 0; i < 4; ++i)
     {
-        if (l_InstanceCounts[i] == 0)
+        if (!l_Set.gpuCulled && l_InstanceCounts[i] == 0)
             continue;
 
         if (m_RandomizeLODColors)
@@ -466,9 +1235,16 @@ void GrassEngine::render(const VulkanCommandBuffer&  p_CmdBuffer)
         m_PushConstants.widthMult = m_GrassWidths[i];
         m_DebugInstanceCalls[i] = l_InstanceCounts[i];
         m_DebugInstanceOffsets[i] = l_Offset;
-        p_CmdBuffer.cmdPushConstant(m_GrassPipelineLayoutID, VK_SHADER_STAGE_VERTEX_BIT, GrassPushConstantData::getVertexShaderOffset(), GrassPushConstantData::getVertexShaderSize(), m_PushConstants.getVertexShaderData());
-        p_CmdBuffer.cmdPushConstant(m_GrassPipelineLayoutID, VK_SHADER_STAGE_FRAGMENT_BIT, GrassPushConstantData::getFragmentShaderOffset(), GrassPushConstantData::getFragmentShaderSize(), m_PushConstants.getFragmentShaderData());
-        p_CmdBuffer.cmdDrawIndexed(m_VertexBufferData.m_IndexCounts[i], m_VertexBufferData.m_IndexOffsets[i], 0, l_InstanceCounts[i], l_Offset);
+        vkCmdPushConstants(*p_CmdBuffer, l_Handles.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, GrassPushConstantData::getVertexShaderOffset(), GrassPushConstantData::getVertexShaderSize(), m_PushConstants.getVertexShaderData());
+        vkCmdPushConstants(*p_CmdBuffer, l_Handles.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, GrassPushConstantData::getFragmentShaderOffset(), GrassPushConstantData::getFragmentShaderSize(), m_PushConstants.getFragmentShaderData());
+        const auto l_LODPass = static_cast<PipelineStatistics::GraphicsPass>(PipelineStatistics::GRASS_LOD0 + i);
+        l_Statistics.cmdBeginGraphics(p_CmdBuffer, l_LODPass);
+        // With GPU culling the CPU counts lag a frame behind, so every LOD is drawn and the indirect commands decide
+        if (l_Set.gpuCulled)
+            vkCmdDrawIndexedIndirect(*p_CmdBuffer, l_Handles.indirectBuffer, i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+        else
+            p_CmdBuffer.cmdDrawIndexed(m_VertexBufferData.m_IndexCounts[i], m_VertexBufferData.m_IndexOffsets[i], 0, l_InstanceCounts[i], l_Offset);
+        l_Statistics.cmdEndGraphics(p_CmdBuffer, l_LODPass);
         l_Offset += l_InstanceCounts[i];
     }
 
@@ -476,6 +1252,59 @@ void GrassEngine::render(const VulkanCommandBuffer&  p_CmdBuffer)
     m_PushConstants.tipColor = l_TipColor;
 }
 
+void GrassEngine::drawMeshShaders(const VulkanCommandBuffer& p_CmdBuffer, const BufferSet& p_Set)
+{
+    constexpr VkShaderStageFlags l_MeshStages = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    // Past the guaranteed task workgroup count of one dimension the draw goes on in the second one
+    constexpr uint32_t l_MaxGroupsX = 65535;
+
+    PipelineStatistics& l_Statistics = m_Engine.getPipelineStatistics();
+
+    const glm::vec3 l_BaseColor = m_PushConstants.baseColor;
+    const glm::vec3 l_TipColor = m_PushConstants.tipColor;
+
+    m_PushConstants.instanceScale = glm::vec4(1.f);
+    m_PushConstants.instanceOrigin = glm::vec4(0.f);
+
+    uint32_t l_Offset = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        const uint32_t l_ClusterCount = p_Set.meshClusterCounts[i];
+        if (l_ClusterCount == 0)
+            continue;
+
+        if (m_RandomizeLODColors)
+        {
+            m_PushConstants.baseColor = glm::vec3(0.0f, 0.0f, 0.0f);
+            m_PushConstants.tipColor = m_LODColors[i];
+        }
+
+        m_PushConstants.widthMult = m_GrassWidths[i];
+        m_MeshPushConstants.lod = i;
+        m_MeshPushConstants.clusterCount = l_ClusterCount;
+        m_DebugInstanceCalls[i] = p_Set.instanceCounts[i];
+        m_DebugInstanceOffsets[i] = l_Offset;
+
+        // The fragment range overlaps the one of the task and mesh stages, so it is pushed to all three
+        vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, l_MeshStages, GrassPushConstantData::getVertexShaderOffset(), GrassPushConstantData::getVertexShaderSize(), m_PushConstants.getVertexShaderData());
+        vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, l_MeshStages | VK_SHADER_STAGE_FRAGMENT_BIT, GrassPushConstantData::getFragmentShaderOffset(), GrassPushConstantData::getFragmentShaderSize(), m_PushConstants.getFragmentShaderData());
+        vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, l_MeshStages, MeshPushConstantData::getOffset(), MeshPushConstantData::getSize(), &m_MeshPushConstants);
+
+        const uint32_t l_TaskGroups = (l_ClusterCount + s_MeshClustersPerTask - 1) / s_MeshClustersPerTask;
+        const uint32_t l_GroupsX = std::min(l_TaskGroups, l_MaxGroupsX);
+        const uint32_t l_GroupsY = (l_TaskGroups + l_GroupsX - 1) / l_GroupsX;
+
+        const auto l_LODPass = static_cast<PipelineStatistics::GraphicsPass>(PipelineStatistics::GRASS_LOD0 + i);
+        l_Statistics.cmdBeginGraphics(p_CmdBuffer, l_LODPass);
+        vkCmdDrawMeshTasksEXT(*p_CmdBuffer, l_GroupsX, l_GroupsY, 1);
+        l_Statistics.cmdEndGraphics(p_CmdBuffer, l_LODPass);
+        l_Offset += p_Set.instanceCounts[i];
+    }
+
+    m_PushConstants.baseColor = l_BaseColor;
+    m_PushConstants.tipColor = l_TipColor;
+}
+
 void GrassEngine::drawImgui()
 {
     ImGui::Begin("Grass");
@@ -561,11 +1390,61 @@ void GrassEngine::drawImgui()
     ImGui::Separator();
 
 	ImGui::Text("Rendering %u tiles out of %u (%u instances)", getPostCullTileCount(), getPreCullTileCount(), getPostCullInstanceCount());
+    bool l_ProceduralBlades = m_ProceduralBlades;
+    if (ImGui::Checkbox("Procedural Blades", &l_ProceduralBlades))
+        setProceduralBlades(l_ProceduralBlades);
+    if (m_Engine.isMeshShaderSupported())
+    {
+        bool l_MeshShaders = m_MeshShaders;
+        if (ImGui::Checkbox("Mesh Shaders", &l_MeshShaders))
+            setMeshShaders(l_MeshShaders);
+        if (m_MeshShaders)
+        {
+            ImGui::DragFloat3("Mesh LOD Distances", &m_MeshPushConstants.lodDistances.x, 1.f, 0.0f, 1000.0f);
+            ImGui::DragFloat("Mesh Cull Distance", &m_MeshPushConstants.lodDistances.w, 1.f, 1.0f, 2000.0f);
+            ImGui::DragFloat("Mesh Cull Margin", &m_MeshPushConstants.cullMargin, 0.01f, 0.0f, 5.0f);
+        }
+    }
+    bool l_ToroidalInstances = m_ToroidalInstances;
+    if (!m_ProceduralBlades && ImGui::Checkbox("Toroidal Instances", &l_ToroidalInstances))
+        setToroidalInstances(l_ToroidalInstances);
+    bool l_CompactInstances = m_CompactInstances;
+    if (!m_ProceduralBlades && !m_ToroidalInstances && ImGui::Checkbox("Compact Instances", &l_CompactInstances))
+        setCompactInstances(l_CompactInstances);
+    bool l_GpuCulling = m_GpuCulling;
+    if (ImGui::Checkbox("GPU Culling", &l_GpuCulling))
+        setGpuCulling(l_GpuCulling);
     ImGui::Checkbox("Enable Culling", &m_CullingEnable);
     if (!m_CullingEnable)
         m_CullingEnable = false;
     ImGui::Checkbox("Update Culling", &m_CullingUpdate);
     ImGui::DragFloat("Culling Margin", &m_ImguiCullingMargin, 0.1f, 0.0f, 10.0f);
+    if (!m_GpuCulling)
+    {
+        if (ImGui::Checkbox("Incremental Culling", &m_IncrementalCulling))
+            m_NeedsCullingUpdate = true;
+        if (m_IncrementalCulling && ImGui::DragFloat("Culling Guard Band", &m_ImguiCullingGuardBand, 0.1f, 0.0f, 20.0f))
+            m_NeedsCullingUpdate = true;
+        if (!m_IncrementalCulling && ImGui::Checkbox("Hierarchical Culling", &m_HierarchicalCulling))
+            m_NeedsCullingUpdate = true;
+    }
+    if (m_GpuCulling)
+    {
+        if (ImGui::Checkbox("Blade Culling", &m_BladeCulling))
+            m_NeedsUpdate = true;
+        if (m_BladeCulling)
+        {
+            if (ImGui::DragFloat("Blade Cull Distance", &m_ImguiBladeCullDistance, 1.f, 1.0f, 1000.0f))
+                m_NeedsUpdate = true;
+            if (ImGui::DragFloat("Blade Cull Margin", &m_ImguiBladeCullMargin, 0.01f, 0.0f, 5.0f))
+                m_NeedsUpdate = true;
+        }
+        bool l_OcclusionCulling = m_OcclusionCulling;
+        if (ImGui::Checkbox("Occlusion Culling", &l_OcclusionCulling))
+            setOcclusionCulling(l_OcclusionCulling);
+        if (m_OcclusionCulling)
+            ImGui::DragFloat("Occlusion Depth Bias", &m_ImguiOcclusionDepthBias, 0.00001f, 0.0f, 0.01f, "%.5f");
+    }
 
     ImGui::End();
 
@@ -575,8 +1454,26 @@ void GrassEngine::drawImgui()
     ImGui::Text("Tile Grid Sizes: %u, %u, %u, %u", m_TileGridSizes[0], m_TileGridSizes[1], m_TileGridSizes[2], m_TileGridSizes[3]);
     ImGui::Text("Grass Densities: %u, %u, %u, %u", m_GrassDensities[0], m_GrassDensities[1], m_GrassDensities[2], m_GrassDensities[3]);
     ImGui::Separator();
-    ImGui::Text("Instance buffer size %u (%u)", m_DebugInstanceBufferSize, m_DebugInstanceBufferSize / sizeof(InstanceElem));
+    ImGui::Text("Instance buffer size %u (%u)", m_DebugInstanceBufferSize, m_DebugInstanceBufferSize / getInstanceStride());
+    {
+        // Instance data of both sets, and what the draws fetch if every drawn instance is read once
+        constexpr double l_MB = 1024.0 * 1024.0;
+        const double l_PreCull = getPreCullInstanceCount();
+        const double l_PostCull = getPostCullInstanceCount();
+        if (m_MeshShaders)
+            ImGui::Text("Instance format: none, blades are placed in the mesh shader, up to %u per mesh workgroup", s_MeshClusterSize * s_MeshClusterSize);
+        else if (m_ProceduralBlades)
+            ImGui::Text("Instance format: none, blades are placed in the vertex shader");
+        else if (m_ToroidalInstances)
+            ImGui::Text("Instance format: full, toroidal store, %u tiles regenerated by the last update", m_DebugRegeneratedTiles);
+        else
+            ImGui::Text("Instance format: %s, %u bytes per blade", m_CompactInstances ? "compact" : "full", getInstanceStride());
+        ImGui::Text("Instance memory: %.1f MB full, %.1f MB compact", l_PreCull * sizeof(InstanceElem) * s_BufferSetCount / l_MB, l_PreCull * sizeof(CompactInstanceElem) * s_BufferSetCount / l_MB);
+        ImGui::Text("Toroidal store memory: %.1f MB", static_cast<double>(getToroidalStoreInstanceCount()) * sizeof(InstanceElem) * s_BufferSetCount / l_MB);
+        ImGui::Text("Instance fetch per frame: %.1f MB full, %.1f MB compact", l_PostCull * sizeof(InstanceElem) / l_MB, l_PostCull * sizeof(CompactInstanceElem) / l_MB);
+    }
     ImGui::Text("Tile buffer size %u (%u)", m_DebugTileBufferSize, (m_DebugTileBufferSize - sizeof(TileBufferHeader)) / sizeof(TileBufferElem));
+    ImGui::Text("Buffer sets: %u, set %u drawn, %u updates deferred", s_BufferSetCount, m_FrontSet, m_DebugDeferredUpdates);
     ImGui::Text("Compute Threads: %u", m_DebugComputeThreads);
     ImGui::Separator();
     ImGui::Text("Instance Calls: %u, %u, %u, %u", m_DebugInstanceCalls[0], m_DebugInstanceCalls[1], m_DebugInstanceCalls[2], m_DebugInstanceCalls[3]);
@@ -584,6 +1481,27 @@ void GrassEngine::drawImgui()
     ImGui::Separator();
     ImGui::Text("Tile Header: %u, %u, %u, %u", m_DebugTileHeader.tileOffsets[0], m_DebugTileHeader.tileOffsets[1], m_DebugTileHeader.tileOffsets[2], m_DebugTileHeader.tileOffsets[3]);
     ImGui::Text("Instance Header: %u, %u, %u, %u", m_DebugTileHeader.instanceOffsets[0], m_DebugTileHeader.instanceOffsets[1], m_DebugTileHeader.instanceOffsets[2], m_DebugTileHeader.instanceOffsets[3]);
+    ImGui::Text("Instance Counts: %u, %u, %u, %u", m_DebugTileHeader.instanceCounts[0], m_DebugTileHeader.instanceCounts[1], m_DebugTileHeader.instanceCounts[2], m_DebugTileHeader.instanceCounts[3]);
+    ImGui::Separator();
+    const HiZEngine& l_HiZ = m_Engine.getHiZEngine();
+    ImGui::Text("CPU frustum test: %s", FrustumCuller::getPathName(FrustumCuller::getBestPath()));
+    ImGui::Text("Quadtree nodes tested: %u of %u tiles", m_DebugQuadtreeNodes, getPreCullTileCount());
+    ImGui::Text("Flat culling: %u chunks of %u tiles on %u threads", m_DebugCullChunks, ParallelTileCuller::s_ChunkSize, m_Engine.getWorkerPool().getThreadCount());
+    ImGui::Text("Incremental culling: %u tiles retested, %u rebases, %u uploads skipped", m_DebugRetestedTiles, m_IncrementalCuller.getRebaseCount(), m_DebugSkippedCullUploads);
+    ImGui::Text("Hi-Z atlas: %ux%u, %u levels (%s)", l_HiZ.getAtlasSize().x, l_HiZ.getAtlasSize().y, l_HiZ.getLevelCount(), l_HiZ.isValid() ? "in use" : "inactive");
+    ImGui::Separator();
+    const PipelineStatistics& l_Statistics = m_Engine.getPipelineStatistics();
+    l_Statistics.drawImgui();
+    if (l_Statistics.isEnabled())
+    {
+        // Vertex invocations per blade show how much the vertex cache saves and what each LOD costs, fragments per blade hint at overdraw
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const PipelineStatistics::GraphicsResult& l_Result = l_Statistics.getGraphicsResult(static_cast<PipelineStatistics::GraphicsPass>(PipelineStatistics::GRASS_LOD0 + i));
+            const double l_Blades = std::max(m_DebugInstanceCalls[i], 1u);
+            ImGui::Text("LOD %u: %.2f VS invocations / blade, %.2f FS invocations / blade", i, static_cast<double>(l_Result.vertexInvocations) / l_Blades, static_cast<double>(l_Result.fragmentInvocations) / l_Blades);
+        }
+    }
 
     ImGui::End();
 
@@ -594,10 +1512,18 @@ void GrassEngine::drawImgui()
 
 bool GrassEngine::transferCulling(VulkanCommandBuffer& p_CmdBuffer)
 {
-    if (!m_NeedsTransfer)
+    if (m_GpuCulling)
+        return uploadCullTable(p_CmdBuffer);
+
+    if (!isTileUploadNeeded())
+        return false;
+
+    // The tiles are only read by the grass compute, so the upload is deferred along with it
+    if (!isBackSetFree())
         return false;
 
     rebuildTileResources();
+    BufferSet& l_Set = getBackSet();
 
     if (!p_CmdBuffer.isRecording())
     {
@@ -605,6 +1531,10 @@ bool GrassEngine::transferCulling(VulkanCommandBuffer& p_CmdBuffer)
         p_CmdBuffer.beginRecording();
     }
 
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, "Tile upload", m_Engine.getUploadQueuePos().familyIndex);
+
     {
         const std::array<uint32_t, 4> l_TileCounts = getPostCullTileCounts();
 		const std::array<uint32_t, 4> l_InstanceCounts = getPostCullInstanceCounts();
@@ -620,23 +1550,240 @@ bool GrassEngine::transferCulling(VulkanCommandBuffer& p_CmdBuffer)
                 l_TileCounts[0],
                 l_TileCounts[0] + l_TileCounts[1],
                 l_TileCounts[0] + l_TileCounts[1] + l_TileCounts[2]
-            }
+            },
+            .instanceCounts = { l_InstanceCounts[0], l_InstanceCounts[1], l_InstanceCounts[2], l_InstanceCounts[3] }
         };
         m_DebugTileHeader = l_Header;
 		VulkanDevice& l_Device = m_Engine.getDevice();
-        void* l_DataPtr = l_Device.mapStagingBuffer(sizeof(TileBufferHeader) + sizeof(TileBufferElem) * m_TileVisibilityData.size(), 0);
+        CPU_PROFILE_ZONE("Tile staging copy");
+        void* l_DataPtr = l_Set.tileUploadData;
         memcpy(l_DataPtr, &l_Header, sizeof(TileBufferHeader));
         l_DataPtr = static_cast<uint8_t*>(l_DataPtr) + sizeof(TileBufferHeader);
 		memcpy(l_DataPtr, m_TileVisibilityData.data(), sizeof(TileBufferElem) * m_TileVisibilityData.size());
-        p_CmdBuffer.ecmdDumpStagingBuffer(m_TileDataBufferID, sizeof(TileBufferHeader) + sizeof(TileBufferElem) * m_TileVisibilityData.size(), 0);
+        const VkBufferCopy l_UploadRegion{ .srcOffset = 0, .dstOffset = 0, .size = sizeof(TileBufferHeader) + sizeof(TileBufferElem) * m_TileVisibilityData.size() };
+        vkCmdCopyBuffer(*p_CmdBuffer, *l_Device.getBuffer(l_Set.tileUploadBufferID), *l_Device.getBuffer(l_Set.tileDataBufferID), 1, &l_UploadRegion);
     }
 
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+
+    l_Set.tileDataVersion = m_TileDataVersion;
     m_NeedsTransfer = false;
     m_NeedsUpdate = true;
 
     return true;
 }
 
+void GrassEngine::readBackCulling()
+{
+    BufferSet& l_Set = getFrontSet();
+    if (!m_GpuCulling || !l_Set.readbackPending || !m_Engine.isFrameFinished(l_Set.computeFrame))
+        return;
+
+    const CullIndirectData* l_Data = l_Set.cullReadbackData;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        m_PostCullTileCounts[i] = l_Data->visibleTiles[i];
+        m_DebugTileHeader.instanceOffsets[i] = l_Data->draws[i].firstInstance;
+        m_DebugTileHeader.instanceCounts[i] = l_Data->draws[i].instanceCount;
+        m_GpuInstanceCounts[i] = l_Data->draws[i].instanceCount;
+        m_DebugInstanceCalls[i] = l_Data->draws[i].instanceCount;
+        m_DebugInstanceOffsets[i] = l_Data->draws[i].firstInstance;
+    }
+    // Toroidal sets dispatch over their own tile list, not the one the culling pass sized
+    if (!l_Set.toroidal)
+        m_DebugComputeThreads = l_Data->dispatch.x * 256;
+    l_Set.readbackPending = false;
+}
+
+bool GrassEngine::uploadCullTable(VulkanCommandBuffer& p_CmdBuffer)
+{
+    if (!m_NeedsCullTableUpload)
+        return false;
+
+    // Every culling pass reads the table and the staging buffer, both are free once the latest compute is done
+    const uint32_t l_LastComputeFrame = getFrontSet().computeFrame;
+    if (!isBackSetFree() || (l_LastComputeFrame != UINT32_MAX && !m_Engine.isFrameFinished(l_LastComputeFrame)))
+        return false;
+
+    rebuildTileResources();
+
+    if (!p_CmdBuffer.isRecording())
+    {
+        p_CmdBuffer.reset();
+        p_CmdBuffer.beginRecording();
+    }
+
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, "Cull table upload", m_Engine.getUploadQueuePos().familyIndex);
+
+    {
+        const std::array<uint32_t, 4> l_TileCounts = getPreCullTileCounts();
+        const CullTableHeader l_Header{
+            .tileOffsets = {
+                0,
+                l_TileCounts[0],
+                l_TileCounts[0] + l_TileCounts[1],
+                l_TileCounts[0] + l_TileCounts[1] + l_TileCounts[2]
+            },
+            .tileCounts = { l_TileCounts[0], l_TileCounts[1], l_TileCounts[2], l_TileCounts[3] },
+            .gridInfo = { m_TileGridSizes[3], static_cast<uint32_t>(m_GlobalTilePositions.size()), 0, 0 }
+        };
+        m_DebugTileHeader.tileOffsets = l_Header.tileOffsets;
+
+        VulkanDevice& l_Device = m_Engine.getDevice();
+        CPU_PROFILE_ZONE("Cull table staging copy");
+        const VkDeviceSize l_Size = sizeof(CullTableHeader) + sizeof(uint32_t) * m_GlobalTilePositions.size();
+        void* l_DataPtr = l_Device.mapStagingBuffer(l_Size, 0);
+        memcpy(l_DataPtr, &l_Header, sizeof(CullTableHeader));
+        memcpy(static_cast<uint8_t*>(l_DataPtr) + sizeof(CullTableHeader), m_GlobalTilePositions.data(), sizeof(uint32_t) * m_GlobalTilePositions.size());
+        p_CmdBuffer.ecmdDumpStagingBuffer(m_CullTableBufferID, l_Size, 0);
+    }
+
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+
+    m_NeedsCullTableUpload = false;
+    m_NeedsUpdate = true;
+
+    return true;
+}
+
+void GrassEngine::recordGpuCulling(VulkanCommandBuffer& p_CmdBuffer, const BufferSet& p_Set, const float p_TileSize, const uint32_t p_GridSize, const float p_HeightmapScale)
+{
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    const uint32_t l_ComputeFamily = m_Engine.getComputeQueuePos().familyIndex;
+    VulkanBuffer& l_IndirectBuffer = l_Device.getBuffer(p_Set.indirectBufferID);
+
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, "Grass culling", l_ComputeFamily);
+
+    VulkanMemoryBarrierBuilder l_EnterBarrier{l_Device.getID(), VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+    l_EnterBarrier.addBufferMemoryBarrier(p_Set.indirectBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, l_ComputeFamily);
+    p_CmdBuffer.cmdPipelineBarrier(l_EnterBarrier);
+    l_IndirectBuffer.setQueue(l_ComputeFamily);
+
+    // With culling updates frozen each set keeps its last visible tiles and only the draw commands are refreshed
+    if (m_CullingUpdate)
+    {
+        vkCmdFillBuffer(*p_CmdBuffer, *l_IndirectBuffer, offsetof(CullIndirectData, visibleTiles), sizeof(CullIndirectData::visibleTiles), 0);
+
+        const HiZEngine& l_HiZ = m_Engine.getHiZEngine();
+        // recordBuild released the pyramid to the compute family at the end of the last render, this is the matching acquire.
+        // The image is already tracked on the compute queue, so both families are spelled out here instead of using the builder
+        const uint32_t l_GraphicsFamily = m_Engine.getGraphicsQueuePos().familyIndex;
+        if (l_HiZ.isValid() && l_GraphicsFamily != l_ComputeFamily)
+        {
+            const VkImageMemoryBarrier l_AtlasAcquire{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+                .srcQueueFamilyIndex = l_GraphicsFamily,
+                .dstQueueFamilyIndex = l_ComputeFamily,
+                .image = *l_Device.getImage(l_HiZ.getAtlasImage()),
+                .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+            };
+            vkCmdPipelineBarrier(*p_CmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &l_AtlasAcquire);
+        }
+
+        // Without a pyramid from a previous frame the shader only runs the frustum test
+        OcclusionParams l_OcclusionParams{
+            .vpMatrix = l_HiZ.getBuildVPMatrix(),
+            .levelInfo = glm::uvec4(l_HiZ.getLevelCount(), l_HiZ.isValid() && m_CullingEnable, 0, 0),
+            .depthSize = glm::vec2(l_HiZ.getDepthSize()),
+            .worldOffset = glm::vec2(m_CurrentTile) - (glm::vec2(p_GridSize / 2) * p_TileSize),
+            .gridExtent = p_TileSize * p_GridSize,
+            .grassMaxHeight = m_ImguiGrassBaseHeight + m_ImguiGrassHeightVariation,
+            .depthBias = m_ImguiOcclusionDepthBias,
+            .heightSlope = p_HeightmapScale * m_Engine.getHeightmap().getMaxGradient() / (p_TileSize * p_GridSize),
+            .heightmapOrigin = m_Engine.getHeightmap().getSampleOrigin(),
+            .levelRegions = l_HiZ.getLevelRegions()
+        };
+        vkCmdUpdateBuffer(*p_CmdBuffer, *l_Device.getBuffer(m_OcclusionBufferID), 0, sizeof(OcclusionParams), &l_OcclusionParams);
+
+        VulkanMemoryBarrierBuilder l_ResetBarrier{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+        l_ResetBarrier.addBufferMemoryBarrier(p_Set.indirectBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, l_ComputeFamily);
+        l_ResetBarrier.addBufferMemoryBarrier(m_OcclusionBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, l_ComputeFamily);
+        p_CmdBuffer.cmdPipelineBarrier(l_ResetBarrier);
+
+        CullPushConstantData l_PushConstants{
+            .centerPos = m_CurrentTile,
+            .tileSize = p_TileSize,
+            .heightmapScale = p_HeightmapScale,
+            .cullingMargin = m_ImguiCullingMargin
+        };
+        // A zero normal with a positive distance accepts every tile
+        if (m_CullingEnable)
+            std::copy_n(m_Engine.getCamera().getFrustumPlanes(), 6, l_PushConstants.frustumPlanes.begin());
+        else
+            l_PushConstants.frustumPlanes.fill(glm::vec4(0.f, 0.f, 0.f, 1.f));
+
+        p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineID);
+        p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayoutID, p_Set.cullDescriptorSetID);
+        p_CmdBuffer.cmdPushConstant(m_CullPipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &l_PushConstants);
+        p_CmdBuffer.cmdDispatch((getPreCullTileCount() + 63) / 64, 1, 1);
+
+        VulkanMemoryBarrierBuilder l_CullBarrier{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+        l_CullBarrier.addBufferMemoryBarrier(p_Set.indirectBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, l_ComputeFamily);
+        l_CullBarrier.addBufferMemoryBarrier(p_Set.tileDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, l_ComputeFamily);
+        p_CmdBuffer.cmdPipelineBarrier(l_CullBarrier);
+
+        if (isBladeCulling())
+        {
+            BladeCullParams l_BladeParams{
+                .frustumPlanes = l_PushConstants.frustumPlanes,
+                .cameraPos = m_Engine.getCamera().getPosition(),
+                .maxDistance = m_ImguiBladeCullDistance,
+                .margin = m_ImguiBladeCullMargin
+            };
+            vkCmdUpdateBuffer(*p_CmdBuffer, *l_Device.getBuffer(m_BladeCullBufferID), 0, sizeof(BladeCullParams), &l_BladeParams);
+
+            VulkanMemoryBarrierBuilder l_BladeParamsBarrier{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+            l_BladeParamsBarrier.addBufferMemoryBarrier(m_BladeCullBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, l_ComputeFamily);
+            p_CmdBuffer.cmdPipelineBarrier(l_BladeParamsBarrier);
+        }
+    }
+
+    const CullFinalizePushConstantData l_FinalizePushConstants{
+        .tileDensities = glm::uvec4(m_GrassDensities[0], m_GrassDensities[1], m_GrassDensities[2], m_GrassDensities[3]),
+        .indexCounts = glm::uvec4(m_VertexBufferData.m_IndexCounts[0], m_VertexBufferData.m_IndexCounts[1], m_VertexBufferData.m_IndexCounts[2], m_VertexBufferData.m_IndexCounts[3]),
+        .indexOffsets = glm::uvec4(m_VertexBufferData.m_IndexOffsets[0], m_VertexBufferData.m_IndexOffsets[1], m_VertexBufferData.m_IndexOffsets[2], m_VertexBufferData.m_IndexOffsets[3]),
+        .bladeCulling = isBladeCulling()
+    };
+
+    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_CullFinalizePipelineID);
+    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_CullFinalizePipelineLayoutID, p_Set.cullDescriptorSetID);
+    p_CmdBuffer.cmdPushConstant(m_CullFinalizePipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullFinalizePushConstantData), &l_FinalizePushConstants);
+    p_CmdBuffer.cmdDispatch(1, 1, 1);
+
+    // The grass compute reads the dispatch size and, with blade culling, appends into the draw counts
+    VulkanMemoryBarrierBuilder l_FinalizeBarrier{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+    l_FinalizeBarrier.addBufferMemoryBarrier(p_Set.indirectBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, l_ComputeFamily);
+    l_FinalizeBarrier.addBufferMemoryBarrier(p_Set.tileDataBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, l_ComputeFamily);
+    p_CmdBuffer.cmdPipelineBarrier(l_FinalizeBarrier);
+
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+}
+
+void GrassEngine::recordCullReadback(VulkanCommandBuffer& p_CmdBuffer, const BufferSet& p_Set) const
+{
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    const uint32_t l_ComputeFamily = m_Engine.getComputeQueuePos().familyIndex;
+
+    VulkanMemoryBarrierBuilder l_CopyBarrier{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    l_CopyBarrier.addBufferMemoryBarrier(p_Set.indirectBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, l_ComputeFamily);
+    p_CmdBuffer.cmdPipelineBarrier(l_CopyBarrier);
+
+    const VkBufferCopy l_ReadbackRegion{ .srcOffset = 0, .dstOffset = 0, .size = sizeof(CullIndirectData) };
+    vkCmdCopyBuffer(*p_CmdBuffer, *l_Device.getBuffer(p_Set.indirectBufferID), *l_Device.getBuffer(p_Set.cullReadbackBufferID), 1, &l_ReadbackRegion);
+
+    VulkanMemoryBarrierBuilder l_ReadbackBarrier{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0};
+    l_ReadbackBarrier.addBufferMemoryBarrier(p_Set.cullReadbackBufferID, 0, VK_WHOLE_SIZE, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT, l_ComputeFamily);
+    p_CmdBuffer.cmdPipelineBarrier(l_ReadbackBarrier);
+}
+
 uint32_t GrassEngine::getPreCullInstanceCount() const
 {
     const std::array<uint32_t, 4> l_InstanceCounts = getPreCullInstanceCounts();
@@ -662,6 +1809,9 @@ uint32_t GrassEngine::getPostCullInstanceCount() const
 
 std::array<uint32_t, 4> GrassEngine::getPostCullInstanceCounts() const
 {
+    if (m_GpuCulling)
+        return m_GpuInstanceCounts;
+
     const std::array<uint32_t, 4> l_TileCounts = getPostCullTileCounts();
     return {
         l_TileCounts[0] * m_GrassDensities[0] * m_GrassDensities[0],
@@ -671,6 +1821,14 @@ std::array<uint32_t, 4> GrassEngine::getPostCullInstanceCounts() const
     };
 }
 
+uint32_t GrassEngine::getToroidalStoreInstanceCount() const
+{
+    uint32_t l_Count = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+        l_Count += m_TileGridSizes[i] * m_TileGridSizes[i] * m_GrassDensities[i] * m_GrassDensities[i];
+    return l_Count;
+}
+
 uint32_t GrassEngine::getPreCullTileCount() const
 {
     const std::array<uint32_t, 4> l_TileCounts = getPreCullTileCounts();
@@ -695,6 +1853,8 @@ uint32_t GrassEngine::getPostCullTileCount() const
 
 void GrassEngine::recalculateCulling(const float p_HeightmapScale, const float p_TileSize)
 {
+    CPU_PROFILE_ZONE("Recalculate culling");
+
     if (!m_CullingUpdate)
         return;
 
@@ -703,11 +1863,14 @@ void GrassEngine::recalculateCulling(const float p_HeightmapScale, const float p
     if (!m_NeedsCullingUpdate)
         return;
 
-    if (!m_CullingEnable)
-        m_Engine.getCamera().recalculateFrustum();
-    
-    m_TileVisibilityData.clear();
-    uint32_t l_Current = 0;
+    // The culling pass is recorded along with the grass compute, which only has to be scheduled here
+    if (m_GpuCulling)
+    {
+        m_NeedsCullingUpdate = false;
+        m_NeedsUpdate = true;
+        return;
+    }
+
     const std::array<uint32_t, 4> l_TileCounts = getPreCullTileCounts();
     const std::array<uint32_t, 4> l_TileOffsets{
         0,
@@ -716,31 +1879,106 @@ void GrassEngine::recalculateCulling(const float p_HeightmapScale, const float p
         l_TileCounts[0] + l_TileCounts[1] + l_TileCounts[2]
     };
 
-    const glm::vec2 l_TileShift = glm::vec2((m_TileGridSizes[3] / 2) * p_TileSize);
-    for (uint32_t l_LOD = 0; l_LOD < l_TileCounts.size(); l_LOD++)
+    const TileQuadtree::GridLayout l_Layout{
+        .gridSize = m_TileGridSizes[3],
+        .tileSize = p_TileSize,
+        .shift = glm::vec2((m_TileGridSizes[3] / 2) * p_TileSize),
+        .center = glm::vec2(m_CurrentTile),
+        .minY = -p_HeightmapScale,
+        .maxY = 0.0f,
+        .margin = m_ImguiCullingMargin
+    };
+
+    if (m_CullingEnable && m_IncrementalCulling)
     {
-        const uint32_t l_First = l_Current;
-        for (uint32_t l_TileIdx = l_TileOffsets[l_LOD]; l_TileIdx < l_TileOffsets[l_LOD] + l_TileCounts[l_LOD]; l_TileIdx++)
-        {
-            const uint32_t l_Tile = m_GlobalTilePositions[l_TileIdx];
-            if (m_CullingEnable)
-            {
-                const glm::vec2 l_TilePos = glm::vec2(l_Tile % m_TileGridSizes[3], l_Tile / m_TileGridSizes[3]) * p_TileSize - l_TileShift + glm::vec2(m_CurrentTile);
+        CPU_PROFILE_ZONE("Incremental culling");
+        const bool l_Changed = m_IncrementalCuller.update(m_Engine.getCamera().getFrustumPlanes(), l_Layout, m_ImguiCullingGuardBand);
+        m_DebugRetestedTiles = m_IncrementalCuller.getRetestedTileCount();
+        m_NeedsCullingUpdate = false;
 
-                glm::vec3 l_AABBMin = glm::vec3(l_TilePos.x, -p_HeightmapScale, l_TilePos.y) - glm::vec3(m_ImguiCullingMargin);
-                glm::vec3 l_AABBMax = glm::vec3(l_TilePos.x + p_TileSize, 0.0f, l_TilePos.y + p_TileSize) + glm::vec3(m_ImguiCullingMargin);
+        // Same tiles as the last upload, the tile buffer and the grass compute output are still valid
+        if (!l_Changed)
+        {
+            m_DebugSkippedCullUploads++;
+            return;
+        }
 
-                if (!m_Engine.getCamera().isBoxInFrustum(l_AABBMin, l_AABBMax))
+        m_TileVisibilityData.clear();
+        uint32_t l_Current = 0;
+        for (uint32_t l_LOD = 0; l_LOD < l_TileCounts.size(); l_LOD++)
+        {
+            const uint32_t l_First = l_Current;
+            for (uint32_t l_TileIdx = l_TileOffsets[l_LOD]; l_TileIdx < l_TileOffsets[l_LOD] + l_TileCounts[l_LOD]; l_TileIdx++)
+            {
+                if (!m_IncrementalCuller.isVisible(m_GlobalTilePositions[l_TileIdx]))
                     continue;
+
+                m_TileVisibilityData.emplace_back(m_GlobalTilePositions[l_TileIdx], l_TileIdx - l_TileOffsets[l_LOD]);
+                l_Current++;
             }
+            m_PostCullTileCounts[l_LOD] = l_Current - l_First;
+        }
+        m_TileDataVersion++;
+        m_NeedsTransfer = true;
+        return;
+    }
+
+    // The other paths rebuild the tile list from scratch, so the incremental state can't be compared against it
+    m_IncrementalCuller.invalidate();
+    m_TileVisibilityData.clear();
+
+    if (m_CullingEnable && m_HierarchicalCulling)
+    {
+        CPU_PROFILE_ZONE("Quadtree culling");
+        m_VisibleTiles.clear();
+        m_TileQuadtree.cull(m_Engine.getCamera().getFrustumPlanes(), l_Layout, m_VisibleTiles);
+        m_DebugQuadtreeNodes = m_TileQuadtree.getTestedNodeCount();
+
+        // Pre-cull indices are in LOD order, so sorting them gives the same per ring grouping as the flat walk
+        for (uint32_t& l_Tile : m_VisibleTiles)
+            l_Tile = m_GlobalToPreCullIndex[l_Tile];
+        std::sort(m_VisibleTiles.begin(), m_VisibleTiles.end());
+
+        m_PostCullTileCounts.fill(0);
+        for (const uint32_t l_TileIdx : m_VisibleTiles)
+        {
+            const uint32_t l_LOD = (l_TileIdx >= l_TileOffsets[1]) + (l_TileIdx >= l_TileOffsets[2]) + (l_TileIdx >= l_TileOffsets[3]);
+            m_TileVisibilityData.emplace_back(m_GlobalTilePositions[l_TileIdx], l_TileIdx - l_TileOffsets[l_LOD]);
+            m_PostCullTileCounts[l_LOD]++;
+        }
+    }
+    else if (m_CullingEnable)
+    {
+        CPU_PROFILE_ZONE("Frustum test");
+        WorkerPool& l_Pool = m_Engine.getWorkerPool();
+        m_ParallelCuller.cull(l_Pool, m_Engine.getCamera().getFrustumPlanes(), l_Layout, m_GlobalTilePositions, l_TileOffsets);
+        m_DebugCullChunks = m_ParallelCuller.getChunkCount();
+
+        // Chunks cover consecutive pre-cull ranges, appending them in order keeps the tiles grouped per LOD
+        m_PostCullTileCounts.fill(0);
+        for (uint32_t l_ChunkIdx = 0; l_ChunkIdx < m_ParallelCuller.getChunkCount(); l_ChunkIdx++)
+        {
+            const ParallelTileCuller::Chunk& l_Chunk = m_ParallelCuller.getChunk(l_ChunkIdx);
+            for (const ParallelTileCuller::VisibleTile& l_Tile : l_Chunk.tiles)
+                m_TileVisibilityData.emplace_back(l_Tile.globalTileIndex, l_Tile.tileIndex);
+            for (uint32_t l_LOD = 0; l_LOD < l_Chunk.counts.size(); l_LOD++)
+                m_PostCullTileCounts[l_LOD] += l_Chunk.counts[l_LOD];
+        }
+    }
+    else
+    {
+        m_Engine.getCamera().recalculateFrustum();
 
-            m_TileVisibilityData.emplace_back(l_Tile, l_TileIdx - l_TileOffsets[l_LOD]);
-            l_Current++;
+        for (uint32_t l_LOD = 0; l_LOD < l_TileCounts.size(); l_LOD++)
+        {
+            for (uint32_t l_TileIdx = l_TileOffsets[l_LOD]; l_TileIdx < l_TileOffsets[l_LOD] + l_TileCounts[l_LOD]; l_TileIdx++)
+                m_TileVisibilityData.emplace_back(m_GlobalTilePositions[l_TileIdx], l_TileIdx - l_TileOffsets[l_LOD]);
+            m_PostCullTileCounts[l_LOD] = l_TileCounts[l_LOD];
         }
-        m_PostCullTileCounts[l_LOD] = l_Current - l_First;
     }
 
     m_NeedsCullingUpdate = false;
+    m_TileDataVersion++;
     m_NeedsTransfer = true;
 }
 
@@ -751,34 +1989,88 @@ void GrassEngine::rebuildInstanceResources()
 
     VulkanDevice& l_Device = m_Engine.getDevice();
 
-	if (m_InstanceDataBufferID != UINT32_MAX)
-		l_Device.freeBuffer(m_InstanceDataBufferID);
+    // Both sets are replaced, so the frames still drawing the front one have to finish. Density changes are rare enough to drain for.
+    // Procedural sets have no instance buffer but are reset all the same
+    if (m_BufferSets[0].computeFrame != UINT32_MAX || m_BufferSets[1].computeFrame != UINT32_MAX)
+        l_Device.waitIdle();
 
-    m_DebugInstanceBufferSize = sizeof(InstanceElem) * getPreCullInstanceCount();
-	m_InstanceDataBufferID = l_Device.createBuffer(m_DebugInstanceBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Engine.getComputeQueuePos().familyIndex);
-	VulkanBuffer& l_InstanceDataBuffer = l_Device.getBuffer(m_InstanceDataBufferID);
-	l_InstanceDataBuffer.allocateFromFlags({.desiredProperties= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired= false});
-	l_InstanceDataBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+    if (m_ProceduralBlades)
+        m_DebugInstanceBufferSize = 0;
+    else if (isToroidalStore())
+        m_DebugInstanceBufferSize = sizeof(InstanceElem) * getToroidalStoreInstanceCount();
+    else
+        m_DebugInstanceBufferSize = getInstanceStride() * getPreCullInstanceCount();
 
-    const VkDescriptorBufferInfo l_InstanceDataBufferInfo{
-        .buffer = *l_InstanceDataBuffer,
-        .offset = 0,
-        .range = VK_WHOLE_SIZE,
-    };
+    for (BufferSet& l_Set : m_BufferSets)
+    {
+        if (l_Set.instanceDataBufferID != UINT32_MAX)
+            l_Device.freeBuffer(l_Set.instanceDataBufferID);
+        l_Set.instanceDataBufferID = UINT32_MAX;
+
+        // Nothing in flight reads the new buffers
+        l_Set.instanceCounts.fill(0);
+        l_Set.gpuCulled = false;
+        l_Set.procedural = m_ProceduralBlades;
+        l_Set.toroidal = isToroidalStore();
+        l_Set.compactInstances = m_CompactInstances;
+        l_Set.readbackPending = false;
+        l_Set.lastDrawFrame = UINT32_MAX;
+        l_Set.storeValid = false;
+
+        if (m_ProceduralBlades)
+            continue;
 
-    const std::array<VkWriteDescriptorSet, 1> l_DescriptorWrite{
-        VkWriteDescriptorSet{
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = *l_Device.getDescriptorSet(m_ComputeDescriptorSetID),
-            .dstBinding = 3,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &l_InstanceDataBufferInfo,
-        }
-    };
+        l_Set.instanceDataBufferID = l_Device.createBuffer(m_DebugInstanceBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Engine.getComputeQueuePos().familyIndex);
+        VulkanBuffer& l_InstanceDataBuffer = l_Device.getBuffer(l_Set.instanceDataBufferID);
+        l_InstanceDataBuffer.allocateFromFlags({.desiredProperties= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired= false});
+        l_InstanceDataBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
 
-    l_Device.updateDescriptorSets(l_DescriptorWrite);
+        const VkDescriptorBufferInfo l_InstanceDataBufferInfo{
+            .buffer = *l_InstanceDataBuffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        const std::array<VkWriteDescriptorSet, 2> l_DescriptorWrite{
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = *l_Device.getDescriptorSet(l_Set.computeDescriptorSetID),
+                .dstBinding = 3,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &l_InstanceDataBufferInfo,
+            },
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = *l_Device.getDescriptorSet(l_Set.toroidalComputeDescriptorSetID),
+                .dstBinding = 3,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &l_InstanceDataBufferInfo,
+            }
+        };
+
+        l_Device.updateDescriptorSets(l_DescriptorWrite);
+
+        // The toroidal draw reads the store through the procedural sets
+        for (const ResourceID l_ProceduralSetID : l_Set.proceduralDescriptorSetIDs)
+        {
+            const std::array<VkWriteDescriptorSet, 1> l_ProceduralWrite{
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_ProceduralSetID),
+                    .dstBinding = 5,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_InstanceDataBufferInfo,
+                }
+            };
+            l_Device.updateDescriptorSets(l_ProceduralWrite);
+        }
+    }
 
     m_NeedsInstanceRebuild = false;
     m_NeedsUpdate = true;
@@ -791,39 +2083,133 @@ void GrassEngine::rebuildTileResources()
 
     VulkanDevice& l_Device = m_Engine.getDevice();
 
-    if (m_TileDataBufferID != UINT32_MAX)
-        l_Device.freeBuffer(m_TileDataBufferID);
+    // Same as the instance buffers, grid changes replace both sets and the shared cull table
+    if (m_CullTableBufferID != UINT32_MAX)
+    {
+        l_Device.waitIdle();
+        l_Device.freeBuffer(m_CullTableBufferID);
+    }
 
-    m_DebugTileBufferSize = sizeof(TileBufferHeader) + sizeof(TileBufferElem) * getPreCullTileCount();
-    m_TileDataBufferID = l_Device.createBuffer(m_DebugTileBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getTransferQueuePos().familyIndex);
-    VulkanBuffer& l_TileDataBuffer = l_Device.getBuffer(m_TileDataBufferID);
-    l_TileDataBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
-	l_TileDataBuffer.setQueue(m_Engine.getTransferQueuePos().familyIndex);
+    m_CullTableBufferID = l_Device.createBuffer(sizeof(CullTableHeader) + sizeof(uint32_t) * getPreCullTileCount(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getTransferQueuePos().familyIndex);
+    VulkanBuffer& l_CullTableBuffer = l_Device.getBuffer(m_CullTableBufferID);
+    l_CullTableBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+    l_CullTableBuffer.setQueue(m_Engine.getTransferQueuePos().familyIndex);
 
-	const VkDescriptorBufferInfo l_TileDataBufferInfo{
-        .buffer = *l_TileDataBuffer,
+    const VkDescriptorBufferInfo l_CullTableBufferInfo{
+        .buffer = *l_CullTableBuffer,
         .offset = 0,
         .range = VK_WHOLE_SIZE,
     };
 
-	const std::array<VkWriteDescriptorSet, 1> l_DescriptorWrite{
-        VkWriteDescriptorSet{
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = *l_Device.getDescriptorSet(m_ComputeDescriptorSetID),
-            .dstBinding = 2,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &l_TileDataBufferInfo,
+    m_DebugTileBufferSize = sizeof(TileBufferHeader) + sizeof(TileBufferElem) * getPreCullTileCount();
+
+    for (BufferSet& l_Set : m_BufferSets)
+    {
+        if (l_Set.tileDataBufferID != UINT32_MAX)
+            l_Device.freeBuffer(l_Set.tileDataBufferID);
+        if (l_Set.tileUploadBufferID != UINT32_MAX)
+            l_Device.freeBuffer(l_Set.tileUploadBufferID);
+        if (l_Set.dirtyTileBufferID != UINT32_MAX)
+            l_Device.freeBuffer(l_Set.dirtyTileBufferID);
+
+        l_Set.tileDataBufferID = l_Device.createBuffer(m_DebugTileBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_Engine.getTransferQueuePos().familyIndex);
+        VulkanBuffer& l_TileDataBuffer = l_Device.getBuffer(l_Set.tileDataBufferID);
+        l_TileDataBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+        l_TileDataBuffer.setQueue(m_Engine.getTransferQueuePos().familyIndex);
+
+        l_Set.tileUploadBufferID = l_Device.createBuffer(m_DebugTileBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_Engine.getTransferQueuePos().familyIndex);
+        VulkanBuffer& l_TileUploadBuffer = l_Device.getBuffer(l_Set.tileUploadBufferID);
+        l_TileUploadBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, .undesiredProperties = 0, .allowUndesired = false });
+        l_TileUploadBuffer.setQueue(m_Engine.getTransferQueuePos().familyIndex);
+        l_Set.tileUploadData = l_TileUploadBuffer.map(m_DebugTileBufferSize, 0);
+
+        // Written by the host right before the dispatch that reads it, at most every tile of the grid is regenerated
+        l_Set.dirtyTileBufferID = l_Device.createBuffer(m_DebugTileBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_Engine.getComputeQueuePos().familyIndex);
+        VulkanBuffer& l_DirtyTileBuffer = l_Device.getBuffer(l_Set.dirtyTileBufferID);
+        l_DirtyTileBuffer.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, .undesiredProperties = 0, .allowUndesired = false });
+        l_DirtyTileBuffer.setQueue(m_Engine.getComputeQueuePos().familyIndex);
+        l_Set.dirtyTileData = l_DirtyTileBuffer.map(m_DebugTileBufferSize, 0);
+
+        const VkDescriptorBufferInfo l_DirtyTileBufferInfo{
+            .buffer = *l_DirtyTileBuffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        const VkDescriptorBufferInfo l_TileDataBufferInfo{
+            .buffer = *l_TileDataBuffer,
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+
+        const std::array<VkWriteDescriptorSet, 4> l_DescriptorWrite{
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = *l_Device.getDescriptorSet(l_Set.computeDescriptorSetID),
+                .dstBinding = 2,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &l_TileDataBufferInfo,
+            },
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = *l_Device.getDescriptorSet(l_Set.toroidalComputeDescriptorSetID),
+                .dstBinding = 2,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &l_DirtyTileBufferInfo,
+            },
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = *l_Device.getDescriptorSet(l_Set.cullDescriptorSetID),
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &l_CullTableBufferInfo,
+            },
+            VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = *l_Device.getDescriptorSet(l_Set.cullDescriptorSetID),
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &l_TileDataBufferInfo,
+            }
+        };
+
+        l_Device.updateDescriptorSets(l_DescriptorWrite);
+
+        for (const ResourceID l_ProceduralSetID : l_Set.proceduralDescriptorSetIDs)
+        {
+            const std::array<VkWriteDescriptorSet, 1> l_ProceduralWrite{
+                VkWriteDescriptorSet{
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = *l_Device.getDescriptorSet(l_ProceduralSetID),
+                    .dstBinding = 1,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &l_TileDataBufferInfo,
+                }
+            };
+            l_Device.updateDescriptorSets(l_ProceduralWrite);
         }
-    };
 
-    l_Device.updateDescriptorSets(l_DescriptorWrite);
+        l_Set.tileDataVersion = UINT32_MAX;
+        // The global tile layout the stores were checked against is about to change
+        l_Set.storeValid = false;
+    }
 
     recalculateGlobalTilesIndices();
 
     m_NeedsTileRebuild = false;
     m_NeedsCullingUpdate = true;
+    m_NeedsCullTableUpload = true;
+    m_IncrementalCuller.invalidate();
 }
 
 void GrassEngine::recalculateGlobalTilesIndices()
@@ -861,4 +2247,9 @@ void GrassEngine::recalculateGlobalTilesIndices()
         m_GlobalTilePositions.push_back(l_GetGlobalFromLocal(m_TileGridSizes[1], m_TileGridSizes[2], m_TileGridSizes[3], i));
     for (uint32_t i = 0; i < l_TileCounts[3]; ++i)
         m_GlobalTilePositions.push_back(l_GetGlobalFromLocal(m_TileGridSizes[2], m_TileGridSizes[3], m_TileGridSizes[3], i));
+
+    // The rings cover the whole grid, so every global tile has a pre-cull index
+    m_GlobalToPreCullIndex.assign(static_cast<size_t>(m_TileGridSizes[3]) * m_TileGridSizes[3], 0);
+    for (uint32_t i = 0; i < m_GlobalTilePositions.size(); ++i)
+        m_GlobalToPreCullIndex[m_GlobalTilePositions[i]] = i;
 }
@@ -7,7 +7,12 @@
 #include <array>
 #include <glm/gtx/hash.hpp>
 
+#include "frustum_culler.hpp"
+#include "hiz_engine.hpp"
+#include "incremental_culler.hpp"
 #include "noise_engine.hpp"
+#include "parallel_tile_culler.hpp"
+#include "tile_quadtree.hpp"
 #include "utils/identifiable.hpp"
 
 class VulkanCommandBuffer;
@@ -31,6 +36,7 @@ public:
     {
 		alignas(16) glm::uvec4 instanceOffsets;
         alignas(16) glm::uvec4 tileOffsets;
+        alignas(16) glm::uvec4 instanceCounts;
     };
 
     struct TileBufferElem
@@ -39,6 +45,64 @@ public:
         alignas(4) uint32_t tileIndex;
     };
 
+    // Static per tile grid data read by the GPU culling pass, followed by m_GlobalTilePositions
+    struct CullTableHeader
+    {
+        alignas(16) glm::uvec4 tileOffsets;
+        alignas(16) glm::uvec4 tileCounts;
+        alignas(16) glm::uvec4 gridInfo;
+    };
+
+    // Written by the GPU culling pass, consumed by the indirect dispatch and draws
+    struct CullIndirectData
+    {
+        std::array<VkDrawIndexedIndirectCommand, 4> draws;
+        VkDispatchIndirectCommand dispatch;
+        std::array<uint32_t, 4> visibleTiles;
+    };
+
+    struct CullPushConstantData
+    {
+        alignas(16) std::array<glm::vec4, 6> frustumPlanes;
+        alignas(8) glm::vec2 centerPos;
+        alignas(4) float tileSize;
+        alignas(4) float heightmapScale;
+        alignas(4) float cullingMargin;
+    };
+
+    struct CullFinalizePushConstantData
+    {
+        alignas(16) glm::uvec4 tileDensities;
+        alignas(16) glm::uvec4 indexCounts;
+        alignas(16) glm::uvec4 indexOffsets;
+        alignas(4) uint32_t bladeCulling;
+    };
+
+    // Recorded inline before the grass compute when individual blades are culled
+    struct BladeCullParams
+    {
+        alignas(16) std::array<glm::vec4, 6> frustumPlanes;
+        alignas(16) glm::vec3 cameraPos;
+        alignas(4) float maxDistance;
+        alignas(4) float margin;
+    };
+
+    // Recorded inline before the culling pass, lets it test tiles against last frame's Hi-Z pyramid
+    struct OcclusionParams
+    {
+        alignas(16) glm::mat4 vpMatrix;
+        alignas(16) glm::uvec4 levelInfo;
+        alignas(8) glm::vec2 depthSize;
+        alignas(8) glm::vec2 worldOffset;
+        alignas(4) float gridExtent;
+        alignas(4) float grassMaxHeight;
+        alignas(4) float depthBias;
+        // Bound on the terrain's world space slope, pads the sampled tile height range
+        alignas(4) float heightSlope;
+        alignas(8) glm::vec2 heightmapOrigin;
+        alignas(16) std::array<glm::uvec4, HiZEngine::s_MaxLevels> levelRegions;
+    };
+
     struct InstanceElem
     {
         alignas(16) glm::vec3 position;
@@ -47,6 +111,18 @@ public:
         alignas(4) float height;
     };
 
+    // Quantized alternative to InstanceElem. The xz position is rebuilt from the heightmap uv and the grid the set was computed on
+    struct CompactInstanceElem
+    {
+        // Unorm over the grid extent
+        alignas(4) std::array<uint16_t, 2> uv;
+        // Half floats, the height first so the position attribute reads the y in its second component
+        alignas(2) std::array<uint16_t, 2> heightAndY;
+        // Unorm over a full turn
+        alignas(2) uint16_t rotation;
+        alignas(2) uint16_t padding;
+    };
+
     struct ComputePushConstantData
     {
         alignas(8) glm::vec2 centerPos;
@@ -58,6 +134,13 @@ public:
         alignas(4) float heightmapScale;
         alignas(4) float grassBaseHeight;
         alignas(4) float grassHeightVariation;
+        alignas(4) uint32_t bladeCulling;
+        alignas(4) uint32_t compactInstances;
+        // Blades are written to their toroidal store slot, the tile list only holds the tiles to regenerate
+        alignas(4) uint32_t toroidalInstances;
+        // NoiseObject::getSampleOrigin of the heightmap and the grass height noise
+        alignas(8) glm::vec2 heightmapOrigin;
+        alignas(8) glm::vec2 grassHeightOrigin;
     };
 
     struct GrassPushConstantData
@@ -69,6 +152,10 @@ public:
         alignas(8) glm::vec2 windDir = {0.f, 1.f};
         alignas(4) float windStrength = 0.8f;
         alignas(4) float grassRoundness = 0.3f;
+        // Decode of the instance attributes, xyz scale the position and w the rotation. Identity for full instances
+        alignas(16) glm::vec4 instanceScale{ 1.f };
+        // World xz of uv 0 and world size of uv 1, only used by compact instances
+        alignas(16) glm::vec4 instanceOrigin{ 0.f };
         alignas(16) glm::vec3 baseColor = { 0.0112f, 0.082f, 0.0f };
         alignas(16) glm::vec3 tipColor = { 0.25f, 0.6f, 0.0f };
         alignas(4) float colorRamp = 3.f;
@@ -85,6 +172,23 @@ public:
         [[nodiscard]] const void* getFragmentShaderData() const { return &baseColor; }
     };
 
+    // Pushed after GrassPushConstantData to the task and mesh shaders, which also read the vertex range
+    struct MeshPushConstantData
+    {
+        // View depths past which a cluster drops to LOD 1, 2 and 3, clusters past w are culled
+        alignas(16) glm::vec4 lodDistances{ 40.f, 90.f, 160.f, 1000.f };
+        alignas(4) uint32_t lod = 0;
+        alignas(4) uint32_t clusterCount = 0;
+        alignas(4) float cullMargin = 1.f;
+
+        static uint32_t getOffset() { return sizeof(GrassPushConstantData); }
+        static uint32_t getSize() { return sizeof(MeshPushConstantData); }
+    };
+
+    // Side of the square patch of blades one mesh shader workgroup emits, and patches tested by one task shader workgroup
+    static constexpr uint32_t s_MeshClusterSize = 4;
+    static constexpr uint32_t s_MeshClustersPerTask = 32;
+
     explicit GrassEngine(Engine& p_Engine) : m_Engine(p_Engine) {}
 
     void initalize(std::array<uint32_t, 4> p_TileGridSizes, std::array<uint32_t, 4> p_Densities);
@@ -99,15 +203,41 @@ public:
 
     void changeCurrentCenter(glm::ivec2 p_NewCenter, glm::vec2 p_Offset);
     void setDirty() { m_NeedsUpdate = true; }
-
+    void setGpuCulling(bool p_Enabled);
+    [[nodiscard]] bool isGpuCulling() const { return m_GpuCulling; }
+    void setOcclusionCulling(bool p_Enabled);
+    [[nodiscard]] bool isOcclusionCulling() const { return m_GpuCulling && m_OcclusionCulling; }
+    // Switches the instance buffers between InstanceElem and CompactInstanceElem, both sets are replaced
+    void setCompactInstances(bool p_Enabled);
+    [[nodiscard]] bool isCompactInstances() const { return m_CompactInstances; }
+    [[nodiscard]] uint32_t getInstanceStride() const { return m_CompactInstances ? sizeof(CompactInstanceElem) : sizeof(InstanceElem); }
+    // Places the blades in the vertex shader from the tile list and the textures, without instance buffers or the grass compute
+    void setProceduralBlades(bool p_Enabled);
+    [[nodiscard]] bool isProceduralBlades() const { return m_ProceduralBlades; }
+    // Whether the draws sample the grass height noise themselves (procedural vertex shader or grass.mesh), rewriting it
+    // then has to wait for the last render. Mesh shaders imply procedural blades, they are checked on their own so that stays optional
+    [[nodiscard]] bool isHeightNoiseRendered() const { return m_ProceduralBlades || m_MeshShaders || m_BufferSets[m_FrontSet].procedural; }
+    // Draws the procedural blades with task and mesh shaders, turns procedural blades on. Ignored without VK_EXT_mesh_shader
+    void setMeshShaders(bool p_Enabled);
+    [[nodiscard]] bool isMeshShaders() const { return m_MeshShaders; }
+    // Keeps the full square of every ring in a wrap-around store so tile crossings only generate the tiles that changed.
+    // Full instances only, turns compact instances off. Ignored while procedural
+    void setToroidalInstances(bool p_Enabled);
+    [[nodiscard]] bool isToroidalInstances() const { return m_ToroidalInstances; }
+
+    // Writes the back buffer set and makes it the one drawn, deferred while a frame still in flight draws that set
     bool recompute(VulkanCommandBuffer& p_CmdBuffer, float p_TileSize, uint32_t p_GridSize, float p_HeightmapScale);
     bool recomputeWind(VulkanCommandBuffer& p_CmdBuffer);
     bool recomputeHeight(VulkanCommandBuffer& p_CmdBuffer);
+    // Looks up what render needs from the device for the front set, on the main thread before the render tasks fan out
+    void prepareRender();
     void render(const VulkanCommandBuffer& p_CmdBuffer);
 
     void drawImgui();
 
     bool transferCulling(VulkanCommandBuffer& p_CmdBuffer);
+    // Reads the visible tile counts of the last GPU culling pass once the frame that computed them is done, never waits
+    void readBackCulling();
 
     [[nodiscard]] uint32_t getPreCullInstanceCount() const;
     [[nodiscard]] std::array<uint32_t, 4> getPreCullInstanceCounts() const;
@@ -119,11 +249,112 @@ public:
     [[nodiscard]] const std::array<uint32_t, 4>& getPostCullTileCounts() const { return m_PostCullTileCounts; }
 
     [[nodiscard]] bool isDirty() const { return m_NeedsUpdate || m_WindNoise.isNoiseDirty(); }
+    // False until the first wind is computed, the frame computing it has to draw it as well
+    [[nodiscard]] bool isWindAhead() const { return m_WindNoise.isFrontWritten(); }
 
     bool m_RenderEnabled = true;
 
 private:
     void recalculateCulling(float p_HeightmapScale, float p_TileSize);
+    bool uploadCullTable(VulkanCommandBuffer& p_CmdBuffer);
+    // Procedural blades have no instance buffer to compact the visible ones into, toroidal stores keep every blade in its slot
+    [[nodiscard]] bool isBladeCulling() const { return m_GpuCulling && m_BladeCulling && m_CullingEnable && !m_ProceduralBlades && !isToroidalStore(); }
+    [[nodiscard]] bool isToroidalStore() const { return m_ToroidalInstances && !m_ProceduralBlades; }
+    // Blades of the toroidal store, the outer square of every ring including the tiles of the inner rings
+    [[nodiscard]] uint32_t getToroidalStoreInstanceCount() const;
+    // Stages that read the tile buffer and the textures of procedural sets, the task and mesh stages only exist with the extension
+    [[nodiscard]] VkPipelineStageFlags getProceduralReadStages() const;
+    [[nodiscard]] uint32_t getMeshClusterCount(uint32_t p_Lod, uint32_t p_TileCount) const;
+
+    // What a blade in a toroidal store depends on apart from where the grid is centered, the store is regenerated in full when it changes
+    struct StoreInputs
+    {
+        ComputePushConstantData placement{};
+        // Noise offsets relative to the grid center, they follow it on every crossing
+        NoiseEngine::NoisePushConstantData heightmapNoise{};
+        NoiseEngine::NoisePushConstantData grassHeightNoise{};
+
+        [[nodiscard]] bool operator==(const StoreInputs& p_Other) const;
+    };
+
+    // Everything the grass compute writes and the grass draw reads, one set is drawn while the other gets rebuilt
+    struct BufferSet
+    {
+        ResourceID instanceDataBufferID = UINT32_MAX;
+        ResourceID tileDataBufferID = UINT32_MAX;
+        // Host visible copy source of the tile list, the shared staging buffer may still be read by the other set's upload
+        ResourceID tileUploadBufferID = UINT32_MAX;
+        void* tileUploadData = nullptr;
+        ResourceID indirectBufferID = UINT32_MAX;
+        ResourceID cullReadbackBufferID = UINT32_MAX;
+        const CullIndirectData* cullReadbackData = nullptr;
+
+        ResourceID computeDescriptorSetID = UINT32_MAX;
+        ResourceID cullDescriptorSetID = UINT32_MAX;
+
+        // Host visible tile list of the toroidal tiles to regenerate, the grass compute reads it through its own descriptor set
+        ResourceID dirtyTileBufferID = UINT32_MAX;
+        void* dirtyTileData = nullptr;
+        ResourceID toroidalComputeDescriptorSetID = UINT32_MAX;
+        // Center tile and inputs the toroidal store in instanceDataBufferID was last generated with
+        bool storeValid = false;
+        glm::ivec2 storeTile{ 0, 0 };
+        StoreInputs storeInputs{};
+
+        // Host visible, holds what the grass compute would get as push constants for the procedural draw
+        ResourceID placementBufferID = UINT32_MAX;
+        ComputePushConstantData* placementData = nullptr;
+        // One per wind image like m_GrassDescriptorSetIDs, with the set's tile list and placement next to the wind
+        std::array<ResourceID, 2> proceduralDescriptorSetIDs{ UINT32_MAX, UINT32_MAX };
+
+        // What the set was computed with, the draw must not pick up settings changed since
+        std::array<uint32_t, 4> instanceCounts{};
+        // Patches the mesh shader draw of each LOD covers, the GPU culled ones are an upper bound
+        std::array<uint32_t, 4> meshClusterCounts{};
+        bool gpuCulled = false;
+        bool procedural = false;
+        bool toroidal = false;
+        bool compactInstances = false;
+        // instanceOrigin the compact instances were quantized against
+        glm::vec4 instanceOrigin{ 0.f };
+        bool readbackPending = false;
+
+        // m_TileDataVersion of the tile list in tileDataBufferID
+        uint32_t tileDataVersion = UINT32_MAX;
+        uint32_t computeFrame = UINT32_MAX;
+        // Last frame that drew the set, UINT32_MAX if none did since it was last written
+        uint32_t lastDrawFrame = UINT32_MAX;
+    };
+
+    static constexpr uint32_t s_BufferSetCount = 2;
+
+    [[nodiscard]] BufferSet& getFrontSet() { return m_BufferSets[m_FrontSet]; }
+    [[nodiscard]] BufferSet& getBackSet() { return m_BufferSets[(m_FrontSet + 1) % s_BufferSetCount]; }
+    [[nodiscard]] bool isBackSetFree() const;
+    [[nodiscard]] bool isTileUploadNeeded() const;
+    void recordGpuCulling(VulkanCommandBuffer& p_CmdBuffer, const BufferSet& p_Set, float p_TileSize, uint32_t p_GridSize, float p_HeightmapScale);
+    void recordCullReadback(VulkanCommandBuffer& p_CmdBuffer, const BufferSet& p_Set) const;
+    [[nodiscard]] StoreInputs getStoreInputs(const ComputePushConstantData& p_Placement) const;
+    // Writes the tiles of the set's toroidal store that do not hold the blades of the current grid, returns their blade count
+    uint32_t writeDirtyTiles(BufferSet& p_Set, glm::ivec2 p_CenterTile, bool p_Full);
+    // Replaces the instanced draws of a procedural set, one task shader draw per LOD
+    void drawMeshShaders(const VulkanCommandBuffer& p_CmdBuffer, const BufferSet& p_Set);
+
+    // Device handles of the front set's draw, render runs on a worker thread and never looks them up itself
+    struct RenderHandles
+    {
+        VkExtent2D extent{};
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        // Instances and blade vertices, or only the blade vertices when the blades come from the tile list
+        std::array<VkBuffer, 2> vertexBuffers{ VK_NULL_HANDLE, VK_NULL_HANDLE };
+        uint32_t vertexBufferCount = 0;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        // Only set for GPU culled sets
+        VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    };
+    RenderHandles m_RenderHandles{};
 
     Engine& m_Engine;
 
@@ -141,16 +372,35 @@ private:
     bool m_NeedsInstanceRebuild = true;
     bool m_NeedsTileRebuild = true;
     bool m_NeedsTransfer = true;
+    bool m_NeedsCullTableUpload = true;
+
+    bool m_GpuCulling = false;
+    bool m_OcclusionCulling = false;
+    bool m_CompactInstances = false;
+    bool m_ProceduralBlades = false;
+    bool m_MeshShaders = false;
+    bool m_ToroidalInstances = false;
 
     std::vector<uint32_t> m_GlobalTilePositions{};
     std::vector<TileBufferElem> m_TileVisibilityData{};
+    // Bumped every time m_TileVisibilityData changes, each buffer set tracks the version it was uploaded with
+    uint32_t m_TileDataVersion = 0;
+    ParallelTileCuller m_ParallelCuller{};
+    // Pre-cull index of every global tile, lets the quadtree output be put back in LOD order
+    std::vector<uint32_t> m_GlobalToPreCullIndex{};
+    std::vector<uint32_t> m_VisibleTiles{};
+    TileQuadtree m_TileQuadtree{};
+    IncrementalCuller m_IncrementalCuller{};
     std::array<uint32_t, 4> m_PostCullTileCounts{};
+    // Instance counts of the last GPU culling pass, per blade when blade culling is enabled
+    std::array<uint32_t, 4> m_GpuInstanceCounts{};
 
     std::array<glm::vec3, 4> m_LODColors{};
 
     float m_CullingMargin = 0.f;
 
     GrassPushConstantData m_PushConstants{};
+    MeshPushConstantData m_MeshPushConstants{};
 
 private:
     void rebuildInstanceResources();
@@ -160,18 +410,42 @@ private:
     NoiseEngine::NoiseObject m_HeightNoise{};
     NoiseEngine::NoiseObject m_WindNoise{};
 
-    ResourceID m_InstanceDataBufferID = UINT32_MAX;
-    ResourceID m_TileDataBufferID = UINT32_MAX;
+    std::array<BufferSet, s_BufferSetCount> m_BufferSets{};
+    uint32_t m_FrontSet = 0;
+
+    // Shared by both sets, only read and written by the compute queue apart from cull table uploads
+    ResourceID m_CullTableBufferID = UINT32_MAX;
+    ResourceID m_BladeCullBufferID = UINT32_MAX;
+    ResourceID m_OcclusionBufferID = UINT32_MAX;
 
     ResourceID m_ComputePipelineLayoutID = UINT32_MAX;
     ResourceID m_ComputePipelineID = UINT32_MAX;
     ResourceID m_ComputeDescriptorSetLayoutID = UINT32_MAX;
-    ResourceID m_ComputeDescriptorSetID = UINT32_MAX;
+
+    ResourceID m_CullPipelineLayoutID = UINT32_MAX;
+    ResourceID m_CullPipelineID = UINT32_MAX;
+    ResourceID m_CullFinalizePipelineLayoutID = UINT32_MAX;
+    ResourceID m_CullFinalizePipelineID = UINT32_MAX;
+    ResourceID m_CullDescriptorSetLayoutID = UINT32_MAX;
 
     ResourceID m_GrassPipelineLayoutID = UINT32_MAX;
     ResourceID m_GrassPipelineID = UINT32_MAX;
+    // Same shaders and layout, only the vertex input differs
+    ResourceID m_CompactGrassPipelineID = UINT32_MAX;
     ResourceID m_GrassDescriptorSetLayoutID = UINT32_MAX;
-    ResourceID m_GrassDescriptorSetID = UINT32_MAX;
+    // One per wind image, indexed by the wind's front index
+    std::array<ResourceID, 2> m_GrassDescriptorSetIDs{ UINT32_MAX, UINT32_MAX };
+
+    ResourceID m_ProceduralPipelineLayoutID = UINT32_MAX;
+    ResourceID m_ProceduralGrassPipelineID = UINT32_MAX;
+    ResourceID m_ProceduralDescriptorSetLayoutID = UINT32_MAX;
+
+    // Procedural layout and descriptor sets, the blades are read from the toroidal store instead of placed
+    ResourceID m_ToroidalGrassPipelineID = UINT32_MAX;
+
+    // Shares the procedural descriptor sets, only created when the device has mesh shaders
+    ResourceID m_MeshPipelineLayoutID = UINT32_MAX;
+    ResourceID m_MeshGrassPipelineID = UINT32_MAX;
 
     VertexBufferData m_VertexBufferData{};
 
@@ -188,16 +462,29 @@ private:
     float m_ImguiWindWSpeed = 15.f;
 
     float m_ImguiCullingMargin = 3.f;
+    float m_ImguiCullingGuardBand = 2.f;
+    float m_ImguiBladeCullDistance = 1000.f;
+    float m_ImguiBladeCullMargin = 1.f;
+    float m_ImguiOcclusionDepthBias = 0.0001f;
 
     bool m_RandomizeLODColors = false;
     bool m_CullingEnable = true;
     bool m_CullingUpdate = true;
     bool m_NeedsCullingUpdate = true;
+    bool m_BladeCulling = true;
+    bool m_HierarchicalCulling = true;
+    bool m_IncrementalCulling = true;
 
     //Debug
     uint32_t m_DebugInstanceBufferSize = 0;
     uint32_t m_DebugTileBufferSize = 0;
     uint32_t m_DebugComputeThreads = 0;
+    uint32_t m_DebugRegeneratedTiles = 0;
+    uint32_t m_DebugQuadtreeNodes = 0;
+    uint32_t m_DebugCullChunks = 0;
+    uint32_t m_DebugRetestedTiles = 0;
+    uint32_t m_DebugSkippedCullUploads = 0;
+    uint32_t m_DebugDeferredUpdates = 0;
     std::array<uint32_t, 4> m_DebugInstanceCalls;
     std::array<uint32_t, 4> m_DebugInstanceOffsets;
     TileBufferHeader m_DebugTileHeader{};
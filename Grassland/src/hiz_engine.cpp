@@ -0,0 +1,167 @@
+#include "hiz_engine.hpp"
+
+#include <algorithm>
+
+#include "engine.hpp"
+#include "vulkan_device.hpp"
+
+void HiZEngine::initialize()
+{
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    const VkExtent2D l_Extent = m_Engine.getRenderExtent();
+
+    // Odd sizes round up, the reduction folds the extra row/column into the last texel so nothing is lost
+    m_DepthSize = { l_Extent.width, l_Extent.height };
+    glm::uvec2 l_LevelSize = (m_DepthSize + 1u) / 2u;
+    uint32_t l_StackHeight = 0;
+    m_LevelCount = 0;
+    while (m_LevelCount < s_MaxLevels)
+    {
+        const glm::uvec2 l_Offset = m_LevelCount == 0 ? glm::uvec2{ 0, 0 } : glm::uvec2{ m_LevelRegions[0].z, l_StackHeight };
+        m_LevelRegions[m_LevelCount] = { l_Offset, l_LevelSize };
+        if (m_LevelCount > 0)
+            l_StackHeight += l_LevelSize.y;
+        m_LevelCount++;
+
+        if (l_LevelSize.x == 1 && l_LevelSize.y == 1)
+            break;
+        l_LevelSize = (l_LevelSize + 1u) / 2u;
+    }
+
+    const uint32_t l_StackWidth = m_LevelCount > 1 ? m_LevelRegions[1].z : 0;
+    m_AtlasSize = { m_LevelRegions[0].z + l_StackWidth, std::max(m_LevelRegions[0].w, l_StackHeight) };
+
+    m_AtlasImageID = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_R32_SFLOAT, { m_AtlasSize.x, m_AtlasSize.y, 1 }, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0);
+    VulkanImage& l_AtlasImage = l_Device.getImage(m_AtlasImageID);
+    l_AtlasImage.allocateFromFlags({ .desiredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .undesiredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, .allowUndesired = false });
+    l_AtlasImage.setQueue(m_Engine.getGraphicsQueuePos().familyIndex);
+    m_AtlasViewID = l_AtlasImage.createImageView(VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
+    m_AtlasSamplerID = l_AtlasImage.createSampler(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+    VulkanImage& l_DepthImage = l_Device.getImage(m_Engine.getDepthBuffer());
+    m_DepthSamplerID = l_DepthImage.createSampler(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+    {
+        std::array<VkDescriptorSetLayoutBinding, 2> l_Bindings;
+        l_Bindings[0].binding = 0;
+        l_Bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        l_Bindings[0].descriptorCount = 1;
+        l_Bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        l_Bindings[0].pImmutableSamplers = nullptr;
+        l_Bindings[1].binding = 1;
+        l_Bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        l_Bindings[1].descriptorCount = 1;
+        l_Bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        l_Bindings[1].pImmutableSamplers = nullptr;
+
+        m_BuildDescriptorSetLayoutID = l_Device.createDescriptorSetLayout(l_Bindings, 0);
+    }
+
+    m_BuildDescriptorSetID = l_Device.createDescriptorSet(m_Engine.getDescriptorPoolID(), m_BuildDescriptorSetLayoutID);
+
+    {
+        std::array<VkPushConstantRange, 1> l_PushConstantRanges;
+        l_PushConstantRanges[0] = { .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(BuildPushConstantData) };
+        std::array<ResourceID, 1> l_DescriptorSetLayouts = { m_BuildDescriptorSetLayoutID };
+        m_BuildPipelineLayoutID = l_Device.createPipelineLayout(l_DescriptorSetLayouts, l_PushConstantRanges);
+
+        const ResourceID l_ShaderID = l_Device.createShader("shaders/hiz_build.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, {});
+        m_BuildPipelineID = l_Device.createComputePipeline(m_BuildPipelineLayoutID, l_ShaderID, "main");
+        l_Device.freeShader(l_ShaderID);
+    }
+
+    const VkDescriptorImageInfo l_DepthInfo{
+        .sampler = *l_DepthImage.getSampler(m_DepthSamplerID),
+        .imageView = *l_DepthImage.getImageView(m_Engine.getDepthBufferView()),
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    const VkDescriptorImageInfo l_AtlasInfo{
+        .sampler = VK_NULL_HANDLE,
+        .imageView = *l_AtlasImage.getImageView(m_AtlasViewID),
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+
+    const std::array<VkWriteDescriptorSet, 2> l_DescriptorWrite{
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = *l_Device.getDescriptorSet(m_BuildDescriptorSetID),
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &l_DepthInfo,
+        },
+        VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = *l_Device.getDescriptorSet(m_BuildDescriptorSetID),
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .pImageInfo = &l_AtlasInfo,
+        }
+    };
+
+    l_Device.updateDescriptorSets(l_DescriptorWrite);
+}
+
+void HiZEngine::setEnabled(const bool p_Enabled)
+{
+    m_Enabled = p_Enabled;
+    if (!m_Enabled)
+        m_Valid = false;
+}
+
+void HiZEngine::recordBuild(VulkanCommandBuffer& p_CmdBuffer)
+{
+    if (!m_Enabled)
+        return;
+
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    VulkanImage& l_AtlasImage = l_Device.getImage(m_AtlasImageID);
+    const uint32_t l_GraphicsFamily = m_Engine.getGraphicsQueuePos().familyIndex;
+    const uint32_t l_ComputeFamily = m_Engine.getComputeQueuePos().familyIndex;
+
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, "Hi-Z build", l_GraphicsFamily);
+
+    // The previous pyramid was handed to the compute queue for culling
+    VulkanMemoryBarrierBuilder l_EnterBarrier{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+    l_EnterBarrier.addImageMemoryBarrier(m_AtlasImageID, VK_IMAGE_LAYOUT_GENERAL, l_GraphicsFamily, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    p_CmdBuffer.cmdPipelineBarrier(l_EnterBarrier);
+    l_AtlasImage.setLayout(VK_IMAGE_LAYOUT_GENERAL);
+    l_AtlasImage.setQueue(l_GraphicsFamily);
+
+    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_BuildPipelineID);
+    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_BuildPipelineLayoutID, m_BuildDescriptorSetID);
+
+    for (uint32_t i = 0; i < m_LevelCount; i++)
+    {
+        const BuildPushConstantData l_PushConstants{
+            .srcRegion = i == 0 ? glm::uvec4{ 0, 0, m_DepthSize } : m_LevelRegions[i - 1],
+            .dstRegion = m_LevelRegions[i],
+            .fromDepth = i == 0
+        };
+        p_CmdBuffer.cmdPushConstant(m_BuildPipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BuildPushConstantData), &l_PushConstants);
+        p_CmdBuffer.cmdDispatch((m_LevelRegions[i].z + 7) / 8, (m_LevelRegions[i].w + 7) / 8, 1);
+
+        if (i + 1 < m_LevelCount)
+        {
+            VulkanMemoryBarrierBuilder l_LevelBarrier{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+            l_LevelBarrier.addImageMemoryBarrier(m_AtlasImageID, VK_IMAGE_LAYOUT_GENERAL, l_GraphicsFamily, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+            p_CmdBuffer.cmdPipelineBarrier(l_LevelBarrier);
+        }
+    }
+
+    VulkanMemoryBarrierBuilder l_ExitBarrier{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+    l_ExitBarrier.addImageMemoryBarrier(m_AtlasImageID, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamily, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+    p_CmdBuffer.cmdPipelineBarrier(l_ExitBarrier);
+    l_AtlasImage.setQueue(l_ComputeFamily);
+
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+
+    m_BuildVPMatrix = m_Engine.getCamera().getVPMatrix();
+    m_Valid = true;
+}
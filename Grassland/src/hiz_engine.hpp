@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "utils/identifiable.hpp"
+
+class VulkanCommandBuffer;
+class Engine;
+
+// Max-depth pyramid of the depth buffer, rebuilt at the end of every frame so the next frame's GPU culling can
+// test tiles for occlusion. Every level is packed into a single R32F atlas: level 0 (half the depth resolution)
+// sits at the origin and the smaller levels are stacked in a column to its right
+class HiZEngine
+{
+public:
+    static constexpr uint32_t s_MaxLevels = 16;
+
+    struct BuildPushConstantData
+    {
+        alignas(16) glm::uvec4 srcRegion;
+        alignas(16) glm::uvec4 dstRegion;
+        alignas(4) uint32_t fromDepth;
+    };
+
+    explicit HiZEngine(Engine& p_Engine) : m_Engine(p_Engine) {}
+
+    void initialize();
+
+    // Must be recorded on the graphics queue after the render pass that wrote the depth buffer
+    void recordBuild(VulkanCommandBuffer& p_CmdBuffer);
+
+    void setEnabled(bool p_Enabled);
+    [[nodiscard]] bool isEnabled() const { return m_Enabled; }
+    // False until the first pyramid is built, and again after it is disabled, as the contents can't be trusted
+    [[nodiscard]] bool isValid() const { return m_Enabled && m_Valid; }
+
+    [[nodiscard]] ResourceID getAtlasImage() const { return m_AtlasImageID; }
+    [[nodiscard]] ResourceID getAtlasView() const { return m_AtlasViewID; }
+    [[nodiscard]] ResourceID getAtlasSampler() const { return m_AtlasSamplerID; }
+
+    // View projection matrix the depth of the current pyramid was rendered with
+    [[nodiscard]] const glm::mat4& getBuildVPMatrix() const { return m_BuildVPMatrix; }
+    [[nodiscard]] glm::uvec2 getDepthSize() const { return m_DepthSize; }
+    [[nodiscard]] uint32_t getLevelCount() const { return m_LevelCount; }
+    // Offset in xy and size in zw of each level inside the atlas
+    [[nodiscard]] const std::array<glm::uvec4, s_MaxLevels>& getLevelRegions() const { return m_LevelRegions; }
+    [[nodiscard]] glm::uvec2 getAtlasSize() const { return m_AtlasSize; }
+
+private:
+    Engine& m_Engine;
+
+    ResourceID m_AtlasImageID = UINT32_MAX;
+    ResourceID m_AtlasViewID = UINT32_MAX;
+    ResourceID m_AtlasSamplerID = UINT32_MAX;
+    ResourceID m_DepthSamplerID = UINT32_MAX;
+
+    ResourceID m_BuildPipelineLayoutID = UINT32_MAX;
+    ResourceID m_BuildPipelineID = UINT32_MAX;
+    ResourceID m_BuildDescriptorSetLayoutID = UINT32_MAX;
+    ResourceID m_BuildDescriptorSetID = UINT32_MAX;
+
+    std::array<glm::uvec4, s_MaxLevels> m_LevelRegions{};
+    uint32_t m_LevelCount = 0;
+    glm::uvec2 m_DepthSize{};
+    glm::uvec2 m_AtlasSize{};
+
+    glm::mat4 m_BuildVPMatrix{ 1.f };
+
+    bool m_Enabled = false;
+    bool m_Valid = false;
+};
@@ -0,0 +1,134 @@
+#include "incremental_culler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "frustum_culler.hpp"
+
+bool IncrementalCuller::update(const glm::vec4* p_Planes, const TileQuadtree::GridLayout& p_Layout, const float p_GuardBand)
+{
+    TileQuadtree::GridLayout l_GuardLayout = p_Layout;
+    l_GuardLayout.margin += p_GuardBand;
+    if (!m_Valid || !(p_Layout == m_Layout) || !(l_GuardLayout == m_GuardLayout))
+    {
+        // Global tile indices moved or the boxes changed, the previous visibility means nothing anymore
+        rebase(p_Planes, p_Layout, p_GuardBand, false);
+        return true;
+    }
+
+    const float l_Displacement = getMaxPlaneDisplacement(p_Planes);
+    const auto l_StableBegin = std::partition_point(m_SortedTiles.begin(), m_SortedTiles.end(), [&](const uint32_t p_Tile) { return m_Slack[p_Tile] <= l_Displacement; });
+    const size_t l_RetestCount = static_cast<size_t>(l_StableBegin - m_SortedTiles.begin()) + m_ChangedTiles.size();
+
+    // Past this point the frustum drifted too far from the reference, testing everything again is about as cheap
+    if (l_RetestCount > m_SortedTiles.size() / 4)
+        return rebase(p_Planes, p_Layout, p_GuardBand, true);
+
+    if (++m_Stamp == 0)
+    {
+        std::fill(m_RetestStamp.begin(), m_RetestStamp.end(), 0);
+        m_Stamp = 1;
+    }
+
+    bool l_Changed = false;
+    m_RetestedTiles = 0;
+    std::vector<uint32_t> l_ChangedTiles{};
+    auto l_Retest = [&](const uint32_t p_Tile)
+    {
+        if (m_RetestStamp[p_Tile] == m_Stamp)
+            return;
+        m_RetestStamp[p_Tile] = m_Stamp;
+        m_RetestedTiles++;
+
+        l_Changed |= retest(p_Tile, p_Planes);
+        if (m_Visible[p_Tile] != m_ReferenceVisible[p_Tile])
+            l_ChangedTiles.push_back(p_Tile);
+    };
+
+    for (const uint32_t l_Tile : m_ChangedTiles)
+        l_Retest(l_Tile);
+    for (auto l_It = m_SortedTiles.begin(); l_It != l_StableBegin; ++l_It)
+        l_Retest(*l_It);
+
+    m_ChangedTiles = std::move(l_ChangedTiles);
+    return l_Changed;
+}
+
+bool IncrementalCuller::rebase(const glm::vec4* p_Planes, const TileQuadtree::GridLayout& p_Layout, const float p_GuardBand, const bool p_KeepState)
+{
+    const uint32_t l_TileCount = p_Layout.gridSize * p_Layout.gridSize;
+
+    m_Layout = p_Layout;
+    m_GuardLayout = p_Layout;
+    m_GuardLayout.margin += p_GuardBand;
+    std::copy_n(p_Planes, m_ReferencePlanes.size(), m_ReferencePlanes.begin());
+
+    if (!p_KeepState || m_Visible.size() != l_TileCount)
+        m_Visible.assign(l_TileCount, 0);
+    m_Slack.resize(l_TileCount);
+    m_RetestStamp.assign(l_TileCount, 0);
+    m_Stamp = 0;
+
+    bool l_Changed = false;
+    for (uint32_t l_Tile = 0; l_Tile < l_TileCount; l_Tile++)
+    {
+        const uint32_t l_X = l_Tile % p_Layout.gridSize;
+        const uint32_t l_Y = l_Tile / p_Layout.gridSize;
+        const float l_Slack = FrustumCuller::getBoxSlack(p_Planes, m_Layout.getTileMin(l_X, l_Y), m_Layout.getTileMax(l_X, l_Y));
+        const float l_GuardSlack = FrustumCuller::getBoxSlack(p_Planes, m_GuardLayout.getTileMin(l_X, l_Y), m_GuardLayout.getTileMax(l_X, l_Y));
+
+        // Hidden tiles show up once their box touches the frustum, visible ones only hide once the guard box leaves it
+        const uint8_t l_Visible = m_Visible[l_Tile] ? l_GuardSlack >= 0.0f : l_Slack >= 0.0f;
+        l_Changed |= l_Visible != m_Visible[l_Tile];
+        m_Visible[l_Tile] = l_Visible;
+        m_Slack[l_Tile] = l_Visible ? l_GuardSlack : -l_Slack;
+    }
+    m_ReferenceVisible = m_Visible;
+
+    m_SortedTiles.resize(l_TileCount);
+    std::iota(m_SortedTiles.begin(), m_SortedTiles.end(), 0);
+    std::sort(m_SortedTiles.begin(), m_SortedTiles.end(), [&](const uint32_t p_A, const uint32_t p_B) { return m_Slack[p_A] < m_Slack[p_B] || (m_Slack[p_A] == m_Slack[p_B] && p_A < p_B); });
+    m_ChangedTiles.clear();
+
+    m_RetestedTiles = l_TileCount;
+    m_RebaseCount++;
+    m_Valid = true;
+    return l_Changed;
+}
+
+bool IncrementalCuller::retest(const uint32_t p_Tile, const glm::vec4* p_Planes)
+{
+    const uint32_t l_X = p_Tile % m_Layout.gridSize;
+    const uint32_t l_Y = p_Tile / m_Layout.gridSize;
+    const bool l_WasVisible = m_Visible[p_Tile] != 0;
+    const TileQuadtree::GridLayout& l_Layout = l_WasVisible ? m_GuardLayout : m_Layout;
+
+    const bool l_Visible = FrustumCuller::getBoxSlack(p_Planes, l_Layout.getTileMin(l_X, l_Y), l_Layout.getTileMax(l_X, l_Y)) >= 0.0f;
+    m_Visible[p_Tile] = l_Visible;
+    return l_Visible != l_WasVisible;
+}
+
+float IncrementalCuller::getMaxPlaneDisplacement(const glm::vec4* p_Planes) const
+{
+    // Plane distances are linear in the point, so over the box around the grid their change peaks at a corner
+    const glm::vec3 l_Min = m_GuardLayout.getTileMin(0, 0);
+    const glm::vec3 l_Max = m_GuardLayout.getTileMax(m_GuardLayout.gridSize - 1, m_GuardLayout.gridSize - 1);
+
+    double l_Displacement = 0.0;
+    double l_Scale = 0.0;
+    for (uint32_t l_PlaneIdx = 0; l_PlaneIdx < m_ReferencePlanes.size(); l_PlaneIdx++)
+    {
+        const glm::dvec4 l_Current{ p_Planes[l_PlaneIdx] };
+        const glm::dvec4 l_Delta = l_Current - glm::dvec4(m_ReferencePlanes[l_PlaneIdx]);
+        for (uint32_t l_Corner = 0; l_Corner < 8; l_Corner++)
+        {
+            const glm::dvec3 l_Point{ l_Corner & 1 ? l_Max.x : l_Min.x, l_Corner & 2 ? l_Max.y : l_Min.y, l_Corner & 4 ? l_Max.z : l_Min.z };
+            l_Displacement = std::max(l_Displacement, std::abs(glm::dot(glm::dvec3(l_Delta), l_Point) + l_Delta.w));
+            l_Scale = std::max(l_Scale, std::abs(l_Point.x) + std::abs(l_Point.y) + std::abs(l_Point.z) + std::max(std::abs(l_Current.w), std::abs(static_cast<double>(m_ReferencePlanes[l_PlaneIdx].w))));
+        }
+    }
+
+    // The slack and the new distances are both rounded to float, leave room for that
+    return static_cast<float>(l_Displacement + l_Scale * 1e-5);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "tile_quadtree.hpp"
+
+// Keeps the tile visibility of the previous update and only re-tests the tiles close to the frustum boundary.
+// Every tile remembers how far its box was from crossing a plane of a reference frustum, and no point of the grid
+// can move further than the largest plane displacement since then, so tiles with more slack than that keep their state.
+// Tiles also need to leave the frustum by the guard band before being hidden, so they don't flicker at the edge
+class IncrementalCuller
+{
+public:
+    // Returns true when the visibility of any tile changed since the previous update
+    bool update(const glm::vec4* p_Planes, const TileQuadtree::GridLayout& p_Layout, float p_GuardBand);
+    // Drops the previous state, the next update tests every tile and reports a change
+    void invalidate() { m_Valid = false; }
+
+    // Indexed by global tile, as laid out by the grid
+    [[nodiscard]] bool isVisible(const uint32_t p_Tile) const { return m_Visible[p_Tile] != 0; }
+
+    [[nodiscard]] uint32_t getRetestedTileCount() const { return m_RetestedTiles; }
+    [[nodiscard]] uint32_t getRebaseCount() const { return m_RebaseCount; }
+
+private:
+    bool rebase(const glm::vec4* p_Planes, const TileQuadtree::GridLayout& p_Layout, float p_GuardBand, bool p_KeepState);
+    bool retest(uint32_t p_Tile, const glm::vec4* p_Planes);
+    [[nodiscard]] float getMaxPlaneDisplacement(const glm::vec4* p_Planes) const;
+
+    bool m_Valid = false;
+    TileQuadtree::GridLayout m_Layout{};
+    TileQuadtree::GridLayout m_GuardLayout{};
+    std::array<glm::vec4, 6> m_ReferencePlanes{};
+
+    std::vector<uint8_t> m_Visible{};
+    std::vector<uint8_t> m_ReferenceVisible{};
+    // Distance the tile had to travel to change its reference state, tiles sorted by it
+    std::vector<float> m_Slack{};
+    std::vector<uint32_t> m_SortedTiles{};
+    // Tiles that left their reference state, they're re-tested on every update
+    std::vector<uint32_t> m_ChangedTiles{};
+    std::vector<uint32_t> m_RetestStamp{};
+    uint32_t m_Stamp = 0;
+
+    uint32_t m_RetestedTiles = 0;
+    uint32_t m_RebaseCount = 0;
+};
@@ -1,7 +1,178 @@
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
 #include "engine.hpp"
+#include "frustum_culler.hpp"
+#include "parallel_tile_culler.hpp"
+#include "worker_pool.hpp"
+
+// Whole non-negative integer that fits in 32 bits, p_Count is left untouched otherwise. std::stoul alone throws on
+// garbage, wraps negative numbers around and stops at the first non-digit
+static bool parseCount(const std::string& p_Value, uint32_t& p_Count)
+{
+    if (p_Value.empty() || !std::isdigit(static_cast<unsigned char>(p_Value[0])))
+        return false;
+
+    size_t l_Parsed = 0;
+    unsigned long long l_Count = 0;
+    try
+    {
+        l_Count = std::stoull(p_Value, &l_Parsed);
+    }
+    catch (const std::invalid_argument&) { return false; }
+    catch (const std::out_of_range&) { return false; }
+
+    if (l_Parsed != p_Value.size() || l_Count > UINT32_MAX)
+        return false;
+
+    p_Count = static_cast<uint32_t>(l_Count);
+    return true;
+}
+
+static EngineSettings parseArguments(const int argc, char* argv[])
+{
+    EngineSettings l_Settings{};
+    for (int i = 1; i < argc; i++)
+    {
+        const bool l_HasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--headless") == 0)
+            l_Settings.headless = true;
+        else if (std::strcmp(argv[i], "--width") == 0 && l_HasValue)
+        {
+            uint32_t l_Width = 0;
+            if (parseCount(argv[++i], l_Width) && l_Width > 0)
+                l_Settings.headlessExtent.width = l_Width;
+            else
+                std::cerr << "Invalid width " << argv[i] << ", expected a positive number of pixels\n";
+        }
+        else if (std::strcmp(argv[i], "--height") == 0 && l_HasValue)
+        {
+            uint32_t l_Height = 0;
+            if (parseCount(argv[++i], l_Height) && l_Height > 0)
+                l_Settings.headlessExtent.height = l_Height;
+            else
+                std::cerr << "Invalid height " << argv[i] << ", expected a positive number of pixels\n";
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && l_HasValue)
+        {
+            uint32_t l_Frames = 0;
+            if (parseCount(argv[++i], l_Frames) && l_Frames > 0)
+                l_Settings.headlessFrameCount = l_Frames;
+            else
+                std::cerr << "Invalid frame count " << argv[i] << ", expected a positive number of frames\n";
+        }
+        else if (std::strcmp(argv[i], "--camera-path") == 0 && l_HasValue)
+            l_Settings.cameraPathFile = argv[++i];
+        else if (std::strcmp(argv[i], "--benchmark-output") == 0 && l_HasValue)
+            l_Settings.benchmarkOutputFile = argv[++i];
+        else if (std::strcmp(argv[i], "--fixed-delta") == 0 && l_HasValue)
+        {
+            // Anything but a positive delta would never move the camera along its path
+            const std::string l_Value = argv[++i];
+            float l_Delta = 0.f;
+            try
+            {
+                l_Delta = std::stof(l_Value);
+            }
+            catch (const std::invalid_argument&) {}
+            catch (const std::out_of_range&) {}
+
+            if (l_Delta > 0.f && std::isfinite(l_Delta))
+                l_Settings.fixedDelta = l_Delta;
+            else
+                std::cerr << "Invalid fixed delta " << l_Value << ", expected a positive number of seconds\n";
+        }
+        else if (std::strcmp(argv[i], "--record-path") == 0 && l_HasValue)
+            l_Settings.recordPathFile = argv[++i];
+        else if (std::strcmp(argv[i], "--cpu-trace") == 0 && l_HasValue)
+            l_Settings.cpuTraceFile = argv[++i];
+        else if (std::strcmp(argv[i], "--gpu-culling") == 0)
+            l_Settings.gpuCulling = true;
+        else if (std::strcmp(argv[i], "--occlusion-culling") == 0)
+            l_Settings.occlusionCulling = true;
+        else if (std::strcmp(argv[i], "--compact-instances") == 0)
+            l_Settings.compactInstances = true;
+        else if (std::strcmp(argv[i], "--toroidal-instances") == 0)
+            l_Settings.toroidalInstances = true;
+        else if (std::strcmp(argv[i], "--toroidal-noise") == 0)
+            l_Settings.toroidalNoise = true;
+        else if (std::strcmp(argv[i], "--noise-cache") == 0)
+            l_Settings.noiseChunkCache = true;
+        else if (std::strcmp(argv[i], "--terrain-format") == 0 && l_HasValue)
+        {
+            const std::string l_Format = argv[++i];
+            if (l_Format == "full")
+                l_Settings.terrainFormat = NoiseEngine::TerrainFormat::FULL;
+            else if (l_Format == "half")
+                l_Settings.terrainFormat = NoiseEngine::TerrainFormat::HALF;
+            else if (l_Format == "compact")
+                l_Settings.terrainFormat = NoiseEngine::TerrainFormat::COMPACT;
+            else
+                std::cerr << "Unknown terrain format " << l_Format << ", expected full, half or compact\n";
+        }
+        else if (std::strcmp(argv[i], "--procedural-blades") == 0)
+            l_Settings.proceduralBlades = true;
+        else if (std::strcmp(argv[i], "--mesh-shaders") == 0)
+            l_Settings.meshShaders = true;
+        else if (std::strcmp(argv[i], "--worker-threads") == 0 && l_HasValue)
+        {
+            // 0 keeps every hardware thread, more threads than that would only time-slice the same cores
+            uint32_t l_Threads = 0;
+            if (!parseCount(argv[++i], l_Threads))
+                std::cerr << "Invalid worker thread count " << argv[i] << ", expected 0 or a positive integer\n";
+            else if (l_Threads > WorkerPool::getMaxThreadCount())
+            {
+                std::cerr << "Worker thread count " << l_Threads << " exceeds the " << WorkerPool::getMaxThreadCount() << " hardware threads, using all of them\n";
+                l_Settings.workerThreads = 0;
+            }
+            else
+                l_Settings.workerThreads = l_Threads;
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && l_HasValue)
+        {
+            uint32_t l_Frames = 0;
+            if (parseCount(argv[++i], l_Frames) && l_Frames >= 1 && l_Frames <= Engine::s_MaxFramesInFlight)
+                l_Settings.framesInFlight = l_Frames;
+            else
+                std::cerr << "Invalid frames in flight " << argv[i] << ", expected a number between 1 and " << Engine::s_MaxFramesInFlight << '\n';
+        }
+        else if (std::strcmp(argv[i], "--batch-compute") == 0)
+            l_Settings.batchCompute = true;
+        else if (std::strcmp(argv[i], "--compute-benchmark") == 0)
+            l_Settings.computeBenchmarkFrames = l_HasValue && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) ? static_cast<uint32_t>(std::stoul(argv[++i])) : 256;
+        else
+            std::cerr << "Ignoring unknown argument: " << argv[i] << '\n';
+    }
+    return l_Settings;
+}
 
 int main(int argc, char* argv[])
 {
-    Engine l_Engine{};
+    // Standalone CPU benchmark, runs without creating a device
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--cull-benchmark") == 0)
+        {
+            // The iteration count is optional, anything after it that isn't another option has to be one
+            uint32_t l_Iterations = 1000;
+            if (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0)
+            {
+                uint32_t l_Count = 0;
+                if (parseCount(argv[i + 1], l_Count) && l_Count > 0)
+                    l_Iterations = l_Count;
+                else
+                    std::cerr << "Invalid cull benchmark iteration count " << argv[i + 1] << ", expected a positive integer\n";
+            }
+            const bool l_PathsMatch = FrustumCuller::runBenchmark(l_Iterations);
+            const bool l_ThreadsMatch = ParallelTileCuller::runBenchmark(l_Iterations);
+            return l_PathsMatch && l_ThreadsMatch ? 0 : 1;
+        }
+    }
+
+    Engine l_Engine{ parseArguments(argc, argv) };
     l_Engine.run();
 }
@@ -0,0 +1,61 @@
+#include "mesh_shader_extension.hpp"
+
+#include <cstring>
+#include <vector>
+
+MeshShaderExtension::MeshShaderExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID)
+{
+    m_Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    m_Features.taskShader = VK_TRUE;
+    m_Features.meshShader = VK_TRUE;
+}
+
+VkBaseInStructure* MeshShaderExtension::getExtensionStruct() const
+{
+    // The device creation links the returned structures together, so pNext is left to it
+    m_Features.pNext = nullptr;
+    return reinterpret_cast<VkBaseInStructure*>(&m_Features);
+}
+
+VkStructureType MeshShaderExtension::getExtensionStructType() const
+{
+    return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+}
+
+VulkanDeviceExtension* MeshShaderExtension::copy()
+{
+    return new MeshShaderExtension(m_DeviceID);
+}
+
+bool MeshShaderExtension::isSupported(const VkPhysicalDevice p_GPU)
+{
+    uint32_t l_ExtensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(p_GPU, nullptr, &l_ExtensionCount, nullptr);
+    std::vector<VkExtensionProperties> l_Extensions(l_ExtensionCount);
+    vkEnumerateDeviceExtensionProperties(p_GPU, nullptr, &l_ExtensionCount, l_Extensions.data());
+
+    bool l_Found = false;
+    for (const VkExtensionProperties& l_Extension : l_Extensions)
+    {
+        if (std::strcmp(l_Extension.extensionName, VK_EXT_MESH_SHADER_EXTENSION_NAME) == 0)
+        {
+            l_Found = true;
+            break;
+        }
+    }
+
+    if (!l_Found)
+        return false;
+
+    // Some drivers expose the extension with only one of the two stages
+    VkPhysicalDeviceMeshShaderFeaturesEXT l_MeshFeatures{};
+    l_MeshFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2 l_Features{};
+    l_Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    l_Features.pNext = &l_MeshFeatures;
+    vkGetPhysicalDeviceFeatures2(p_GPU, &l_Features);
+
+    return l_MeshFeatures.taskShader && l_MeshFeatures.meshShader;
+}
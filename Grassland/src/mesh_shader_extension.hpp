@@ -0,0 +1,22 @@
+#pragma once
+#include "ext/vulkan_extension_management.hpp"
+
+// Turns on task and mesh shaders when the device is created, only added when the GPU exposes VK_EXT_mesh_shader
+class MeshShaderExtension final : public VulkanDeviceExtension
+{
+public:
+    explicit MeshShaderExtension(ResourceID p_DeviceID);
+
+    void free() override {}
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override;
+
+    [[nodiscard]] VulkanDeviceExtension* copy() override;
+
+    // Whether the extension and both of its shader stages are available on the GPU
+    [[nodiscard]] static bool isSupported(VkPhysicalDevice p_GPU);
+
+private:
+    mutable VkPhysicalDeviceMeshShaderFeaturesEXT m_Features{};
+};
@@ -0,0 +1,64 @@
+#include "noise_chunk_cache.hpp"
+
+void NoiseChunkCache::initialize(const uint32_t p_Capacity)
+{
+    m_Capacity = p_Capacity;
+    clear();
+}
+
+void NoiseChunkCache::clear()
+{
+    m_Order.clear();
+    m_Entries.clear();
+}
+
+uint32_t NoiseChunkCache::find(const Key& p_Key)
+{
+    const auto l_It = m_Entries.find(p_Key);
+    if (l_It == m_Entries.end())
+    {
+        m_Misses++;
+        return UINT32_MAX;
+    }
+
+    m_Hits++;
+    l_It->second->stamp = m_Stamp;
+    m_Order.splice(m_Order.begin(), m_Order, l_It->second);
+    return l_It->second->slot;
+}
+
+uint32_t NoiseChunkCache::insert(const Key& p_Key)
+{
+    if (m_Capacity == 0)
+        return UINT32_MAX;
+
+    uint32_t l_Slot;
+    if (m_Entries.size() < m_Capacity)
+    {
+        l_Slot = static_cast<uint32_t>(m_Entries.size());
+    }
+    else
+    {
+        // The slot may still be read by a copy recorded in this update
+        Entry& l_Oldest = m_Order.back();
+        if (l_Oldest.stamp == m_Stamp)
+            return UINT32_MAX;
+
+        l_Slot = l_Oldest.slot;
+        m_Entries.erase(l_Oldest.key);
+        m_Order.pop_back();
+        m_Evictions++;
+    }
+
+    m_Order.push_front({ .key = p_Key, .slot = l_Slot, .stamp = m_Stamp });
+    m_Entries[p_Key] = m_Order.begin();
+    return l_Slot;
+}
+
+size_t NoiseChunkCache::KeyHash::operator()(const Key& p_Key) const
+{
+    uint64_t l_Hash = p_Key.inputs;
+    l_Hash ^= static_cast<uint32_t>(p_Key.chunk.x) + 0x9e3779b97f4a7c15ull + (l_Hash << 6) + (l_Hash >> 2);
+    l_Hash ^= static_cast<uint32_t>(p_Key.chunk.y) + 0x9e3779b97f4a7c15ull + (l_Hash << 6) + (l_Hash >> 2);
+    return static_cast<size_t>(l_Hash);
+}
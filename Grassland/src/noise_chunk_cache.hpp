@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+// Least recently used bookkeeping of a fixed number of pool slots, each holding one chunk of a noise lattice.
+// Chunks are keyed by a hash of the noise inputs and their chunk coordinate on the lattice, the pool itself lives on the GPU.
+// Every lookup and insertion is stamped with the update it happened in, so an insertion never evicts a slot used by the same update
+class NoiseChunkCache
+{
+public:
+    struct Key
+    {
+        uint64_t inputs = 0;
+        glm::ivec2 chunk{};
+
+        [[nodiscard]] bool operator==(const Key& p_Other) const { return inputs == p_Other.inputs && chunk == p_Other.chunk; }
+    };
+
+    void initialize(uint32_t p_Capacity);
+    // Forgets every chunk, the counters are kept
+    void clear();
+
+    // Starts a new update, slots used from here on are kept until the next one
+    void beginUpdate() { m_Stamp++; }
+
+    // Slot holding the chunk, or UINT32_MAX. Counts a hit or a miss
+    [[nodiscard]] uint32_t find(const Key& p_Key);
+    [[nodiscard]] bool contains(const Key& p_Key) const { return m_Entries.contains(p_Key); }
+    // Slot the chunk should be written to, evicting the least recently used one. UINT32_MAX when every slot was used by this update
+    [[nodiscard]] uint32_t insert(const Key& p_Key);
+
+    [[nodiscard]] uint32_t getCapacity() const { return m_Capacity; }
+    [[nodiscard]] uint32_t getSize() const { return static_cast<uint32_t>(m_Entries.size()); }
+    [[nodiscard]] uint64_t getHitCount() const { return m_Hits; }
+    [[nodiscard]] uint64_t getMissCount() const { return m_Misses; }
+    [[nodiscard]] uint64_t getEvictionCount() const { return m_Evictions; }
+    void resetCounters() { m_Hits = 0; m_Misses = 0; m_Evictions = 0; }
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& p_Key) const;
+    };
+
+    struct Entry
+    {
+        Key key;
+        uint32_t slot;
+        uint32_t stamp;
+    };
+
+    uint32_t m_Capacity = 0;
+    uint32_t m_Stamp = 0;
+    // Most recently used first
+    std::list<Entry> m_Order{};
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_Entries{};
+
+    uint64_t m_Hits = 0;
+    uint64_t m_Misses = 0;
+    uint64_t m_Evictions = 0;
+};
@@ -1,13 +1,160 @@
 #include "noise_engine.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#include "cpu_profiler.hpp"
 #include "engine.hpp"
 #include "vulkan_device.hpp"
 #include "backends/imgui_impl_vulkan.h"
 #include "utils/logger.hpp"
 
-void NoiseEngine::NoiseObject::initialize(uint32_t p_Size, Engine& p_Engine, const bool p_IncludeNormal)
+namespace
+{
+    bool hasSameInputs(const NoiseEngine::NoisePushConstantData& p_A, const NoiseEngine::NoisePushConstantData& p_B)
+    {
+        return p_A.size == p_B.size && p_A.w == p_B.w && p_A.scale == p_B.scale && p_A.octaves == p_B.octaves
+            && p_A.persistence == p_B.persistence && p_A.lacunarity == p_B.lacunarity;
+    }
+
+    bool hasSameInputs(const NoiseEngine::NormalPushConstantData& p_A, const NoiseEngine::NormalPushConstantData& p_B)
+    {
+        return p_A.heightScale == p_B.heightScale && p_A.offsetScale == p_B.offsetScale
+            && p_A.patchSize == p_B.patchSize && p_A.gridSize == p_B.gridSize;
+    }
+
+    // FNV-1a over the inputs a chunk is generated from, the offset only picks the chunk
+    uint64_t hashValue(uint64_t p_Hash, const uint32_t p_Value)
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            p_Hash ^= (p_Value >> (i * 8)) & 0xffu;
+            p_Hash *= 0x100000001b3ull;
+        }
+        return p_Hash;
+    }
+
+    uint64_t getInputsHash(const NoiseEngine::NoisePushConstantData& p_Noise)
+    {
+        uint64_t l_Hash = 0xcbf29ce484222325ull;
+        l_Hash = hashValue(l_Hash, p_Noise.size.x);
+        l_Hash = hashValue(l_Hash, p_Noise.size.y);
+        l_Hash = hashValue(l_Hash, std::bit_cast<uint32_t>(p_Noise.w));
+        l_Hash = hashValue(l_Hash, std::bit_cast<uint32_t>(p_Noise.scale));
+        l_Hash = hashValue(l_Hash, p_Noise.octaves);
+        l_Hash = hashValue(l_Hash, std::bit_cast<uint32_t>(p_Noise.persistence));
+        return hashValue(l_Hash, std::bit_cast<uint32_t>(p_Noise.lacunarity));
+    }
+
+    uint64_t getInputsHash(const NoiseEngine::NoisePushConstantData& p_Noise, const NoiseEngine::NormalPushConstantData& p_Normal)
+    {
+        uint64_t l_Hash = getInputsHash(p_Noise);
+        l_Hash = hashValue(l_Hash, std::bit_cast<uint32_t>(p_Normal.heightScale));
+        l_Hash = hashValue(l_Hash, std::bit_cast<uint32_t>(p_Normal.offsetScale));
+        l_Hash = hashValue(l_Hash, std::bit_cast<uint32_t>(p_Normal.patchSize));
+        return hashValue(l_Hash, p_Normal.gridSize);
+    }
+
+    struct TerrainFormatInfo
+    {
+        const char* name;
+        VkFormat heightFormat;
+        VkFormat normalFormat;
+        uint32_t heightTexelSize;
+        uint32_t normalTexelSize;
+        // Storage image qualifiers of noise.comp and normal.comp
+        const char* heightQualifier;
+        const char* normalQualifier;
+    };
+
+    // Indexed by NoiseEngine::TerrainFormat
+    constexpr std::array<TerrainFormatInfo, NoiseEngine::s_TerrainFormatCount> s_TerrainFormats{ {
+        { "Full", VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, 4, 16, "r32f", "rgba32f" },
+        { "Half", VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SNORM, 2, 4, "r16f", "rg16_snorm" },
+        { "Compact", VK_FORMAT_R16_UNORM, VK_FORMAT_R8G8_SNORM, 2, 2, "r16", "rg8_snorm" },
+    } };
+
+    // Floored, lattice coordinates of a window can be negative
+    int32_t floorDiv(const int32_t p_A, const int32_t p_B)
+    {
+        return p_A / p_B - (p_A % p_B != 0 && (p_A < 0) != (p_B < 0));
+    }
+
+    int32_t floorMod(const int32_t p_A, const int32_t p_B)
+    {
+        return p_A - floorDiv(p_A, p_B) * p_B;
+    }
+
+    VkImageCopy getChunkCopy(const glm::ivec2 p_Src, const glm::ivec2 p_Dst, const glm::uvec2 p_Extent)
+    {
+        constexpr VkImageSubresourceLayers l_Subresource{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        return {
+            .srcSubresource = l_Subresource,
+            .srcOffset = { p_Src.x, p_Src.y, 0 },
+            .dstSubresource = l_Subresource,
+            .dstOffset = { p_Dst.x, p_Dst.y, 0 },
+            .extent = { p_Extent.x, p_Extent.y, 1 }
+        };
+    }
+}
+
+VkFormat NoiseEngine::getHeightFormat(const TerrainFormat p_Format)
+{
+    return s_TerrainFormats[static_cast<uint32_t>(p_Format)].heightFormat;
+}
+
+VkFormat NoiseEngine::getNormalFormat(const TerrainFormat p_Format)
+{
+    return s_TerrainFormats[static_cast<uint32_t>(p_Format)].normalFormat;
+}
+
+uint32_t NoiseEngine::getHeightTexelSize(const TerrainFormat p_Format)
+{
+    return s_TerrainFormats[static_cast<uint32_t>(p_Format)].heightTexelSize;
+}
+
+uint32_t NoiseEngine::getNormalTexelSize(const TerrainFormat p_Format)
+{
+    return s_TerrainFormats[static_cast<uint32_t>(p_Format)].normalTexelSize;
+}
+
+const char* NoiseEngine::getTerrainFormatName(const TerrainFormat p_Format)
+{
+    return s_TerrainFormats[static_cast<uint32_t>(p_Format)].name;
+}
+
+bool NoiseEngine::isTerrainFormatSupported(const VkPhysicalDevice p_GPU, const TerrainFormat p_Format, const bool p_Transfer, const bool p_IncludeNormal)
+{
+    VkPhysicalDeviceFeatures l_Features;
+    vkGetPhysicalDeviceFeatures(p_GPU, &l_Features);
+    if (p_Format != TerrainFormat::FULL && !l_Features.shaderStorageImageExtendedFormats)
+        return false;
+
+    VkFormatFeatureFlags l_Required = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if (p_Transfer)
+        l_Required |= VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+    const std::array<VkFormat, 2> l_Formats{ getHeightFormat(p_Format), getNormalFormat(p_Format) };
+    for (uint32_t i = 0; i < (p_IncludeNormal ? 2u : 1u); i++)
+    {
+        VkFormatProperties l_Properties;
+        vkGetPhysicalDeviceFormatProperties(p_GPU, l_Formats[i], &l_Properties);
+        if ((l_Properties.optimalTilingFeatures & l_Required) != l_Required)
+            return false;
+    }
+    return true;
+}
+
+void NoiseEngine::NoiseObject::initialize(const std::string_view p_Name, uint32_t p_Size, Engine& p_Engine, const bool p_IncludeNormal, const bool p_PingPong, const bool p_Toroidal,
+                                          const TerrainFormat p_TerrainFormat)
 {
+    name = p_Name;
     includeNormal = p_IncludeNormal;
+    terrainFormat = p_IncludeNormal ? p_TerrainFormat : p_Engine.getRawNoiseFormat();
+    pingPong = p_PingPong && !p_IncludeNormal;
+    toroidal = p_Toroidal && !pingPong;
 
     m_NoiseEngine = &p_Engine.getNoiseEngine();
 
@@ -19,49 +166,27 @@ void NoiseEngine::NoiseObject::initialize(uint32_t p_Size, Engine& p_Engine, con
 
     noisePushConstants.size = { p_Size, p_Size };
 
-    noiseImage.image = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_R32_SFLOAT, extent, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, 0);
+    createNoiseImage(noiseImage, computeNoiseDescriptorSetID, p_Size);
+    if (pingPong)
+        createNoiseImage(backNoiseImage, backComputeNoiseDescriptorSetID, p_Size);
     VulkanImage& l_HeightmapImage = l_Device.getImage(noiseImage.image);
-    l_HeightmapImage.allocateFromFlags({ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, false });
-    l_HeightmapImage.setQueue(l_ComputeFamilyIndex);
-
-    noiseImage.view = l_HeightmapImage.createImageView(VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    noiseImage.sampler = l_HeightmapImage.createSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
-
-    computeNoiseDescriptorSetID = l_Device.createDescriptorSet(l_Engine.getDescriptorPoolID(), m_NoiseEngine->m_ComputeNoiseDescriptorSetLayoutID);
 
     if (includeNormal)
     {
-        normalImage.image = l_Device.createImage(VK_IMAGE_TYPE_2D, VK_FORMAT_R32G32B32A32_SFLOAT, extent, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, 0);
+        // Toroidal images can be copied to and from a chunk pool
+        const VkImageUsageFlags l_TransferUsage = toroidal ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0;
+        const VkFormat l_NormalFormat = getNormalFormat(terrainFormat);
+        normalImage.image = l_Device.createImage(VK_IMAGE_TYPE_2D, l_NormalFormat, extent, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | l_TransferUsage, 0);
         VulkanImage& l_NormalmapImage = l_Device.getImage(normalImage.image);
         l_NormalmapImage.allocateFromFlags({ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, false });
         l_NormalmapImage.setQueue(l_ComputeFamilyIndex);
 
-        normalImage.view = l_NormalmapImage.createImageView(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
-        normalImage.sampler = l_NormalmapImage.createSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+        normalImage.view = l_NormalmapImage.createImageView(l_NormalFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+        normalImage.sampler = l_NormalmapImage.createSampler(VK_FILTER_LINEAR, toroidal ? VK_SAMPLER_ADDRESS_MODE_REPEAT : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
 
         computeNormalDescriptorSetID = l_Device.createDescriptorSet(l_Engine.getDescriptorPoolID(), m_NoiseEngine->m_ComputeNormalDescriptorSetLayoutID);
     }
 
-    {
-        std::array<VkWriteDescriptorSet, 1> l_Writes{};
-        VkDescriptorImageInfo l_ComputeImageInfo;
-        {
-            l_ComputeImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-            l_ComputeImageInfo.imageView = *l_HeightmapImage.getImageView(noiseImage.view);
-            l_ComputeImageInfo.sampler = *l_HeightmapImage.getSampler(noiseImage.sampler);
-
-            l_Writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            l_Writes[0].dstSet = *l_Device.getDescriptorSet(computeNoiseDescriptorSetID);
-            l_Writes[0].dstBinding = 0;
-            l_Writes[0].dstArrayElement = 0;
-            l_Writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-            l_Writes[0].descriptorCount = 1;
-            l_Writes[0].pImageInfo = &l_ComputeImageInfo;
-        }
-
-        l_Device.updateDescriptorSets(l_Writes);
-    }
-
     if (includeNormal)
     {
         VulkanImage& l_NormalmapImage = l_Device.getImage(normalImage.image);
@@ -98,6 +223,207 @@ void NoiseEngine::NoiseObject::initialize(uint32_t p_Size, Engine& p_Engine, con
     }
 }
 
+void NoiseEngine::NoiseObject::createNoiseImage(ImageData& p_Image, ResourceID& p_DescriptorSetID, const uint32_t p_Size) const
+{
+    const Engine& l_Engine = m_NoiseEngine->getEngine();
+    VulkanDevice& l_Device = l_Engine.getDevice();
+
+    const VkExtent3D extent = { p_Size, p_Size, 1 };
+    const VkImageUsageFlags l_TransferUsage = toroidal ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0;
+    const VkFormat l_Format = getHeightFormat(terrainFormat);
+    p_Image.image = l_Device.createImage(VK_IMAGE_TYPE_2D, l_Format, extent, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | l_TransferUsage, 0);
+    VulkanImage& l_Image = l_Device.getImage(p_Image.image);
+    l_Image.allocateFromFlags({ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, false });
+    l_Image.setQueue(l_Engine.getComputeQueuePos().familyIndex);
+
+    p_Image.view = l_Image.createImageView(l_Format, VK_IMAGE_ASPECT_COLOR_BIT);
+    // Toroidal images wrap around, the normal pass and every reader sample across the seam
+    p_Image.sampler = l_Image.createSampler(VK_FILTER_LINEAR, toroidal ? VK_SAMPLER_ADDRESS_MODE_REPEAT : VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+    p_DescriptorSetID = l_Device.createDescriptorSet(l_Engine.getDescriptorPoolID(), m_NoiseEngine->m_ComputeNoiseDescriptorSetLayoutID);
+
+    std::array<VkWriteDescriptorSet, 1> l_Writes{};
+    VkDescriptorImageInfo l_ComputeImageInfo;
+    {
+        l_ComputeImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        l_ComputeImageInfo.imageView = *l_Image.getImageView(p_Image.view);
+        l_ComputeImageInfo.sampler = *l_Image.getSampler(p_Image.sampler);
+
+        l_Writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        l_Writes[0].dstSet = *l_Device.getDescriptorSet(p_DescriptorSetID);
+        l_Writes[0].dstBinding = 0;
+        l_Writes[0].dstArrayElement = 0;
+        l_Writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        l_Writes[0].descriptorCount = 1;
+        l_Writes[0].pImageInfo = &l_ComputeImageInfo;
+    }
+
+    l_Device.updateDescriptorSets(l_Writes);
+}
+
+void NoiseEngine::NoiseObject::createChunkCache()
+{
+    if (!toroidal || noisePushConstants.size.x % s_ChunkSize != 0)
+        return;
+
+    createChunkPool(noiseChunks, getHeightFormat(terrainFormat), getHeightTexelSize(terrainFormat));
+    if (includeNormal)
+        createChunkPool(normalChunks, getNormalFormat(terrainFormat), getNormalTexelSize(terrainFormat));
+}
+
+void NoiseEngine::NoiseObject::createChunkPool(ChunkPool& p_Pool, const VkFormat p_Format, const uint32_t p_TexelSize) const
+{
+    const Engine& l_Engine = m_NoiseEngine->getEngine();
+    VulkanDevice& l_Device = l_Engine.getDevice();
+
+    // A row of windows of chunks, side by side
+    const uint32_t l_ChunksPerSide = noisePushConstants.size.x / s_ChunkSize;
+    p_Pool.columns = l_ChunksPerSide * s_ChunkCacheWindows;
+    p_Pool.texelSize = p_TexelSize;
+    p_Pool.cache.initialize(p_Pool.columns * l_ChunksPerSide);
+
+    const VkExtent3D l_Extent = { p_Pool.columns * s_ChunkSize, l_ChunksPerSide * s_ChunkSize, 1 };
+    p_Pool.image = l_Device.createImage(VK_IMAGE_TYPE_2D, p_Format, l_Extent, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0);
+    VulkanImage& l_Image = l_Device.getImage(p_Pool.image);
+    l_Image.allocateFromFlags({ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, false });
+    l_Image.setQueue(l_Engine.getComputeQueuePos().familyIndex);
+}
+
+uint32_t NoiseEngine::NoiseObject::getEncoding() const
+{
+    // Matches TERRAIN_ENCODING_* of terrain_encoding.glsl
+    if (!includeNormal)
+        return 0;
+    return terrainFormat == TerrainFormat::FULL ? 1 : 2;
+}
+
+float NoiseEngine::NoiseObject::getMaxGradient() const
+{
+    // Each psrdnoise corner adds w^4 g + 8 w^3 (g.x) x with a unit g and w = 0.8 - |x|^2, which never gets past 0.516,
+    // so an octave's gradient stays under 10.9 * 3 * 0.516 per unit of its input
+    constexpr float l_OctaveBound = 10.9f * 3.f * 0.516f;
+    float l_Sum = 0.f;
+    float l_Factor = 1.f;
+    for (uint32_t i = 0; i < noisePushConstants.octaves; i++)
+    {
+        l_Sum += l_Factor;
+        l_Factor *= noisePushConstants.lacunarity / noisePushConstants.persistence;
+    }
+    // The first octave's input is the image uv times the scale, and the noise is stored remapped to (n + 1) / 2
+    return 0.5f * noisePushConstants.scale * l_OctaveBound * l_Sum;
+}
+
+glm::ivec2 NoiseEngine::NoiseObject::getWindowOrigin() const
+{
+    return glm::ivec2(glm::floor(noisePushConstants.offset * glm::vec2(noisePushConstants.size)));
+}
+
+NoiseEngine::RegionPushConstantData NoiseEngine::NoiseObject::getFullRegion(const glm::ivec2 p_Origin) const
+{
+    return { .origin = p_Origin, .size = noisePushConstants.size, .wrap = toroidal };
+}
+
+std::vector<NoiseEngine::RegionPushConstantData> NoiseEngine::NoiseObject::getExposedRegions(const glm::ivec2 p_OldOrigin, const glm::ivec2 p_Origin, const int32_t p_Margin) const
+{
+    const glm::ivec2 l_Size = glm::ivec2(noisePushConstants.size);
+    const glm::ivec2 l_End = p_Origin + l_Size;
+    const glm::ivec2 l_Shift = p_Origin - p_OldOrigin;
+
+    // Exposed span of the new window along one axis, the whole window once the shift reaches its size
+    auto l_GetSpan = [&](const int p_Axis) -> glm::ivec2
+    {
+        if (l_Shift[p_Axis] > 0)
+            return { std::max(p_OldOrigin[p_Axis] + l_Size[p_Axis] - p_Margin, p_Origin[p_Axis]), l_End[p_Axis] };
+        if (l_Shift[p_Axis] < 0)
+            return { p_Origin[p_Axis], std::min(p_OldOrigin[p_Axis] + p_Margin, l_End[p_Axis]) };
+        return { p_Origin[p_Axis], p_Origin[p_Axis] };
+    };
+    const glm::ivec2 l_Columns = l_GetSpan(0);
+    const glm::ivec2 l_Rows = l_GetSpan(1);
+
+    std::vector<RegionPushConstantData> l_Regions;
+    if (l_Columns.y > l_Columns.x)
+        l_Regions.push_back({ .origin = { l_Columns.x, p_Origin.y }, .size = glm::uvec2(l_Columns.y - l_Columns.x, l_Size.y), .wrap = true });
+
+    // The rows leave out the columns, which sit at one end of the window, so no texel is written twice
+    const int32_t l_RowStart = l_Shift.x > 0 ? p_Origin.x : l_Columns.y;
+    const int32_t l_RowEnd = l_Shift.x > 0 ? l_Columns.x : l_End.x;
+    if (l_Rows.y > l_Rows.x && l_RowEnd > l_RowStart)
+        l_Regions.push_back({ .origin = { l_RowStart, l_Rows.x }, .size = glm::uvec2(l_RowEnd - l_RowStart, l_Rows.y - l_Rows.x), .wrap = true });
+
+    return l_Regions;
+}
+
+NoiseEngine::NoiseObject::WindowUpdate NoiseEngine::NoiseObject::advanceNoiseWindow()
+{
+    const bool l_Full = !m_NoiseWindowValid || m_NoiseRebuildRequested || !hasSameInputs(m_NoiseWindowInputs, noisePushConstants);
+
+    WindowUpdate l_Update{ .origin = getWindowOrigin(), .keepsPrevious = !l_Full, .previousOrigin = m_NoiseWindowOrigin };
+    if (l_Full)
+        l_Update.regions.push_back(getFullRegion(l_Update.origin));
+    else
+        l_Update.regions = getExposedRegions(m_NoiseWindowOrigin, l_Update.origin, 0);
+
+    // Every normal was taken from heights that are gone
+    if (l_Full)
+        m_NormalWindowValid = false;
+
+    // A rebuild asked for from the UI should not come back from the pools
+    if (m_NoiseRebuildRequested)
+    {
+        noiseChunks.cache.clear();
+        normalChunks.cache.clear();
+    }
+
+    m_NoiseWindowValid = true;
+    m_NoiseWindowOrigin = l_Update.origin;
+    m_NoiseWindowInputs = noisePushConstants;
+    m_NoiseRebuildRequested = false;
+    return l_Update;
+}
+
+NoiseEngine::NoiseObject::WindowUpdate NoiseEngine::NoiseObject::advanceNormalWindow()
+{
+    const bool l_Full = !m_NormalWindowValid || m_NormalRebuildRequested || !hasSameInputs(m_NormalWindowInputs, normalPushConstants);
+
+    // Follows the heights that were actually written, not the offset
+    WindowUpdate l_Update{ .origin = m_NoiseWindowOrigin, .keepsPrevious = !l_Full, .previousOrigin = m_NormalWindowOrigin };
+    if (l_Full)
+        l_Update.regions.push_back(getFullRegion(l_Update.origin));
+    else
+        l_Update.regions = getExposedRegions(m_NormalWindowOrigin, l_Update.origin, getNormalMargin());
+
+    if (m_NormalRebuildRequested)
+        normalChunks.cache.clear();
+
+    m_NormalWindowValid = true;
+    m_NormalWindowOrigin = l_Update.origin;
+    m_NormalWindowInputs = normalPushConstants;
+    m_NormalRebuildRequested = false;
+    return l_Update;
+}
+
+NoiseEngine::NoiseObject::WindowUpdate NoiseEngine::NoiseObject::getFullUpdate() const
+{
+    return { .regions = { getFullRegion(glm::ivec2(0)) } };
+}
+
+int32_t NoiseEngine::NoiseObject::getNormalMargin() const
+{
+    return static_cast<int32_t>(std::ceil(normalPushConstants.offsetScale * static_cast<float>(noisePushConstants.size.x))) + 1;
+}
+
+void NoiseEngine::NoiseObject::swapPingPong()
+{
+    if (!m_BackWritten)
+        return;
+
+    std::swap(noiseImage, backNoiseImage);
+    std::swap(computeNoiseDescriptorSetID, backComputeNoiseDescriptorSetID);
+    frontIndex ^= 1;
+    m_BackWritten = false;
+}
+
 void NoiseEngine::NoiseObject::initializeImgui()
 {
     VulkanDevice& l_Device = m_NoiseEngine->getEngine().getDevice();
@@ -193,6 +519,7 @@ void NoiseEngine::NoiseObject::drawImgui(const std::string_view p_NoiseName)
         if (ImGui::Button("Recompute Noise"))
         {
             noiseNeedsRebuild = true;
+            m_NoiseRebuildRequested = true;
         }
     }
     else
@@ -261,6 +588,7 @@ void NoiseEngine::NoiseObject::drawImgui(const std::string_view p_NoiseName)
             if (ImGui::Button("Recompute Normal"))
             {
                 normalNeedsRebuild = true;
+                m_NormalRebuildRequested = true;
             }
         }
         else
@@ -275,6 +603,34 @@ void NoiseEngine::NoiseObject::drawImgui(const std::string_view p_NoiseName)
         }
 
         ImGui::Separator();
+        drawTerrainFormatImgui();
+        ImGui::Separator();
+    }
+
+    if (toroidal)
+    {
+        const glm::ivec2 l_Origin = m_NoiseWindowOrigin;
+        const float l_ImageTexels = static_cast<float>(noisePushConstants.size.x * noisePushConstants.size.y);
+        ImGui::Text("Toroidal window origin: %d, %d", l_Origin.x, l_Origin.y);
+        ImGui::Text("Noise texels last dispatched: %u (%.1f%%)", m_DebugNoiseTexels, 100.f * static_cast<float>(m_DebugNoiseTexels) / l_ImageTexels);
+        if (includeNormal)
+            ImGui::Text("Normal texels last dispatched: %u (%.1f%%)", m_DebugNormalTexels, 100.f * static_cast<float>(m_DebugNormalTexels) / l_ImageTexels);
+
+        if (noiseChunks.image != UINT32_MAX)
+        {
+            ImGui::Checkbox("Chunk Cache", &useChunkCache);
+            drawChunkPoolImgui("Noise", noiseChunks);
+            if (includeNormal)
+                drawChunkPoolImgui("Normal", normalChunks);
+            if (ImGui::Button("Clear Chunk Cache"))
+            {
+                noiseChunks.cache.clear();
+                noiseChunks.cache.resetCounters();
+                normalChunks.cache.clear();
+                normalChunks.cache.resetCounters();
+            }
+        }
+        ImGui::Separator();
     }
 
     // ComboBox
@@ -319,6 +675,37 @@ void NoiseEngine::NoiseObject::drawImgui(const std::string_view p_NoiseName)
     ImGui::End();
 }
 
+void NoiseEngine::NoiseObject::drawTerrainFormatImgui() const
+{
+    const float l_Texels = static_cast<float>(noisePushConstants.size.x * noisePushConstants.size.y);
+
+    // A bilinear fetch touches 4 texels when nothing is cached, a tessellated vertex reads both images and a blade only the height
+    ImGui::Text("Terrain format: %s (picked at startup)", getTerrainFormatName(terrainFormat));
+    for (uint32_t i = 0; i < s_TerrainFormatCount; i++)
+    {
+        const TerrainFormat l_Format = static_cast<TerrainFormat>(i);
+        const uint32_t l_HeightSize = getHeightTexelSize(l_Format);
+        const uint32_t l_NormalSize = getNormalTexelSize(l_Format);
+        ImGui::Text("%s %-7s %u + %2u B/texel, %4.1f MiB, vertex fetch %2u B, blade fetch %u B", l_Format == terrainFormat ? ">" : " ",
+            getTerrainFormatName(l_Format), l_HeightSize, l_NormalSize, l_Texels * static_cast<float>(l_HeightSize + l_NormalSize) / (1024.f * 1024.f),
+            4 * (l_HeightSize + l_NormalSize), 4 * l_HeightSize);
+    }
+}
+
+void NoiseEngine::NoiseObject::drawChunkPoolImgui(const std::string_view p_Name, const ChunkPool& p_Pool) const
+{
+    const NoiseChunkCache& l_Cache = p_Pool.cache;
+    const uint64_t l_Lookups = l_Cache.getHitCount() + l_Cache.getMissCount();
+    const float l_PoolMiB = static_cast<float>(l_Cache.getCapacity()) * s_ChunkSize * s_ChunkSize * p_Pool.texelSize / (1024.f * 1024.f);
+
+    ImGui::Text("%s chunks: %u / %u (%.1f MiB)", p_Name.data(), l_Cache.getSize(), l_Cache.getCapacity(), l_PoolMiB);
+    ImGui::Text("%s hits: %llu, misses: %llu (%.1f%% hit), evictions: %llu", p_Name.data(),
+        static_cast<unsigned long long>(l_Cache.getHitCount()), static_cast<unsigned long long>(l_Cache.getMissCount()),
+        l_Lookups == 0 ? 0.f : 100.f * static_cast<float>(l_Cache.getHitCount()) / static_cast<float>(l_Lookups),
+        static_cast<unsigned long long>(l_Cache.getEvictionCount()));
+    ImGui::Text("%s last update: %u copied, %u dispatched, %u saved", p_Name.data(), p_Pool.lastCopied, p_Pool.lastDispatched, p_Pool.lastSaved);
+}
+
 void NoiseEngine::NoiseObject::cleanupImgui()
 {
     ImGui_ImplVulkan_RemoveTexture(imguiHeightmapDescriptorSet);
@@ -365,24 +752,34 @@ void NoiseEngine::initialize()
 
     {
         std::array<VkPushConstantRange, 1> l_ComputeNoisePushConstantRanges;
-        l_ComputeNoisePushConstantRanges[0] = { VkPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoisePushConstantData)} };
+        l_ComputeNoisePushConstantRanges[0] = { VkPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoisePushConstantData) + sizeof(RegionPushConstantData)} };
         std::array<ResourceID, 1> l_ComputeDescriptorSetLayouts = { m_ComputeNoiseDescriptorSetLayoutID };
         m_ComputeNoisePipelineLayoutID = l_Device.createPipelineLayout(l_ComputeDescriptorSetLayouts, l_ComputeNoisePushConstantRanges);
 
-        const uint32_t l_ComputeShaderID = l_Device.createShader("shaders/noise.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, {});
-        m_ComputeNoisePipelineID = l_Device.createComputePipeline(m_ComputeNoisePipelineLayoutID, l_ComputeShaderID, "main");
+        // FULL is also the format of every object that is not a terrain
+        for (const TerrainFormat l_Format : { TerrainFormat::FULL, m_Engine.getTerrainFormat() })
+        {
+            ResourceID& l_PipelineID = m_ComputeNoisePipelineIDs[static_cast<uint32_t>(l_Format)];
+            if (l_PipelineID != UINT32_MAX)
+                continue;
+
+            const uint32_t l_ComputeShaderID = l_Device.createShader("shaders/noise.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, { { "NOISE_FORMAT", s_TerrainFormats[static_cast<uint32_t>(l_Format)].heightQualifier } });
+            l_PipelineID = l_Device.createComputePipeline(m_ComputeNoisePipelineLayoutID, l_ComputeShaderID, "main");
 
-        l_Device.freeShader(l_ComputeShaderID);
+            l_Device.freeShader(l_ComputeShaderID);
+        }
     }
 
     {
         std::array<VkPushConstantRange, 1> l_ComputeNormalPushConstantRanges;
-        l_ComputeNormalPushConstantRanges[0] = { VkPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NormalPushConstantData)} };
+        l_ComputeNormalPushConstantRanges[0] = { VkPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NormalPushConstantData) + sizeof(RegionPushConstantData)} };
         std::array<ResourceID, 1> l_ComputeNormalDescriptorSetLayouts = { m_ComputeNormalDescriptorSetLayoutID };
         m_ComputeNormalPipelineLayoutID = l_Device.createPipelineLayout(l_ComputeNormalDescriptorSetLayouts, l_ComputeNormalPushConstantRanges);
 
-        const uint32_t l_ComputeShader = l_Device.createShader("shaders/normal.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, {});
-        m_ComputeNormalPipelineID = l_Device.createComputePipeline(m_ComputeNormalPipelineLayoutID, l_ComputeShader, "main");
+        // Only the heightmap has normals
+        const TerrainFormat l_Format = m_Engine.getTerrainFormat();
+        const uint32_t l_ComputeShader = l_Device.createShader("shaders/normal.comp", VK_SHADER_STAGE_COMPUTE_BIT, false, { { "NORMAL_FORMAT", s_TerrainFormats[static_cast<uint32_t>(l_Format)].normalQualifier } });
+        m_ComputeNormalPipelineIDs[static_cast<uint32_t>(l_Format)] = l_Device.createComputePipeline(m_ComputeNormalPipelineLayoutID, l_ComputeShader, "main");
 
         l_Device.freeShader(l_ComputeShader);
     }
@@ -401,6 +798,14 @@ bool NoiseEngine::recalculateNoise(VulkanCommandBuffer& p_CmdBuffer, NoiseObject
     if (!p_Object.noiseNeedsRebuild)
         return false;
 
+    // A toroidal object only writes the texels its window gained, nothing when the offset moved by less than one
+    const NoiseObject::WindowUpdate l_Update = p_Object.toroidal ? p_Object.advanceNoiseWindow() : p_Object.getFullUpdate();
+    if (l_Update.regions.empty())
+    {
+        p_Object.noiseNeedsRebuild = false;
+        return false;
+    }
+
     if (!p_CmdBuffer.isRecording())
     {
         p_CmdBuffer.reset();
@@ -409,30 +814,52 @@ bool NoiseEngine::recalculateNoise(VulkanCommandBuffer& p_CmdBuffer, NoiseObject
 
     VulkanDevice& l_Device = m_Engine.getDevice();
     
-    VulkanImage& l_HeightmapImage = l_Device.getImage(p_Object.noiseImage.image);
-    const VkExtent3D l_ImageSize = l_HeightmapImage.getSize();
-    const uint32_t groupCountX = (l_ImageSize.width + 7) / 8;
-    const uint32_t groupCountY = (l_ImageSize.height + 7) / 8;
+    // The front image of a ping-ponged object may still be read by frames in flight
+    const bool l_WriteBack = p_Object.pingPong && p_Object.isFrontWritten();
+    const NoiseObject::ImageData& l_Target = l_WriteBack ? p_Object.backNoiseImage : p_Object.noiseImage;
+    const ResourceID l_DescriptorSetID = l_WriteBack ? p_Object.backComputeNoiseDescriptorSetID : p_Object.computeNoiseDescriptorSetID;
+
+    VulkanImage& l_HeightmapImage = l_Device.getImage(l_Target.image);
 
     const uint32_t l_ComputeFamilyIndex = m_Engine.getComputeQueuePos().familyIndex;
 
-    VulkanMemoryBarrierBuilder l_EnterBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
-    l_EnterBarrierBuilder.addImageMemoryBarrier(p_Object.noiseImage.image, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamilyIndex, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, p_Object.name + " noise", l_ComputeFamilyIndex);
+
+    // Chunk pools are copied from and to on the same queue
+    const bool l_Cached = p_Object.isChunkCached();
+    const VkPipelineStageFlags l_WriteStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | (l_Cached ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0);
+    const VkAccessFlags l_WriteAccess = VK_ACCESS_SHADER_WRITE_BIT | (l_Cached ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : 0);
+
+    // Also orders the write after earlier compute reads on this queue, the grass compute samples its noise without a host wait
+    VulkanMemoryBarrierBuilder l_EnterBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, l_WriteStages, 0};
+    l_EnterBarrierBuilder.addImageMemoryBarrier(l_Target.image, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamilyIndex, VK_ACCESS_SHADER_READ_BIT, l_WriteAccess);
     p_CmdBuffer.cmdPipelineBarrier(l_EnterBarrierBuilder);
     l_HeightmapImage.setLayout(VK_IMAGE_LAYOUT_GENERAL);
     l_HeightmapImage.setQueue(l_ComputeFamilyIndex);
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNoisePipelineID);
-    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNoisePipelineLayoutID, p_Object.computeNoiseDescriptorSetID);
-    p_CmdBuffer.cmdPushConstant(m_ComputeNoisePipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoisePushConstantData), &p_Object.noisePushConstants);
-    p_CmdBuffer.cmdDispatch(groupCountX, groupCountY, 1);
+    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNoisePipelineIDs[static_cast<uint32_t>(p_Object.terrainFormat)]);
+    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNoisePipelineLayoutID, l_DescriptorSetID);
+    // Lattice texels of a toroidal object already include the offset
+    NoisePushConstantData l_PushConstants = p_Object.noisePushConstants;
+    if (p_Object.toroidal)
+        l_PushConstants.offset = glm::vec2(0.f);
+    p_CmdBuffer.cmdPushConstant(m_ComputeNoisePipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoisePushConstantData), &l_PushConstants);
 
-    VulkanMemoryBarrierBuilder l_ExitBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
-    l_ExitBarrierBuilder.addImageMemoryBarrier(p_Object.noiseImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, l_ComputeFamilyIndex, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+    p_Object.m_DebugNoiseTexels = cmdWriteRegions(p_CmdBuffer, p_Object, p_Object.noiseChunks, l_Target.image, l_Update, 0,
+                                                  getInputsHash(p_Object.noisePushConstants), m_ComputeNoisePipelineLayoutID, sizeof(NoisePushConstantData));
+
+    VulkanMemoryBarrierBuilder l_ExitBarrierBuilder{l_Device.getID(), l_WriteStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+    l_ExitBarrierBuilder.addImageMemoryBarrier(l_Target.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, l_ComputeFamilyIndex, VK_ACCESS_SHADER_WRITE_BIT | (l_Cached ? VK_ACCESS_TRANSFER_WRITE_BIT : 0), VK_ACCESS_SHADER_READ_BIT);
     p_CmdBuffer.cmdPipelineBarrier(l_ExitBarrierBuilder);
     l_HeightmapImage.setLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+
     p_Object.noiseNeedsRebuild = false;
+    p_Object.m_BackWritten = l_WriteBack;
+    p_Object.m_FrontWritten = true;
 
     return true;
 }
@@ -442,6 +869,13 @@ bool NoiseEngine::recalculateNormal(VulkanCommandBuffer& p_CmdBuffer, NoiseObjec
     if (!p_Object.includeNormal || !p_Object.normalNeedsRebuild)
         return false;
 
+    const NoiseObject::WindowUpdate l_Update = p_Object.toroidal ? p_Object.advanceNormalWindow() : p_Object.getFullUpdate();
+    if (l_Update.regions.empty())
+    {
+        p_Object.normalNeedsRebuild = false;
+        return false;
+    }
+
     if (!p_CmdBuffer.isRecording())
     {
         p_CmdBuffer.reset();
@@ -451,31 +885,157 @@ bool NoiseEngine::recalculateNormal(VulkanCommandBuffer& p_CmdBuffer, NoiseObjec
     VulkanDevice& l_Device = m_Engine.getDevice();
 
     VulkanImage& l_NormalmapImage = l_Device.getImage(p_Object.normalImage.image);
-    const VkExtent3D l_ImageSize = l_NormalmapImage.getSize();
-    const uint32_t groupCountX = (l_ImageSize.width + 7) / 8;
-    const uint32_t groupCountY = (l_ImageSize.height + 7) / 8;
 
     const uint32_t l_ComputeFamilyIndex = m_Engine.getComputeQueuePos().familyIndex;
     const uint32_t l_GraphicsFamilyIndex = m_Engine.getGraphicsQueuePos().familyIndex;
 
-    VulkanMemoryBarrierBuilder l_EnterBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
-    l_EnterBarrierBuilder.addImageMemoryBarrier(p_Object.normalImage.image, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamilyIndex, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    GpuProfiler& l_Profiler = m_Engine.getGpuProfiler();
+    l_Profiler.cmdResetZones(p_CmdBuffer, 1);
+    const uint32_t l_Zone = l_Profiler.cmdBeginZone(p_CmdBuffer, p_Object.name + " normal", l_ComputeFamilyIndex);
+
+    const bool l_Cached = p_Object.isChunkCached();
+    const VkPipelineStageFlags l_WriteStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | (l_Cached ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0);
+    const VkAccessFlags l_WriteAccess = VK_ACCESS_SHADER_WRITE_BIT | (l_Cached ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : 0);
+
+    VulkanMemoryBarrierBuilder l_EnterBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT, l_WriteStages, 0};
+    l_EnterBarrierBuilder.addImageMemoryBarrier(p_Object.normalImage.image, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamilyIndex, VK_ACCESS_SHADER_READ_BIT, l_WriteAccess);
     p_CmdBuffer.cmdPipelineBarrier(l_EnterBarrierBuilder);
     l_NormalmapImage.setLayout(VK_IMAGE_LAYOUT_GENERAL);
     l_NormalmapImage.setQueue(l_ComputeFamilyIndex);
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNormalPipelineID);
+    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNormalPipelineIDs[static_cast<uint32_t>(p_Object.terrainFormat)]);
     p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputeNormalPipelineLayoutID, p_Object.computeNormalDescriptorSetID);
     p_CmdBuffer.cmdPushConstant(m_ComputeNormalPipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NormalPushConstantData), &p_Object.normalPushConstants);
-    p_CmdBuffer.cmdDispatch(groupCountX, groupCountY, 1);
 
-    VulkanMemoryBarrierBuilder l_ExitBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT, 0};
-    l_ExitBarrierBuilder.addImageMemoryBarrier(p_Object.normalImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, l_GraphicsFamilyIndex, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+    // Saved normals have to stay clear of the spoiled edge of the window they were taken from
+    p_Object.m_DebugNormalTexels = cmdWriteRegions(p_CmdBuffer, p_Object, p_Object.normalChunks, p_Object.normalImage.image, l_Update, p_Object.getNormalMargin(),
+                                                   getInputsHash(p_Object.noisePushConstants, p_Object.normalPushConstants), m_ComputeNormalPipelineLayoutID, sizeof(NormalPushConstantData));
+
+    VulkanMemoryBarrierBuilder l_ExitBarrierBuilder{l_Device.getID(), l_WriteStages, VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT, 0};
+    l_ExitBarrierBuilder.addImageMemoryBarrier(p_Object.normalImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, l_GraphicsFamilyIndex, VK_ACCESS_SHADER_WRITE_BIT | (l_Cached ? VK_ACCESS_TRANSFER_WRITE_BIT : 0), VK_ACCESS_SHADER_READ_BIT);
     p_CmdBuffer.cmdPipelineBarrier(l_ExitBarrierBuilder);
     l_NormalmapImage.setLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     l_NormalmapImage.setQueue(l_GraphicsFamilyIndex);
 
+    l_Profiler.cmdEndZone(p_CmdBuffer, l_Zone);
+
     p_Object.normalNeedsRebuild = false;
 
     return true;
 }
+
+uint32_t NoiseEngine::cmdWriteRegions(VulkanCommandBuffer& p_CmdBuffer, const NoiseObject& p_Object, NoiseObject::ChunkPool& p_Pool, const ResourceID p_Image,
+                                      const NoiseObject::WindowUpdate& p_Update, const int32_t p_SaveMargin, const uint64_t p_Inputs, const ResourceID p_PipelineLayoutID, const uint32_t p_RegionOffset) const
+{
+    std::vector<RegionPushConstantData> l_Dispatches;
+    std::vector<VkImageCopy> l_Loads;
+    std::vector<VkImageCopy> l_Saves;
+
+    if (!p_Object.isChunkCached())
+    {
+        l_Dispatches = p_Update.regions;
+    }
+    else
+    {
+        CPU_PROFILE_ZONE("Noise chunk cache");
+
+        NoiseChunkCache& l_Cache = p_Pool.cache;
+        l_Cache.beginUpdate();
+
+        // Chunks sit on multiples of their size on the lattice, so none of them straddles the wrap of the image
+        const int32_t l_ChunkSize = static_cast<int32_t>(s_ChunkSize);
+        const int32_t l_ImageSize = static_cast<int32_t>(p_Object.noisePushConstants.size.x);
+        auto l_GetSlotPos = [&](const uint32_t p_Slot) { return glm::ivec2(p_Slot % p_Pool.columns, p_Slot / p_Pool.columns) * l_ChunkSize; };
+        auto l_GetImagePos = [&](const glm::ivec2 p_Texel) { return glm::ivec2(floorMod(p_Texel.x, l_ImageSize), floorMod(p_Texel.y, l_ImageSize)); };
+
+        // Looked up first, so saving chunks below never evicts a slot these copies read
+        for (const RegionPushConstantData& l_Region : p_Update.regions)
+        {
+            const glm::ivec2 l_End = l_Region.origin + glm::ivec2(l_Region.size);
+            for (int32_t l_Y = floorDiv(l_Region.origin.y, l_ChunkSize); l_Y * l_ChunkSize < l_End.y; ++l_Y)
+            {
+                for (int32_t l_X = floorDiv(l_Region.origin.x, l_ChunkSize); l_X * l_ChunkSize < l_End.x; ++l_X)
+                {
+                    const glm::ivec2 l_Chunk{ l_X, l_Y };
+                    const glm::ivec2 l_PieceMin = glm::max(l_Region.origin, l_Chunk * l_ChunkSize);
+                    const glm::ivec2 l_PieceMax = glm::min(l_End, (l_Chunk + 1) * l_ChunkSize);
+                    const glm::uvec2 l_PieceSize = glm::uvec2(l_PieceMax - l_PieceMin);
+
+                    const uint32_t l_Slot = l_Cache.find({ .inputs = p_Inputs, .chunk = l_Chunk });
+                    if (l_Slot != UINT32_MAX)
+                        l_Loads.push_back(getChunkCopy(l_GetSlotPos(l_Slot) + l_PieceMin - l_Chunk * l_ChunkSize, l_GetImagePos(l_PieceMin), l_PieceSize));
+                    else
+                        l_Dispatches.push_back({ .origin = l_PieceMin, .size = l_PieceSize, .wrap = true });
+                }
+            }
+        }
+
+        if (p_Update.keepsPrevious)
+        {
+            // Chunks the previous window held whole that the new one does not, before the writes below reach them
+            const glm::ivec2 l_Min = p_Update.previousOrigin + p_SaveMargin;
+            const glm::ivec2 l_Max = p_Update.previousOrigin + l_ImageSize - p_SaveMargin;
+            const glm::ivec2 l_NewMax = p_Update.origin + l_ImageSize;
+            for (int32_t l_Y = floorDiv(l_Min.y + l_ChunkSize - 1, l_ChunkSize); (l_Y + 1) * l_ChunkSize <= l_Max.y; ++l_Y)
+            {
+                for (int32_t l_X = floorDiv(l_Min.x + l_ChunkSize - 1, l_ChunkSize); (l_X + 1) * l_ChunkSize <= l_Max.x; ++l_X)
+                {
+                    const glm::ivec2 l_Chunk{ l_X, l_Y };
+                    const glm::ivec2 l_ChunkMin = l_Chunk * l_ChunkSize;
+                    if (glm::all(glm::greaterThanEqual(l_ChunkMin, p_Update.origin)) && glm::all(glm::lessThanEqual(l_ChunkMin + l_ChunkSize, l_NewMax)))
+                        continue;
+
+                    const NoiseChunkCache::Key l_Key{ .inputs = p_Inputs, .chunk = l_Chunk };
+                    if (l_Cache.contains(l_Key))
+                        continue;
+
+                    const uint32_t l_Slot = l_Cache.insert(l_Key);
+                    if (l_Slot == UINT32_MAX)
+                        continue;
+                    l_Saves.push_back(getChunkCopy(l_GetImagePos(l_ChunkMin), l_GetSlotPos(l_Slot), glm::uvec2(s_ChunkSize)));
+                }
+            }
+        }
+    }
+
+    if (!l_Saves.empty() || !l_Loads.empty())
+    {
+        VulkanDevice& l_Device = m_Engine.getDevice();
+        const uint32_t l_ComputeFamilyIndex = m_Engine.getComputeQueuePos().familyIndex;
+        VulkanImage& l_Image = l_Device.getImage(p_Image);
+        VulkanImage& l_PoolImage = l_Device.getImage(p_Pool.image);
+
+        // Orders these copies after the ones of earlier updates, and moves a new pool out of its undefined layout
+        VulkanMemoryBarrierBuilder l_PoolBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+        l_PoolBarrierBuilder.addImageMemoryBarrier(p_Pool.image, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamilyIndex, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        p_CmdBuffer.cmdPipelineBarrier(l_PoolBarrierBuilder);
+        l_PoolImage.setLayout(VK_IMAGE_LAYOUT_GENERAL);
+
+        if (!l_Saves.empty())
+        {
+            vkCmdCopyImage(*p_CmdBuffer, *l_Image, VK_IMAGE_LAYOUT_GENERAL, *l_PoolImage, VK_IMAGE_LAYOUT_GENERAL, static_cast<uint32_t>(l_Saves.size()), l_Saves.data());
+
+            // The saved texels are written over by the new window
+            VulkanMemoryBarrierBuilder l_SaveBarrierBuilder{l_Device.getID(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+            l_SaveBarrierBuilder.addImageMemoryBarrier(p_Image, VK_IMAGE_LAYOUT_GENERAL, l_ComputeFamilyIndex, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            p_CmdBuffer.cmdPipelineBarrier(l_SaveBarrierBuilder);
+        }
+
+        if (!l_Loads.empty())
+            vkCmdCopyImage(*p_CmdBuffer, *l_PoolImage, VK_IMAGE_LAYOUT_GENERAL, *l_Image, VK_IMAGE_LAYOUT_GENERAL, static_cast<uint32_t>(l_Loads.size()), l_Loads.data());
+    }
+
+    uint32_t l_Texels = 0;
+    for (RegionPushConstantData l_Region : l_Dispatches)
+    {
+        l_Region.encoding = p_Object.getEncoding();
+        p_CmdBuffer.cmdPushConstant(p_PipelineLayoutID, VK_SHADER_STAGE_COMPUTE_BIT, p_RegionOffset, sizeof(RegionPushConstantData), &l_Region);
+        p_CmdBuffer.cmdDispatch((l_Region.size.x + 7) / 8, (l_Region.size.y + 7) / 8, 1);
+        l_Texels += l_Region.size.x * l_Region.size.y;
+    }
+
+    p_Pool.lastCopied = static_cast<uint32_t>(l_Loads.size());
+    p_Pool.lastDispatched = static_cast<uint32_t>(l_Dispatches.size());
+    p_Pool.lastSaved = static_cast<uint32_t>(l_Saves.size());
+    return l_Texels;
+}
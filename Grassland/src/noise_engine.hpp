@@ -1,7 +1,11 @@
 #pragma once
 #include <__msvc_string_view.hpp>
+#include <array>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
+#include "noise_chunk_cache.hpp"
 #include "vulkan_queues.hpp"
 #include "utils/identifiable.hpp"
 
@@ -11,6 +15,30 @@ class VulkanCommandBuffer;
 class NoiseEngine
 {
 public:
+    // Side of the square chunks the chunk cache keeps, noise images have to be a multiple of it
+    static constexpr uint32_t s_ChunkSize = 64;
+    // Pool capacity of a chunk cache, in windows of chunks
+    static constexpr uint32_t s_ChunkCacheWindows = 2;
+
+    // Formats of the heightmap and its normal map, picked once at startup. Every other noise object stays in R32 float
+    enum class TerrainFormat : uint8_t
+    {
+        FULL,    // R32 float height, RGBA32 float normal
+        HALF,    // R16 float height, octahedral RG16 SNORM normal
+        COMPACT  // R16 UNORM height, octahedral RG8 SNORM normal
+    };
+    static constexpr uint32_t s_TerrainFormatCount = 3;
+
+    [[nodiscard]] static VkFormat getHeightFormat(TerrainFormat p_Format);
+    [[nodiscard]] static VkFormat getNormalFormat(TerrainFormat p_Format);
+    [[nodiscard]] static uint32_t getHeightTexelSize(TerrainFormat p_Format);
+    [[nodiscard]] static uint32_t getNormalTexelSize(TerrainFormat p_Format);
+    [[nodiscard]] static const char* getTerrainFormatName(TerrainFormat p_Format);
+    // Both images have to be storage images that can be sampled with linear filtering, and copied when p_Transfer is set.
+    // R32 float linear filtering is optional as well, the storage qualifiers of the other formats need shaderStorageImageExtendedFormats.
+    // Noise without a normal map only checks the height format
+    [[nodiscard]] static bool isTerrainFormatSupported(VkPhysicalDevice p_GPU, TerrainFormat p_Format, bool p_Transfer, bool p_IncludeNormal = true);
+
     struct NoisePushConstantData
     {
         alignas(8) glm::vec2 offset;
@@ -30,6 +58,17 @@ public:
         alignas(4) uint32_t gridSize = 100;
     };
 
+    // Texels a noise or normal dispatch writes, pushed after the object's push constants.
+    // Toroidal objects address texels on the unbounded noise lattice and store them wrapped into the image
+    struct RegionPushConstantData
+    {
+        alignas(8) glm::ivec2 origin;
+        alignas(8) glm::uvec2 size;
+        alignas(4) uint32_t wrap;
+        // NoiseObject::getEncoding, filled in by the dispatch
+        alignas(4) uint32_t encoding;
+    };
+
     struct NoiseObject
     {
         struct ImageData
@@ -39,11 +78,58 @@ public:
             ResourceID sampler = UINT32_MAX;
         };
 
+        // Used to label the GPU profiler zones of this object
+        std::string name{};
+
+        // Image sampled by this frame's passes
         ImageData noiseImage{};
         ImageData normalImage{};
 
+        // Ping-ponged objects write every recompute into the back image and swap it in at the start of the next frame,
+        // so readers never wait on the recompute of the frame they are drawn in. Only the noise, no normal
+        bool pingPong = false;
+        ImageData backNoiseImage{};
+        // Which of the two images created at initialization is noiseImage, flips on every swap
+        uint32_t frontIndex = 0;
+        // The first recompute writes the front image directly, there is no older result to draw in the meantime
+        [[nodiscard]] bool isFrontWritten() const { return !pingPong || m_FrontWritten; }
+
         bool includeNormal = false;
 
+        // Toroidal objects hold a window of the noise lattice that follows the offset, with lattice texel A stored at A mod size.
+        // An offset change only writes the texels it exposes, readers add getSampleOrigin() to their uv and sample with REPEAT.
+        // Ping-ponged objects are never toroidal, their back image misses every update written to the front one
+        bool toroidal = false;
+        // Added to the uv of every sample, zero for objects that are not toroidal
+        [[nodiscard]] glm::vec2 getSampleOrigin() const { return toroidal ? noisePushConstants.offset : glm::vec2(0.f); }
+
+        // Objects with a normal map are terrains, their heights and normals are stored through terrain_encoding.glsl in this format
+        TerrainFormat terrainFormat = TerrainFormat::FULL;
+        // TERRAIN_ENCODING_* of terrain_encoding.glsl
+        [[nodiscard]] uint32_t getEncoding() const;
+        // Upper bound of the gradient of the stored noise, per unit of image uv
+        [[nodiscard]] float getMaxGradient() const;
+
+        // Chunks of a toroidal object are saved to a GPU pool when they leave the window,
+        // the texels a window update needs are copied back from it instead of dispatched when the same inputs generated them
+        struct ChunkPool
+        {
+            NoiseChunkCache cache{};
+            ResourceID image = UINT32_MAX;
+            uint32_t columns = 0;
+            uint32_t texelSize = 0;
+
+            // Chunk pieces of the last update
+            uint32_t lastCopied = 0;
+            uint32_t lastDispatched = 0;
+            uint32_t lastSaved = 0;
+        };
+        ChunkPool noiseChunks{};
+        ChunkPool normalChunks{};
+        // Can be turned off at runtime to compare, the pools are kept
+        bool useChunkCache = true;
+        [[nodiscard]] bool isChunkCached() const { return useChunkCache && noiseChunks.image != UINT32_MAX; }
+
         bool noiseHotReload = true;
         bool noiseNeedsRebuild = true;
         bool normalHotReload = true;
@@ -55,13 +141,20 @@ public:
         glm::uvec2 size{};
         
         ResourceID computeNoiseDescriptorSetID = UINT32_MAX;
+        ResourceID backComputeNoiseDescriptorSetID = UINT32_MAX;
         ResourceID computeNormalDescriptorSetID = UINT32_MAX;
 
         VkDescriptorSet imguiHeightmapDescriptorSet = VK_NULL_HANDLE;
         VkDescriptorSet imguiNormalmapDescriptorSet = VK_NULL_HANDLE;
 
-        void initialize(uint32_t p_Size, Engine& p_Engine, bool p_IncludeNormal);
+        void initialize(std::string_view p_Name, uint32_t p_Size, Engine& p_Engine, bool p_IncludeNormal, bool p_PingPong = false, bool p_Toroidal = false,
+                        TerrainFormat p_TerrainFormat = TerrainFormat::FULL);
         void initializeImgui();
+        // Creates the chunk pools of a toroidal object, nothing for any other
+        void createChunkCache();
+
+        // Makes the last written back image the one sampled, call once per frame before recording anything that reads it
+        void swapPingPong();
 
         [[nodiscard]] bool isNoiseDirty() const { return noiseNeedsRebuild; }
         [[nodiscard]] bool isNormalDirty() const { return normalNeedsRebuild && includeNormal; }
@@ -82,10 +175,53 @@ public:
         void overridePushConstant(const NoisePushConstantData& p_NewPush) { noisePushConstants = p_NewPush; }
 
     private:
+        struct WindowUpdate
+        {
+            std::vector<RegionPushConstantData> regions;
+            glm::ivec2 origin{};
+            // The previous window still holds what the same inputs generated, its chunks can be saved before they are written over
+            bool keepsPrevious = false;
+            glm::ivec2 previousOrigin{};
+        };
+
+        void createNoiseImage(ImageData& p_Image, ResourceID& p_DescriptorSetID, uint32_t p_Size) const;
+        void createChunkPool(ChunkPool& p_Pool, VkFormat p_Format, uint32_t p_TexelSize) const;
+        void drawChunkPoolImgui(std::string_view p_Name, const ChunkPool& p_Pool) const;
+        // Memory and fetch sizes of every terrain format at this object's size
+        void drawTerrainFormatImgui() const;
+
+        // First lattice texel of the window the current offset needs
+        [[nodiscard]] glm::ivec2 getWindowOrigin() const;
+        // Rectangles of the window at p_Origin the window at p_OldOrigin does not cover, grown by p_Margin texels into the old window
+        [[nodiscard]] std::vector<RegionPushConstantData> getExposedRegions(glm::ivec2 p_OldOrigin, glm::ivec2 p_Origin, int32_t p_Margin) const;
+        [[nodiscard]] RegionPushConstantData getFullRegion(glm::ivec2 p_Origin) const;
+        // Moves the written window to the current offset and returns the texels to write for it.
+        // The whole window when any other input changed or a rebuild was asked for from the UI
+        [[nodiscard]] WindowUpdate advanceNoiseWindow();
+        [[nodiscard]] WindowUpdate advanceNormalWindow();
+        [[nodiscard]] WindowUpdate getFullUpdate() const;
+        // Normals this far inside the window's edge read heights wrapped in from its other side
+        [[nodiscard]] int32_t getNormalMargin() const;
+
         NoiseEngine* m_NoiseEngine = nullptr;
+        bool m_BackWritten = false;
+        bool m_FrontWritten = false;
 
         bool m_ShowWindow = false;
 
+        // Window and inputs the toroidal noise and normal images were last written with
+        bool m_NoiseWindowValid = false;
+        bool m_NoiseRebuildRequested = false;
+        glm::ivec2 m_NoiseWindowOrigin{};
+        NoisePushConstantData m_NoiseWindowInputs{};
+        bool m_NormalWindowValid = false;
+        bool m_NormalRebuildRequested = false;
+        glm::ivec2 m_NormalWindowOrigin{};
+        NormalPushConstantData m_NormalWindowInputs{};
+
+        uint32_t m_DebugNoiseTexels = 0;
+        uint32_t m_DebugNormalTexels = 0;
+
         glm::vec2 m_NoiseOffset = { 0.0f, 0.0f };
         bool m_WAnimated = false;
         float m_WSpeed = 0.1f;
@@ -118,10 +254,15 @@ public:
 private:
     bool recalculateNoise(VulkanCommandBuffer& p_CmdBuffer, NoiseObject& p_Object) const;
     bool recalculateNormal(VulkanCommandBuffer& p_CmdBuffer, NoiseObject& p_Object) const;
+    // Writes the regions of an update to p_Image with the bound pipeline, or with copies from the pool for chunks it holds.
+    // Chunks of the previous window, less p_SaveMargin texels along its edge, are saved to the pool first. Returns the texels dispatched
+    uint32_t cmdWriteRegions(VulkanCommandBuffer& p_CmdBuffer, const NoiseObject& p_Object, NoiseObject::ChunkPool& p_Pool, ResourceID p_Image,
+                             const NoiseObject::WindowUpdate& p_Update, int32_t p_SaveMargin, uint64_t p_Inputs, ResourceID p_PipelineLayoutID, uint32_t p_RegionOffset) const;
     Engine& m_Engine;
 
-    ResourceID m_ComputeNoisePipelineID = UINT32_MAX;
-    ResourceID m_ComputeNormalPipelineID = UINT32_MAX;
+    // Per terrain format, only FULL and the format of the heightmap are created
+    std::array<ResourceID, s_TerrainFormatCount> m_ComputeNoisePipelineIDs{ UINT32_MAX, UINT32_MAX, UINT32_MAX };
+    std::array<ResourceID, s_TerrainFormatCount> m_ComputeNormalPipelineIDs{ UINT32_MAX, UINT32_MAX, UINT32_MAX };
     ResourceID m_ComputeNoisePipelineLayoutID = UINT32_MAX;
     ResourceID m_ComputeNormalPipelineLayoutID = UINT32_MAX;
     ResourceID m_ComputeNoiseDescriptorSetLayoutID = UINT32_MAX;
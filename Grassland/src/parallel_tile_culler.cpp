@@ -0,0 +1,141 @@
+#include "parallel_tile_culler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <glm/gtc/constants.hpp>
+
+#include "camera.hpp"
+#include "cpu_profiler.hpp"
+#include "worker_pool.hpp"
+
+void ParallelTileCuller::cull(WorkerPool& p_Pool, const glm::vec4* p_Planes, const TileQuadtree::GridLayout& p_Layout, const std::vector<uint32_t>& p_GlobalTiles, const std::array<uint32_t, 4>& p_LODOffsets)
+{
+    const uint32_t l_TileCount = static_cast<uint32_t>(p_GlobalTiles.size());
+    if (m_Bounds.size() != l_TileCount)
+    {
+        m_Bounds.resize(l_TileCount);
+        m_VisibleMask.assign((m_Bounds.paddedSize() + 63) / 64, 0);
+    }
+
+    m_ChunkCount = (l_TileCount + s_ChunkSize - 1) / s_ChunkSize;
+    if (m_Chunks.size() < m_ChunkCount)
+        m_Chunks.resize(m_ChunkCount);
+
+    const FrustumCuller::Path l_Path = FrustumCuller::getBestPath();
+    p_Pool.parallelFor(m_ChunkCount, [&](const uint32_t p_Chunk, uint32_t)
+    {
+        CPU_PROFILE_ZONE("Cull tile chunk");
+        const uint32_t l_First = p_Chunk * s_ChunkSize;
+        const uint32_t l_End = std::min(l_First + s_ChunkSize, l_TileCount);
+
+        for (uint32_t l_TileIdx = l_First; l_TileIdx < l_End; l_TileIdx++)
+        {
+            const uint32_t l_X = p_GlobalTiles[l_TileIdx] % p_Layout.gridSize;
+            const uint32_t l_Y = p_GlobalTiles[l_TileIdx] / p_Layout.gridSize;
+            m_Bounds.set(l_TileIdx, p_Layout.getTileMin(l_X, l_Y), p_Layout.getTileMax(l_X, l_Y));
+        }
+        FrustumCuller::cullBoxRange(p_Planes, m_Bounds, m_VisibleMask.data(), l_First, l_End - l_First, l_Path);
+
+        Chunk& l_Chunk = m_Chunks[p_Chunk];
+        l_Chunk.tiles.clear();
+        l_Chunk.counts.fill(0);
+        for (uint32_t l_TileIdx = l_First; l_TileIdx < l_End; l_TileIdx++)
+        {
+            if (!FrustumCuller::isVisible(m_VisibleMask, l_TileIdx))
+                continue;
+
+            const uint32_t l_LOD = (l_TileIdx >= p_LODOffsets[1]) + (l_TileIdx >= p_LODOffsets[2]) + (l_TileIdx >= p_LODOffsets[3]);
+            l_Chunk.tiles.push_back({ p_GlobalTiles[l_TileIdx], l_TileIdx - p_LODOffsets[l_LOD] });
+            l_Chunk.counts[l_LOD]++;
+        }
+    });
+}
+
+bool ParallelTileCuller::runBenchmark(const uint32_t p_Iterations)
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float l_TileSize = 20.f;
+    constexpr float l_HeightScale = 15.f;
+    constexpr float l_Margin = 3.f;
+    constexpr std::array<uint32_t, 4> l_GridSizes{ 31, 63, 127, 255 };
+    constexpr uint32_t l_PoseCount = 16;
+
+    std::vector<uint32_t> l_ThreadCounts;
+    for (uint32_t l_Threads = 1; l_Threads < WorkerPool::getMaxThreadCount(); l_Threads *= 2)
+        l_ThreadCounts.push_back(l_Threads);
+    l_ThreadCounts.push_back(WorkerPool::getMaxThreadCount());
+
+    WorkerPool l_Pool;
+    ParallelTileCuller l_Culler;
+    bool l_AllMatch = true;
+    std::printf("Parallel tile culling benchmark, %u iterations over %u camera poses, up to %u threads\n", p_Iterations, l_PoseCount, WorkerPool::getMaxThreadCount());
+    std::printf("%8s %8s %14s %10s\n", "grid", "threads", "per cull us", "speedup");
+
+    auto l_Flatten = [&l_Culler]
+    {
+        std::vector<uint64_t> l_Tiles;
+        for (uint32_t i = 0; i < l_Culler.getChunkCount(); i++)
+            for (const VisibleTile& l_Tile : l_Culler.getChunk(i).tiles)
+                l_Tiles.push_back(static_cast<uint64_t>(l_Tile.globalTileIndex) << 32 | l_Tile.tileIndex);
+        return l_Tiles;
+    };
+
+    for (const uint32_t l_GridSize : l_GridSizes)
+    {
+        const TileQuadtree::GridLayout l_Layout{
+            .gridSize = l_GridSize,
+            .tileSize = l_TileSize,
+            .shift = glm::vec2((l_GridSize / 2) * l_TileSize),
+            .center = glm::vec2(0.f),
+            .minY = -l_HeightScale,
+            .maxY = 0.0f,
+            .margin = l_Margin
+        };
+
+        // Row order with made up LOD splits, the split points only change how the counts are bucketed
+        const uint32_t l_TileCount = l_GridSize * l_GridSize;
+        std::vector<uint32_t> l_GlobalTiles(l_TileCount);
+        for (uint32_t i = 0; i < l_TileCount; i++)
+            l_GlobalTiles[i] = i;
+        const std::array<uint32_t, 4> l_LODOffsets{ 0, l_TileCount / 8, l_TileCount / 4, l_TileCount / 2 };
+
+        std::vector<std::vector<uint64_t>> l_References(l_PoseCount);
+        double l_SingleThreadNs = 0.0;
+        for (const uint32_t l_Threads : l_ThreadCounts)
+        {
+            l_Pool.setThreadCount(l_Threads);
+
+            double l_Nanoseconds = 0.0;
+            for (uint32_t l_Pose = 0; l_Pose < l_PoseCount; l_Pose++)
+            {
+                const float l_Angle = static_cast<float>(l_Pose) / l_PoseCount * glm::two_pi<float>();
+                Camera l_Camera{ glm::vec3{ 0.f, -20.f, 0.f }, glm::normalize(glm::vec3{ glm::cos(l_Angle), 0.3f, glm::sin(l_Angle) }) };
+                const glm::vec4* l_Planes = l_Camera.getFrustumPlanes();
+
+                const Clock::time_point l_Start = Clock::now();
+                for (uint32_t l_Iteration = 0; l_Iteration < p_Iterations; l_Iteration++)
+                    l_Culler.cull(l_Pool, l_Planes, l_Layout, l_GlobalTiles, l_LODOffsets);
+                l_Nanoseconds += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - l_Start).count());
+
+                if (l_Threads == 1)
+                    l_References[l_Pose] = l_Flatten();
+                else if (l_Flatten() != l_References[l_Pose])
+                {
+                    std::printf("Mismatch: %u threads on a %ux%u grid, pose %u\n", l_Threads, l_GridSize, l_GridSize, l_Pose);
+                    l_AllMatch = false;
+                }
+            }
+
+            if (l_Threads == 1)
+                l_SingleThreadNs = l_Nanoseconds;
+            const double l_Runs = static_cast<double>(p_Iterations) * l_PoseCount;
+            std::printf("%5ux%-3u %8u %14.2f %9.2fx\n", l_GridSize, l_GridSize, l_Threads, l_Nanoseconds / l_Runs / 1000.0, l_SingleThreadNs / l_Nanoseconds);
+        }
+    }
+
+    std::puts(l_AllMatch ? "Every thread count produced the same tiles" : "Some thread counts did NOT produce the same tiles");
+    return l_AllMatch;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum_culler.hpp"
+#include "tile_quadtree.hpp"
+
+class WorkerPool;
+
+// Per tile frustum culling split in fixed size chunks of the pre-cull tile list. Every chunk builds the bounds of its
+// tiles, culls them and compacts the visible ones into its own list, and the lists are read back in chunk order, so
+// the result is the same for any thread count or scheduling
+class ParallelTileCuller
+{
+public:
+    // Multiple of 64 so chunks never share a word of the visibility mask
+    static constexpr uint32_t s_ChunkSize = 256;
+
+    struct VisibleTile
+    {
+        uint32_t globalTileIndex;
+        uint32_t tileIndex;
+    };
+
+    struct Chunk
+    {
+        std::vector<VisibleTile> tiles{};
+        std::array<uint32_t, 4> counts{};
+    };
+
+    // p_GlobalTiles is the pre-cull tile list in LOD order and p_LODOffsets the pre-cull index each LOD starts at
+    void cull(WorkerPool& p_Pool, const glm::vec4* p_Planes, const TileQuadtree::GridLayout& p_Layout, const std::vector<uint32_t>& p_GlobalTiles, const std::array<uint32_t, 4>& p_LODOffsets);
+
+    // Only the first getChunkCount() chunks belong to the last cull
+    [[nodiscard]] uint32_t getChunkCount() const { return m_ChunkCount; }
+    [[nodiscard]] const Chunk& getChunk(const uint32_t p_Index) const { return m_Chunks[p_Index]; }
+
+    // Times cull on a few grid sizes from one thread up to every hardware thread, checking that all thread counts
+    // produce the same tile list. Returns false on any mismatch
+    static bool runBenchmark(uint32_t p_Iterations);
+
+private:
+    FrustumCuller::BoxBatch m_Bounds{};
+    std::vector<uint64_t> m_VisibleMask{};
+    std::vector<Chunk> m_Chunks{};
+    uint32_t m_ChunkCount = 0;
+};
@@ -0,0 +1,159 @@
+#include "pipeline_statistics.hpp"
+
+#include <stdexcept>
+
+#include <imgui.h>
+
+#include "vulkan_device.hpp"
+
+static constexpr VkQueryPipelineStatisticFlags s_GraphicsStatistics =
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT;
+
+static constexpr std::array<const char*, PipelineStatistics::GRAPHICS_PASS_COUNT> s_GraphicsPassNames{
+    "Skybox", "Terrain", "Grass LOD 0", "Grass LOD 1", "Grass LOD 2", "Grass LOD 3", "Fog"
+};
+
+static constexpr std::array<const char*, PipelineStatistics::COMPUTE_PASS_COUNT> s_ComputePassNames{
+    "Grass compute"
+};
+
+void PipelineStatistics::initialize(const VkDevice p_Device)
+{
+    m_Device = p_Device;
+
+    const VkQueryPoolCreateInfo l_GraphicsInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = GRAPHICS_PASS_COUNT * s_FrameSlots,
+        .pipelineStatistics = s_GraphicsStatistics
+    };
+    if (vkCreateQueryPool(m_Device, &l_GraphicsInfo, nullptr, &m_GraphicsPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create graphics pipeline statistics query pool");
+
+    const VkQueryPoolCreateInfo l_ComputeInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = COMPUTE_PASS_COUNT * s_FrameSlots,
+        .pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT
+    };
+    if (vkCreateQueryPool(m_Device, &l_ComputeInfo, nullptr, &m_ComputePool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create compute pipeline statistics query pool");
+}
+
+void PipelineStatistics::free()
+{
+    if (m_GraphicsPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(m_Device, m_GraphicsPool, nullptr);
+    if (m_ComputePool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(m_Device, m_ComputePool, nullptr);
+    m_GraphicsPool = VK_NULL_HANDLE;
+    m_ComputePool = VK_NULL_HANDLE;
+}
+
+void PipelineStatistics::beginFrame()
+{
+    m_CurrentSlot = (m_CurrentSlot + 1) % s_FrameSlots;
+    m_Slots[m_CurrentSlot] = {};
+}
+
+void PipelineStatistics::collectFrame(const uint32_t p_FramesAgo)
+{
+    if (!isEnabled())
+        return;
+
+    const uint32_t l_Slot = (m_CurrentSlot + s_FrameSlots - p_FramesAgo) % s_FrameSlots;
+    FrameSlot& l_FrameSlot = m_Slots[l_Slot];
+
+    for (uint32_t i = 0; i < GRAPHICS_PASS_COUNT; i++)
+    {
+        if (!l_FrameSlot.graphicsRecorded[i])
+            continue;
+
+        GraphicsResult l_Result;
+        if (vkGetQueryPoolResults(m_Device, m_GraphicsPool, getGraphicsQuery(l_Slot, static_cast<GraphicsPass>(i)), 1, sizeof(GraphicsResult), &l_Result, sizeof(GraphicsResult), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            m_GraphicsResults[i] = l_Result;
+    }
+
+    for (uint32_t i = 0; i < COMPUTE_PASS_COUNT; i++)
+    {
+        if (!l_FrameSlot.computeRecorded[i])
+            continue;
+
+        uint64_t l_Result;
+        if (vkGetQueryPoolResults(m_Device, m_ComputePool, getComputeQuery(l_Slot, static_cast<ComputePass>(i)), 1, sizeof(uint64_t), &l_Result, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            m_ComputeResults[i] = l_Result;
+    }
+
+    l_FrameSlot = {};
+}
+
+void PipelineStatistics::cmdResetGraphics(const VulkanCommandBuffer& p_CmdBuffer) const
+{
+    if (!isEnabled())
+        return;
+
+    vkCmdResetQueryPool(*p_CmdBuffer, m_GraphicsPool, getGraphicsQuery(m_CurrentSlot, SKYBOX), GRAPHICS_PASS_COUNT);
+}
+
+void PipelineStatistics::cmdBeginGraphics(const VulkanCommandBuffer& p_CmdBuffer, const GraphicsPass p_Pass)
+{
+    if (!isEnabled())
+        return;
+
+    vkCmdBeginQuery(*p_CmdBuffer, m_GraphicsPool, getGraphicsQuery(m_CurrentSlot, p_Pass), 0);
+    m_Slots[m_CurrentSlot].graphicsRecorded[p_Pass] = true;
+}
+
+void PipelineStatistics::cmdEndGraphics(const VulkanCommandBuffer& p_CmdBuffer, const GraphicsPass p_Pass) const
+{
+    if (!isEnabled())
+        return;
+
+    vkCmdEndQuery(*p_CmdBuffer, m_GraphicsPool, getGraphicsQuery(m_CurrentSlot, p_Pass));
+}
+
+void PipelineStatistics::cmdBeginCompute(const VulkanCommandBuffer& p_CmdBuffer, const ComputePass p_Pass)
+{
+    if (!isEnabled())
+        return;
+
+    const uint32_t l_Query = getComputeQuery(m_CurrentSlot, p_Pass);
+    vkCmdResetQueryPool(*p_CmdBuffer, m_ComputePool, l_Query, 1);
+    vkCmdBeginQuery(*p_CmdBuffer, m_ComputePool, l_Query, 0);
+    m_Slots[m_CurrentSlot].computeRecorded[p_Pass] = true;
+}
+
+void PipelineStatistics::cmdEndCompute(const VulkanCommandBuffer& p_CmdBuffer, const ComputePass p_Pass) const
+{
+    if (!isEnabled())
+        return;
+
+    vkCmdEndQuery(*p_CmdBuffer, m_ComputePool, getComputeQuery(m_CurrentSlot, p_Pass));
+}
+
+void PipelineStatistics::drawImgui() const
+{
+    if (!isEnabled())
+    {
+        ImGui::Text("Pipeline statistics queries not supported");
+        return;
+    }
+
+    ImGui::Text("%-14s %12s %12s %12s %12s %12s", "Pass", "VS", "Clip prims", "FS", "TCS patches", "TES");
+    for (uint32_t i = 0; i < GRAPHICS_PASS_COUNT; i++)
+    {
+        const GraphicsResult& l_Result = m_GraphicsResults[i];
+        ImGui::Text("%-14s %12llu %12llu %12llu %12llu %12llu", s_GraphicsPassNames[i],
+            static_cast<unsigned long long>(l_Result.vertexInvocations),
+            static_cast<unsigned long long>(l_Result.clippingPrimitives),
+            static_cast<unsigned long long>(l_Result.fragmentInvocations),
+            static_cast<unsigned long long>(l_Result.tessControlPatches),
+            static_cast<unsigned long long>(l_Result.tessEvaluationInvocations));
+    }
+    for (uint32_t i = 0; i < COMPUTE_PASS_COUNT; i++)
+        ImGui::Text("%-14s %12llu CS invocations", s_ComputePassNames[i], static_cast<unsigned long long>(m_ComputeResults[i]));
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include <Volk/volk.h>
+
+class VulkanCommandBuffer;
+
+// VK_QUERY_TYPE_PIPELINE_STATISTICS queries for every render and compute pass. Graphics and compute passes use
+// separate pools because compute queues may only record the compute invocation counter
+class PipelineStatistics
+{
+public:
+    enum GraphicsPass : uint8_t
+    {
+        SKYBOX,
+        TERRAIN,
+        GRASS_LOD0,
+        GRASS_LOD1,
+        GRASS_LOD2,
+        GRASS_LOD3,
+        FOG,
+        GRAPHICS_PASS_COUNT
+    };
+
+    enum ComputePass : uint8_t
+    {
+        GRASS_COMPUTE,
+        COMPUTE_PASS_COUNT
+    };
+
+    // Ordered like the statistic bits, which is the order Vulkan writes them in
+    struct GraphicsResult
+    {
+        uint64_t vertexInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t fragmentInvocations = 0;
+        uint64_t tessControlPatches = 0;
+        uint64_t tessEvaluationInvocations = 0;
+    };
+
+    // One more than the most frames the engine keeps in flight
+    static constexpr uint32_t s_FrameSlots = 4;
+
+    void initialize(VkDevice p_Device);
+    void free();
+
+    [[nodiscard]] bool isEnabled() const { return m_GraphicsPool != VK_NULL_HANDLE; }
+
+    void beginFrame();
+    // Reads back the passes of the frame begun p_FramesAgo frames before the current one, below s_FrameSlots
+    void collectFrame(uint32_t p_FramesAgo);
+
+    // Queries can't be reset inside a render pass, this resets every graphics query of the frame beforehand
+    void cmdResetGraphics(const VulkanCommandBuffer& p_CmdBuffer) const;
+    void cmdBeginGraphics(const VulkanCommandBuffer& p_CmdBuffer, GraphicsPass p_Pass);
+    void cmdEndGraphics(const VulkanCommandBuffer& p_CmdBuffer, GraphicsPass p_Pass) const;
+
+    void cmdBeginCompute(const VulkanCommandBuffer& p_CmdBuffer, ComputePass p_Pass);
+    void cmdEndCompute(const VulkanCommandBuffer& p_CmdBuffer, ComputePass p_Pass) const;
+
+    // Results hold the last frame each pass was recorded in, passes that don't run every frame keep their old values
+    [[nodiscard]] const GraphicsResult& getGraphicsResult(const GraphicsPass p_Pass) const { return m_GraphicsResults[p_Pass]; }
+    [[nodiscard]] uint64_t getComputeInvocations(const ComputePass p_Pass) const { return m_ComputeResults[p_Pass]; }
+
+    void drawImgui() const;
+
+private:
+    struct FrameSlot
+    {
+        std::array<bool, GRAPHICS_PASS_COUNT> graphicsRecorded{};
+        std::array<bool, COMPUTE_PASS_COUNT> computeRecorded{};
+    };
+
+    [[nodiscard]] uint32_t getGraphicsQuery(uint32_t p_Slot, GraphicsPass p_Pass) const { return p_Slot * GRAPHICS_PASS_COUNT + p_Pass; }
+    [[nodiscard]] uint32_t getComputeQuery(uint32_t p_Slot, ComputePass p_Pass) const { return p_Slot * COMPUTE_PASS_COUNT + p_Pass; }
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkQueryPool m_GraphicsPool = VK_NULL_HANDLE;
+    VkQueryPool m_ComputePool = VK_NULL_HANDLE;
+
+    std::array<FrameSlot, s_FrameSlots> m_Slots{};
+    uint32_t m_CurrentSlot = 0;
+
+    std::array<GraphicsResult, GRAPHICS_PASS_COUNT> m_GraphicsResults{};
+    std::array<uint64_t, COMPUTE_PASS_COUNT> m_ComputeResults{};
+};
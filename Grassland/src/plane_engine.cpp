@@ -23,12 +23,23 @@ void PlaneEngine::update(const glm::vec2 p_CamTile)
     m_PushConstants.mvp = m_Engine.getCamera().getVPMatrix();
     m_PushConstants.cameraPos = m_Engine.getCamera().getPosition();
     m_PushConstants.cameraTile = p_CamTile;
+    m_PushConstants.heightmapOrigin = m_Engine.getHeightmap().getSampleOrigin();
+    m_PushConstants.normalEncoding = m_Engine.getHeightmap().getEncoding();
     m_PushConstants.lightDir = m_Engine.getLightDir();
 }
 
+void PlaneEngine::prepareRender()
+{
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    m_RenderHandles.extent = m_Engine.getRenderExtent();
+    m_RenderHandles.pipeline = *l_Device.getPipeline(m_Wireframe ? m_TessellationPipelineWFID : m_TessellationPipelineID);
+    m_RenderHandles.pipelineLayout = *l_Device.getPipelineLayout(m_TessellationPipelineLayoutID);
+    m_RenderHandles.descriptorSet = *l_Device.getDescriptorSet(m_TessellationDescriptorSetID);
+}
+
 void PlaneEngine::render(const VulkanCommandBuffer& p_CmdBuffer) const
 {
-    const VkExtent2D& extent = m_Engine.getSwapchain().getExtent();
+    const VkExtent2D extent = m_RenderHandles.extent;
 
     VkViewport viewport;
     viewport.x = 0.0f;
@@ -42,15 +53,15 @@ void PlaneEngine::render(const VulkanCommandBuffer& p_CmdBuffer) const
     scissor.offset = { 0, 0 };
     scissor.extent = extent;
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_Wireframe ? m_TessellationPipelineWFID : m_TessellationPipelineID);
+    vkCmdBindPipeline(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RenderHandles.pipeline);
     p_CmdBuffer.cmdSetViewport(viewport);
     p_CmdBuffer.cmdSetScissor(scissor);
     
-    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, m_TessellationPipelineLayoutID, m_TessellationDescriptorSetID);
-    p_CmdBuffer.cmdPushConstant(m_TessellationPipelineLayoutID, VK_SHADER_STAGE_VERTEX_BIT, PushConstantData::getVertexShaderOffset(), PushConstantData::getVertexShaderSize(), m_PushConstants.getVertexShaderData());
-    p_CmdBuffer.cmdPushConstant(m_TessellationPipelineLayoutID, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, PushConstantData::getTessellationControlShaderOffset(), PushConstantData::getTessellationControlShaderSize(), m_PushConstants.getTessellationControlShaderData());
-    p_CmdBuffer.cmdPushConstant(m_TessellationPipelineLayoutID, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, PushConstantData::getTessellationEvaluationShaderOffset(), PushConstantData::getTessellationEvaluationShaderSize(), m_PushConstants.getTessellationEvaluationShaderData());
-    p_CmdBuffer.cmdPushConstant(m_TessellationPipelineLayoutID, VK_SHADER_STAGE_FRAGMENT_BIT, PushConstantData::getFragmentShaderOffset(), PushConstantData::getFragmentShaderSize(), m_PushConstants.getFragmentShaderData());
+    vkCmdBindDescriptorSets(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RenderHandles.pipelineLayout, 0, 1, &m_RenderHandles.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, PushConstantData::getVertexShaderOffset(), PushConstantData::getVertexShaderSize(), m_PushConstants.getVertexShaderData());
+    vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, PushConstantData::getTessellationControlShaderOffset(), PushConstantData::getTessellationControlShaderSize(), m_PushConstants.getTessellationControlShaderData());
+    vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, PushConstantData::getTessellationEvaluationShaderOffset(), PushConstantData::getTessellationEvaluationShaderSize(), m_PushConstants.getTessellationEvaluationShaderData());
+    vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, PushConstantData::getFragmentShaderOffset(), PushConstantData::getFragmentShaderSize(), m_PushConstants.getFragmentShaderData());
     
     p_CmdBuffer.cmdDraw(m_PushConstants.gridSize * m_PushConstants.gridSize * 4, 0);
 }
@@ -23,6 +23,10 @@ public:
         alignas(4)  float tessSlope = 0.05f;
         alignas(4)  float heightScale = 15.f;
         alignas(4)  float heightOffset = 0.5f;
+        // NoiseObject::getEncoding of the heightmap
+        alignas(4)  uint32_t normalEncoding = 0;
+        // NoiseObject::getSampleOrigin of the heightmap, fills the padding before the matrix
+        alignas(8)  glm::vec2 heightmapOrigin{ 0.f };
         alignas(16) glm::mat4 mvp;
         alignas(16) glm::vec3 color = { 0.018f, 0.113f, 0.0f };
         alignas(16) glm::vec3 lightDir;
@@ -50,6 +54,8 @@ public:
     void initializeImgui();
 
     void update(glm::vec2 p_CamTile);
+    // Looks up what render needs from the device, on the main thread before the render tasks fan out
+    void prepareRender();
     void render(const VulkanCommandBuffer& p_CmdBuffer) const;
 
     void cleanupImgui() const {}
@@ -75,6 +81,16 @@ private:
     ResourceID m_TessellationDescriptorSetLayoutID = UINT32_MAX;
     ResourceID m_TessellationDescriptorSetID = UINT32_MAX;
 
+    // Device handles of the draw, render runs on a worker thread and never looks them up itself
+    struct RenderHandles
+    {
+        VkExtent2D extent{};
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+    RenderHandles m_RenderHandles{};
+
 private:
     PushConstantData m_PushConstants{};
 
@@ -104,9 +104,18 @@ void PPFogEngine::initialize()
     }
 }
 
+void PPFogEngine::prepareRender()
+{
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    m_RenderHandles.extent = m_Engine.getRenderExtent();
+    m_RenderHandles.pipeline = *l_Device.getPipeline(m_PPFogPipelineID);
+    m_RenderHandles.pipelineLayout = *l_Device.getPipelineLayout(m_PPFogPipelineLayoutID);
+    m_RenderHandles.descriptorSet = *l_Device.getDescriptorSet(m_PPFogDescriptorSetID);
+}
+
 void PPFogEngine::render(const VulkanCommandBuffer& p_CmdBuffer) const
 {
-    const VkExtent2D& extent = m_Engine.getSwapchain().getExtent();
+    const VkExtent2D extent = m_RenderHandles.extent;
 
     VkViewport viewport;
     viewport.x = 0.0f;
@@ -120,12 +129,12 @@ void PPFogEngine::render(const VulkanCommandBuffer& p_CmdBuffer) const
     scissor.offset = { 0, 0 };
     scissor.extent = extent;
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_PPFogPipelineID);
+    vkCmdBindPipeline(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RenderHandles.pipeline);
     p_CmdBuffer.cmdSetViewport(viewport);
     p_CmdBuffer.cmdSetScissor(scissor);
 
-    p_CmdBuffer.cmdBindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, m_PPFogPipelineLayoutID, m_PPFogDescriptorSetID);
-    p_CmdBuffer.cmdPushConstant(m_PPFogPipelineLayoutID, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &m_PushConstants);
+    vkCmdBindDescriptorSets(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RenderHandles.pipelineLayout, 0, 1, &m_RenderHandles.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &m_PushConstants);
     p_CmdBuffer.cmdDraw(3, 0);
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <Volk/volk.h>
 
 #include "utils/identifiable.hpp"
 class VulkanCommandBuffer;
@@ -23,6 +24,8 @@ public:
     void initialize();
     void initializeImgui() const {}
 
+    // Looks up what render needs from the device, on the main thread before the render tasks fan out
+    void prepareRender();
     void render(const VulkanCommandBuffer& p_CmdBuffer) const;
 
     void drawImgui();
@@ -39,5 +42,15 @@ private:
     ResourceID m_PPFogPipelineLayoutID = UINT32_MAX;
     ResourceID m_PPFogDescriptorSetLayoutID = UINT32_MAX;
     ResourceID m_PPFogDescriptorSetID = UINT32_MAX;
+
+    // Device handles of the draw, render runs on a worker thread and never looks them up itself
+    struct RenderHandles
+    {
+        VkExtent2D extent{};
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+    RenderHandles m_RenderHandles{};
 };
 
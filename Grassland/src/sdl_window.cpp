@@ -28,6 +28,14 @@ SDLWindow::WindowSize::WindowSize(const Sint32 p_Width, const Sint32 p_Height)
 
 SDLWindow::SDLWindow(const std::string_view p_Name, const int p_Width, const int p_Height, const int p_Top, const int p_Left, const uint32_t p_Flags)
 {
+    open(p_Name, p_Width, p_Height, p_Top, p_Left, p_Flags);
+}
+
+void SDLWindow::open(const std::string_view p_Name, const int p_Width, const int p_Height, const int p_Top, const int p_Left, const uint32_t p_Flags)
+{
+    if (m_SDLHandle != nullptr)
+        throw std::runtime_error("Window already open");
+
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
     m_SDLHandle = SDL_CreateWindow(p_Name.data(), p_Top, p_Left, p_Width, p_Height, p_Flags | SDL_WINDOW_VULKAN);
 
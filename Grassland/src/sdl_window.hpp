@@ -26,6 +26,8 @@ public:
 	SDLWindow() = default;
 	SDLWindow(std::string_view p_Name, int p_Width, int p_Height, int p_Top = SDL_WINDOWPOS_CENTERED, int p_Left = SDL_WINDOWPOS_CENTERED, uint32_t p_Flags = SDL_WINDOW_SHOWN | SDL_WINDOW_MAXIMIZED | SDL_WINDOW_RESIZABLE);
 
+	void open(std::string_view p_Name, int p_Width, int p_Height, int p_Top = SDL_WINDOWPOS_CENTERED, int p_Left = SDL_WINDOWPOS_CENTERED, uint32_t p_Flags = SDL_WINDOW_SHOWN | SDL_WINDOW_MAXIMIZED | SDL_WINDOW_RESIZABLE);
+	[[nodiscard]] bool isOpen() const { return m_SDLHandle != nullptr; }
 
 	[[nodiscard]] bool shouldClose() const;
     [[nodiscard]] uint32_t getRequiredVulkanExtensionCount() const;
@@ -50,9 +50,17 @@ void SkyboxEngine::initialize()
     m_SkyboxPipelineID = l_Device.createPipeline(l_SkyboxBuilder, m_SkyboxPipelineLayoutID, m_Engine.getRenderPassID(), 0);
 }
 
+void SkyboxEngine::prepareRender()
+{
+    VulkanDevice& l_Device = m_Engine.getDevice();
+    m_RenderHandles.extent = m_Engine.getRenderExtent();
+    m_RenderHandles.pipeline = *l_Device.getPipeline(m_SkyboxPipelineID);
+    m_RenderHandles.pipelineLayout = *l_Device.getPipelineLayout(m_SkyboxPipelineLayoutID);
+}
+
 void SkyboxEngine::render(const VulkanCommandBuffer& p_CmdBuffer) const
 {
-    const VkExtent2D& extent = m_Engine.getSwapchain().getExtent();
+    const VkExtent2D extent = m_RenderHandles.extent;
 
     VkViewport viewport;
     viewport.x = 0.0f;
@@ -66,11 +74,11 @@ void SkyboxEngine::render(const VulkanCommandBuffer& p_CmdBuffer) const
     scissor.offset = { 0, 0 };
     scissor.extent = extent;
 
-    p_CmdBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_SkyboxPipelineID);
+    vkCmdBindPipeline(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_RenderHandles.pipeline);
     p_CmdBuffer.cmdSetViewport(viewport);
     p_CmdBuffer.cmdSetScissor(scissor);
 
-    p_CmdBuffer.cmdPushConstant(m_SkyboxPipelineLayoutID, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &m_PushConstants);
+    vkCmdPushConstants(*p_CmdBuffer, m_RenderHandles.pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &m_PushConstants);
     p_CmdBuffer.cmdDraw(3, 0);
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <Volk/volk.h>
 
 #include "utils/identifiable.hpp"
 class VulkanCommandBuffer;
@@ -32,6 +33,8 @@ public:
     void initialize();
     void initializeImgui() const {}
 
+    // Looks up what render needs from the device, on the main thread before the render tasks fan out
+    void prepareRender();
     void render(const VulkanCommandBuffer& p_CmdBuffer) const;
 
     void drawImgui();
@@ -46,5 +49,14 @@ private:
 
     ResourceID m_SkyboxPipelineID = UINT32_MAX;
     ResourceID m_SkyboxPipelineLayoutID = UINT32_MAX;
+
+    // Device handles of the draw, render runs on a worker thread and never looks them up itself
+    struct RenderHandles
+    {
+        VkExtent2D extent{};
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    };
+    RenderHandles m_RenderHandles{};
 };
 
@@ -0,0 +1,66 @@
+#include "tile_quadtree.hpp"
+
+#include <algorithm>
+
+#include "frustum_culler.hpp"
+
+glm::vec2 TileQuadtree::GridLayout::getTilePos(const uint32_t p_X, const uint32_t p_Y) const
+{
+    return glm::vec2(p_X, p_Y) * tileSize - shift + center;
+}
+
+glm::vec3 TileQuadtree::GridLayout::getTileMin(const uint32_t p_X, const uint32_t p_Y) const
+{
+    const glm::vec2 l_TilePos = getTilePos(p_X, p_Y);
+    return glm::vec3(l_TilePos.x, minY, l_TilePos.y) - glm::vec3(margin);
+}
+
+glm::vec3 TileQuadtree::GridLayout::getTileMax(const uint32_t p_X, const uint32_t p_Y) const
+{
+    const glm::vec2 l_TilePos = getTilePos(p_X, p_Y);
+    return glm::vec3(l_TilePos.x + tileSize, maxY, l_TilePos.y + tileSize) + glm::vec3(margin);
+}
+
+void TileQuadtree::cull(const glm::vec4* p_Planes, const GridLayout& p_Layout, std::vector<uint32_t>& p_VisibleTiles)
+{
+    m_TestedNodes = 0;
+    if (p_Layout.gridSize == 0)
+        return;
+
+    uint32_t l_RootSize = 1;
+    while (l_RootSize < p_Layout.gridSize)
+        l_RootSize *= 2;
+
+    m_Stack.clear();
+    m_Stack.push_back({ 0, 0, l_RootSize });
+    while (!m_Stack.empty())
+    {
+        const Node l_Node = m_Stack.back();
+        m_Stack.pop_back();
+
+        if (l_Node.x >= p_Layout.gridSize || l_Node.y >= p_Layout.gridSize)
+            continue;
+
+        const uint32_t l_EndX = std::min(l_Node.x + l_Node.size, p_Layout.gridSize);
+        const uint32_t l_EndY = std::min(l_Node.y + l_Node.size, p_Layout.gridSize);
+
+        m_TestedNodes++;
+        const FrustumCuller::Containment l_Containment = FrustumCuller::classifyBox(p_Planes, p_Layout.getTileMin(l_Node.x, l_Node.y), p_Layout.getTileMax(l_EndX - 1, l_EndY - 1));
+        if (l_Containment == FrustumCuller::Containment::OUTSIDE)
+            continue;
+
+        if (l_Containment == FrustumCuller::Containment::INSIDE || l_Node.size == 1)
+        {
+            for (uint32_t l_Y = l_Node.y; l_Y < l_EndY; l_Y++)
+                for (uint32_t l_X = l_Node.x; l_X < l_EndX; l_X++)
+                    p_VisibleTiles.push_back(l_Y * p_Layout.gridSize + l_X);
+            continue;
+        }
+
+        const uint32_t l_Half = l_Node.size / 2;
+        m_Stack.push_back({ l_Node.x + l_Half, l_Node.y + l_Half, l_Half });
+        m_Stack.push_back({ l_Node.x, l_Node.y + l_Half, l_Half });
+        m_Stack.push_back({ l_Node.x + l_Half, l_Node.y, l_Half });
+        m_Stack.push_back({ l_Node.x, l_Node.y, l_Half });
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Implicit quadtree over the global tile grid. Nodes are power of two squares of tiles clipped to the grid, so
+// nothing but a traversal stack is stored, and the box of a node is exactly the union of its tiles' boxes.
+// Subtrees fully outside are rejected and subtrees fully inside accepted without testing their tiles
+class TileQuadtree
+{
+public:
+    struct GridLayout
+    {
+        uint32_t gridSize = 0;
+        float tileSize = 0.f;
+        glm::vec2 shift{};
+        glm::vec2 center{};
+        float minY = 0.f;
+        float maxY = 0.f;
+        float margin = 0.f;
+
+        // Every culling path builds its boxes through these so they round the same way
+        [[nodiscard]] glm::vec2 getTilePos(uint32_t p_X, uint32_t p_Y) const;
+        [[nodiscard]] glm::vec3 getTileMin(uint32_t p_X, uint32_t p_Y) const;
+        [[nodiscard]] glm::vec3 getTileMax(uint32_t p_X, uint32_t p_Y) const;
+
+        bool operator==(const GridLayout&) const = default;
+    };
+
+    // Appends the global index of every tile touching the frustum, in traversal order
+    void cull(const glm::vec4* p_Planes, const GridLayout& p_Layout, std::vector<uint32_t>& p_VisibleTiles);
+
+    [[nodiscard]] uint32_t getTestedNodeCount() const { return m_TestedNodes; }
+
+private:
+    struct Node
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t size;
+    };
+
+    std::vector<Node> m_Stack{};
+    uint32_t m_TestedNodes = 0;
+};
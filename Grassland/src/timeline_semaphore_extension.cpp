@@ -0,0 +1,25 @@
+#include "timeline_semaphore_extension.hpp"
+
+TimelineSemaphoreExtension::TimelineSemaphoreExtension(const ResourceID p_DeviceID)
+    : VulkanDeviceExtension(p_DeviceID)
+{
+    m_Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    m_Features.timelineSemaphore = VK_TRUE;
+}
+
+VkBaseInStructure* TimelineSemaphoreExtension::getExtensionStruct() const
+{
+    // The device creation links the returned structures together, so pNext is left to it
+    m_Features.pNext = nullptr;
+    return reinterpret_cast<VkBaseInStructure*>(&m_Features);
+}
+
+VkStructureType TimelineSemaphoreExtension::getExtensionStructType() const
+{
+    return VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+}
+
+VulkanDeviceExtension* TimelineSemaphoreExtension::copy()
+{
+    return new TimelineSemaphoreExtension(m_DeviceID);
+}
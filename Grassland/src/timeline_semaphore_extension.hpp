@@ -0,0 +1,20 @@
+#pragma once
+#include "ext/vulkan_extension_management.hpp"
+
+// Turns on the timelineSemaphore feature when the device is created. Timeline semaphores are core since
+// Vulkan 1.2, but the feature still has to be requested through the pNext chain of the device create info
+class TimelineSemaphoreExtension final : public VulkanDeviceExtension
+{
+public:
+    explicit TimelineSemaphoreExtension(ResourceID p_DeviceID);
+
+    void free() override {}
+
+    [[nodiscard]] VkBaseInStructure* getExtensionStruct() const override;
+    [[nodiscard]] VkStructureType getExtensionStructType() const override;
+
+    [[nodiscard]] VulkanDeviceExtension* copy() override;
+
+private:
+    mutable VkPhysicalDeviceTimelineSemaphoreFeatures m_Features{};
+};
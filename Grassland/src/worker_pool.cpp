@@ -0,0 +1,95 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+WorkerPool::~WorkerPool()
+{
+    stopWorkers();
+}
+
+void WorkerPool::setThreadCount(uint32_t p_ThreadCount)
+{
+    p_ThreadCount = std::clamp(p_ThreadCount, 1u, getMaxThreadCount());
+    if (p_ThreadCount == getThreadCount())
+        return;
+
+    stopWorkers();
+
+    m_Stopping = false;
+    m_Workers.reserve(p_ThreadCount - 1);
+    for (uint32_t l_Thread = 1; l_Thread < p_ThreadCount; l_Thread++)
+        m_Workers.emplace_back(&WorkerPool::workerLoop, this, l_Thread, m_Generation);
+}
+
+uint32_t WorkerPool::getMaxThreadCount()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void WorkerPool::parallelFor(const uint32_t p_Count, const Task& p_Task)
+{
+    if (p_Count == 0)
+        return;
+
+    if (m_Workers.empty() || p_Count == 1)
+    {
+        for (uint32_t i = 0; i < p_Count; i++)
+            p_Task(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard l_Lock{ m_Mutex };
+        m_Task = &p_Task;
+        m_TaskCount = p_Count;
+        m_NextIndex.store(0, std::memory_order_relaxed);
+        m_BusyWorkers = static_cast<uint32_t>(m_Workers.size());
+        m_Generation++;
+    }
+    m_WorkCondition.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock l_Lock{ m_Mutex };
+    m_DoneCondition.wait(l_Lock, [this] { return m_BusyWorkers == 0; });
+    m_Task = nullptr;
+}
+
+void WorkerPool::workerLoop(const uint32_t p_Thread, uint64_t p_Generation)
+{
+    while (true)
+    {
+        {
+            std::unique_lock l_Lock{ m_Mutex };
+            m_WorkCondition.wait(l_Lock, [&] { return m_Stopping || m_Generation != p_Generation; });
+            if (m_Stopping)
+                return;
+            p_Generation = m_Generation;
+        }
+
+        runTasks(p_Thread);
+
+        std::lock_guard l_Lock{ m_Mutex };
+        if (--m_BusyWorkers == 0)
+            m_DoneCondition.notify_one();
+    }
+}
+
+void WorkerPool::runTasks(const uint32_t p_Thread)
+{
+    for (uint32_t l_Index = m_NextIndex.fetch_add(1, std::memory_order_relaxed); l_Index < m_TaskCount; l_Index = m_NextIndex.fetch_add(1, std::memory_order_relaxed))
+        (*m_Task)(l_Index, p_Thread);
+}
+
+void WorkerPool::stopWorkers()
+{
+    {
+        std::lock_guard l_Lock{ m_Mutex };
+        m_Stopping = true;
+    }
+    m_WorkCondition.notify_all();
+
+    for (std::thread& l_Worker : m_Workers)
+        l_Worker.join();
+    m_Workers.clear();
+}
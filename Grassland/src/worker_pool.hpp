@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that split indexed jobs with the calling thread. Jobs are blocking, so tasks can
+// freely use anything owned by the caller and no work outlives parallelFor
+class WorkerPool
+{
+public:
+    using Task = std::function<void(uint32_t p_Index, uint32_t p_Thread)>;
+
+    WorkerPool() = default;
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Threads taking part in each job, the caller included. Clamped between 1 and getMaxThreadCount()
+    void setThreadCount(uint32_t p_ThreadCount);
+    [[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+    [[nodiscard]] static uint32_t getMaxThreadCount();
+
+    // Runs p_Task for every index below p_Count and returns once all of them finished. Indices are handed out in
+    // order but to whichever thread is free, p_Thread is 0 for the caller and unique per thread below getThreadCount()
+    void parallelFor(uint32_t p_Count, const Task& p_Task);
+
+private:
+    void workerLoop(uint32_t p_Thread, uint64_t p_Generation);
+    void runTasks(uint32_t p_Thread);
+    void stopWorkers();
+
+    std::vector<std::thread> m_Workers{};
+
+    std::mutex m_Mutex{};
+    std::condition_variable m_WorkCondition{};
+    std::condition_variable m_DoneCondition{};
+    uint64_t m_Generation = 0;
+    uint32_t m_BusyWorkers = 0;
+    bool m_Stopping = false;
+
+    const Task* m_Task = nullptr;
+    uint32_t m_TaskCount = 0;
+    std::atomic<uint32_t> m_NextIndex{ 0 };
+};